@@ -0,0 +1,330 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file accept.c
+ * @brief Web Socket opening handshake key approval for C.
+ *
+ * @see http://tools.ietf.org/html/rfc6455#section-4.2.2
+ */
+
+#include "accept.h"
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   define WS_ACCEPT_SHANI 1
+#   define WS_ACCEPT_SHANI_TARGET __attribute__((target("sha,sse4.1")))
+#   include <immintrin.h>
+#endif
+
+/*!
+ * @internal
+ * @brief Function prototype of SHA-1 block compression implementations.
+ * @param state SHA-1 chaining state, updated in place.
+ * @param data Message blocks, 64 bytes each.
+ * @param blocks Number of blocks in @a data.
+ */
+typedef void(*ws_accept_handler)
+    (uint32 state[5], const uint8 * data, int blocks);
+
+/*!
+ * @internal
+ * @brief Padded message tail: GUID, end-of-message marker and bit length.
+ *
+ * The key is always 24 bytes long, so the message is always 60 bytes long
+ * and always takes exactly two blocks once padded.
+ */
+static const uint8 _ws_accept_tail[128-WS_ACCEPT_KEY_SIZE] = {
+    '2','5','8','E','A','F','A','5','-','E','9','1','4','-',
+    '4','7','D','A','-','9','5','C','A','-','C','5','A','B',
+    '0','D','C','8','5','B','1','1', 0x80, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0xe0,
+};
+
+/*!
+ * @internal
+ * @brief Rotate a 32-bit word to the left.
+ */
+#define WS_ACCEPT_ROL(x,n) (((x) << (n)) | ((x) >> (32-(n))))
+
+/*!
+ * @internal
+ * @brief Portable implementation, one round at a time.
+ *
+ * The message schedule is kept in a rolling window of 16 words.
+ */
+static void _ws_accept_scalar
+    ( uint32 state[5], const uint8 * data, int blocks )
+{
+    uint32 w[16];
+    uint32 a, b, c, d, e, f, k, t;
+    int i;
+    for ( ; blocks > 0; --blocks, data += 64 )
+    {
+        for ( i = 0; i < 16; ++i ) {
+            w[i] = ((uint32)data[4*i+0] << 24) | ((uint32)data[4*i+1] << 16)
+                 | ((uint32)data[4*i+2] <<  8) | ((uint32)data[4*i+3] <<  0);
+        }
+        a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        for ( i = 0; i < 80; ++i )
+        {
+            if ( i >= 16 ) {
+                t = w[(i+13)&15] ^ w[(i+8)&15] ^ w[(i+2)&15] ^ w[i&15];
+                w[i&15] = WS_ACCEPT_ROL(t, 1);
+            }
+            if ( i < 20 ) {
+                f = (b & c) | (~b & d), k = 0x5a827999;
+            }
+            else if ( i < 40 ) {
+                f = b ^ c ^ d, k = 0x6ed9eba1;
+            }
+            else if ( i < 60 ) {
+                f = (b & c) | (b & d) | (c & d), k = 0x8f1bbcdc;
+            }
+            else {
+                f = b ^ c ^ d, k = 0xca62c1d6;
+            }
+            t = WS_ACCEPT_ROL(a, 5) + f + e + k + w[i&15];
+            e = d, d = c, c = WS_ACCEPT_ROL(b, 30), b = a, a = t;
+        }
+        state[0] += a, state[1] += b, state[2] += c;
+        state[3] += d, state[4] += e;
+    }
+}
+
+#ifdef WS_ACCEPT_SHANI
+/*!
+ * @internal
+ * @brief Four rounds of the SHA-1 extensions, with the message schedule.
+ *
+ * Uses message words @a m0 and advances the schedule of the three others.
+ */
+#define WS_ACCEPT_ROUNDS(e0, e1, m0, m1, m2, m3, f)    \
+    e0 = _mm_sha1nexte_epu32(e0, m0);                   \
+    e1 = abcd;                                          \
+    m1 = _mm_sha1msg2_epu32(m1, m0);                    \
+    abcd = _mm_sha1rnds4_epu32(abcd, e0, f);            \
+    m3 = _mm_sha1msg1_epu32(m3, m0);                    \
+    m2 = _mm_xor_si128(m2, m0)
+
+/*!
+ * @internal
+ * @brief SHA-1 extensions implementation, processes 4 rounds at a time.
+ *
+ * This is compiled for the SHA extensions regardless of the compiler flags
+ * and must only be selected after checking that the processor supports them.
+ */
+static WS_ACCEPT_SHANI_TARGET void _ws_accept_shani
+    ( uint32 state[5], const uint8 * data, int blocks )
+{
+    const __m128i swap = _mm_set_epi64x
+        (0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+    __m128i abcd, abcd0, e0, e1, e00, m0, m1, m2, m3;
+    abcd = _mm_shuffle_epi32
+        (_mm_loadu_si128((const __m128i*)state), 0x1b);
+    e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+    for ( ; blocks > 0; --blocks, data += 64 )
+    {
+        abcd0 = abcd, e00 = e0;
+
+        // rounds 0-15 load the message words.
+        m0 = _mm_shuffle_epi8
+            (_mm_loadu_si128((const __m128i*)(data+ 0)), swap);
+        e0 = _mm_add_epi32(e0, m0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        m1 = _mm_shuffle_epi8
+            (_mm_loadu_si128((const __m128i*)(data+16)), swap);
+        e1 = _mm_sha1nexte_epu32(e1, m1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        m0 = _mm_sha1msg1_epu32(m0, m1);
+
+        m2 = _mm_shuffle_epi8
+            (_mm_loadu_si128((const __m128i*)(data+32)), swap);
+        e0 = _mm_sha1nexte_epu32(e0, m2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        m1 = _mm_sha1msg1_epu32(m1, m2);
+        m0 = _mm_xor_si128(m0, m2);
+
+        m3 = _mm_shuffle_epi8
+            (_mm_loadu_si128((const __m128i*)(data+48)), swap);
+        WS_ACCEPT_ROUNDS(e1, e0, m3, m0, m1, m2, 0);
+
+        // rounds 16-79 compute the message words.
+        WS_ACCEPT_ROUNDS(e0, e1, m0, m1, m2, m3, 0);
+        WS_ACCEPT_ROUNDS(e1, e0, m1, m2, m3, m0, 1);
+        WS_ACCEPT_ROUNDS(e0, e1, m2, m3, m0, m1, 1);
+        WS_ACCEPT_ROUNDS(e1, e0, m3, m0, m1, m2, 1);
+        WS_ACCEPT_ROUNDS(e0, e1, m0, m1, m2, m3, 1);
+        WS_ACCEPT_ROUNDS(e1, e0, m1, m2, m3, m0, 1);
+        WS_ACCEPT_ROUNDS(e0, e1, m2, m3, m0, m1, 2);
+        WS_ACCEPT_ROUNDS(e1, e0, m3, m0, m1, m2, 2);
+        WS_ACCEPT_ROUNDS(e0, e1, m0, m1, m2, m3, 2);
+        WS_ACCEPT_ROUNDS(e1, e0, m1, m2, m3, m0, 2);
+        WS_ACCEPT_ROUNDS(e0, e1, m2, m3, m0, m1, 2);
+        WS_ACCEPT_ROUNDS(e1, e0, m3, m0, m1, m2, 3);
+        WS_ACCEPT_ROUNDS(e0, e1, m0, m1, m2, m3, 3);
+        WS_ACCEPT_ROUNDS(e1, e0, m1, m2, m3, m0, 3);
+        WS_ACCEPT_ROUNDS(e0, e1, m2, m3, m0, m1, 3);
+        WS_ACCEPT_ROUNDS(e1, e0, m3, m0, m1, m2, 3);
+
+        e0 = _mm_sha1nexte_epu32(e0, e00);
+        abcd = _mm_add_epi32(abcd, abcd0);
+    }
+    _mm_storeu_si128((__m128i*)state, _mm_shuffle_epi32(abcd, 0x1b));
+    state[4] = (uint32)_mm_extract_epi32(e0, 3);
+}
+#endif
+
+/*!
+ * @internal
+ * @brief Map a 6-bit value to its base64 digit, without branches.
+ *
+ * Each term adjusts the offset from 'A' when @a v crosses the start of the
+ * next range of digits.  Comparisons use the sign bit of the difference, so
+ * the timing doesn't depend on the value.
+ */
+static char _ws_accept_digit ( uint32 v )
+{
+    int c = (int)v + 'A';
+    c += ((25 - (int)v) >> 8) &  6; // 26: 'A'+26 -> 'a'.
+    c -= ((51 - (int)v) >> 8) & 75; // 52: 'a'+26 -> '0'.
+    c -= ((61 - (int)v) >> 8) & 15; // 62: '0'+10 -> '+'.
+    c += ((62 - (int)v) >> 8) &  3; // 63: '+'+ 1 -> '/'.
+    return ((char)c);
+}
+
+/*!
+ * @internal
+ * @brief Check whether the implementation called @a name was asked for.
+ * @param want Name of the implementation asked for, or 0 for any.
+ */
+static int _ws_accept_wants ( const char * want, const char * name )
+{
+    return ((want == 0) || (strcmp(want, name) == 0));
+}
+
+/*!
+ * @internal
+ * @brief Pick the best implementation available on this processor.
+ * @param want Name of the implementation to pick, or 0 for the best one.
+ * @return 0 if @a want is not available.
+ */
+static ws_accept_handler _ws_accept_select
+    ( const char * want, const char ** name )
+{
+#ifdef WS_ACCEPT_SHANI
+    if (_ws_accept_wants(want, "sha-ni") &&
+        __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1"))
+    {
+        return (*name = "sha-ni", &_ws_accept_shani);
+    }
+#endif
+    if (_ws_accept_wants(want, "scalar")) {
+        return (*name = "scalar", &_ws_accept_scalar);
+    }
+    return (0);
+}
+
+/*!
+ * @internal
+ * @brief Selected implementation, resolved on first use.
+ *
+ * Concurrent first uses may race to resolve this, but they all store the
+ * same values.
+ */
+static ws_accept_handler _ws_accept_handler = 0;
+
+/*!
+ * @internal
+ * @brief Name of the selected implementation.
+ *
+ * @see _ws_accept_handler
+ */
+static const char * _ws_accept_name = 0;
+
+void ws_accept_key ( const char * key, char * accept )
+{
+    uint8 data[128];
+    uint8 hash[21];
+    uint32 state[5];
+    uint32 v;
+    int i;
+
+    // hash the key and the GUID, already padded.
+    memcpy(data, key, WS_ACCEPT_KEY_SIZE);
+    memcpy(data+WS_ACCEPT_KEY_SIZE, _ws_accept_tail, sizeof(_ws_accept_tail));
+    state[0] = 0x67452301, state[1] = 0xefcdab89, state[2] = 0x98badcfe;
+    state[3] = 0x10325476, state[4] = 0xc3d2e1f0;
+    if ( _ws_accept_handler == 0 ) {
+        _ws_accept_handler = _ws_accept_select(0, &_ws_accept_name);
+    }
+    _ws_accept_handler(state, data, 2);
+    for ( i = 0; i < 5; ++i ) {
+        hash[4*i+0] = (uint8)(state[i] >> 24);
+        hash[4*i+1] = (uint8)(state[i] >> 16);
+        hash[4*i+2] = (uint8)(state[i] >>  8);
+        hash[4*i+3] = (uint8)(state[i] >>  0);
+    }
+
+    // 20 bytes encode to 27 digits and one padding character.
+    hash[20] = 0;
+    for ( i = 0; i < 7; ++i )
+    {
+        v = ((uint32)hash[3*i] << 16)
+          | ((uint32)hash[3*i+1] << 8) | ((uint32)hash[3*i+2]);
+        accept[4*i+0] = _ws_accept_digit((v >> 18) & 63);
+        accept[4*i+1] = _ws_accept_digit((v >> 12) & 63);
+        accept[4*i+2] = _ws_accept_digit((v >>  6) & 63);
+        accept[4*i+3] = _ws_accept_digit((v >>  0) & 63);
+    }
+    accept[27] = '=';
+}
+
+const char * ws_accept_engine ( void )
+{
+    if ( _ws_accept_handler == 0 ) {
+        _ws_accept_handler = _ws_accept_select(0, &_ws_accept_name);
+    }
+    return (_ws_accept_name);
+}
+
+int ws_accept_override ( const char * name )
+{
+    const char * found = 0;
+    const ws_accept_handler handler = _ws_accept_select(name, &found);
+    if ( handler == 0 ) {
+        return (0);
+    }
+    _ws_accept_handler = handler, _ws_accept_name = found;
+    return (1);
+}
@@ -0,0 +1,96 @@
+#ifndef _accept_h__
+#define _accept_h__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file accept.h
+ * @brief Web Socket opening handshake key approval for C.
+ *
+ * @see http://tools.ietf.org/html/rfc6455#section-4.2.2
+ */
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * @def WS_ACCEPT_KEY_SIZE
+ * @brief Length of a client's `Sec-WebSocket-Key` value, in bytes.
+ */
+#define WS_ACCEPT_KEY_SIZE 24
+
+/*!
+ * @def WS_ACCEPT_SIZE
+ * @brief Length of a server's `Sec-WebSocket-Accept` value, in bytes.
+ */
+#define WS_ACCEPT_SIZE 28
+
+/*!
+ * @brief Compute the server's approval of a client's nonce.
+ * @param key The client's `Sec-WebSocket-Key` value, exactly
+ *  @c WS_ACCEPT_KEY_SIZE bytes long.
+ * @param accept Buffer that receives the `Sec-WebSocket-Accept` value,
+ *  exactly @c WS_ACCEPT_SIZE bytes.  No NUL terminator is written.
+ *
+ * This is the base64 encoding of the SHA-1 digest of @a key followed by the
+ * protocol's GUID.  The input always fits in two SHA-1 blocks, so the
+ * computation uses no dynamic state and never allocates memory.  The SHA-1
+ * extensions are used when the processor supports them.
+ *
+ * @see ws_accept_engine()
+ * @see ws_handshake_key()
+ */
+void ws_accept_key ( const char * key, char * accept );
+
+/*!
+ * @brief Name the SHA-1 implementation selected for this processor.
+ * @return One of "sha-ni" or "scalar".
+ *
+ * This is mostly useful for labeling benchmark results.
+ */
+const char * ws_accept_engine ( void );
+
+/*!
+ * @internal
+ * @brief Force the SHA-1 implementation, for testing.
+ * @param name One of the names returned by @c ws_accept_engine(), or 0 to
+ *  select the best implementation again.
+ * @return 1 if that implementation is available on this processor, else 0
+ *  (the current selection is kept).
+ *
+ * This is not thread-safe: call it only while no other thread computes keys.
+ */
+int ws_accept_override ( const char * name );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _accept_h__ */
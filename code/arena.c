@@ -0,0 +1,276 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file arena.c
+ * @brief Allocation-free memory management for connections and messages.
+ */
+
+#include "arena.h"
+
+#include <stddef.h>
+
+/*!
+ * @internal
+ * @brief Round @a size up to a multiple of @c WS_ARENA_ALIGN.
+ */
+static uint64 _ws_arena_round ( uint64 size )
+{
+    return ((size + (WS_ARENA_ALIGN-1)) & ~(uint64)(WS_ARENA_ALIGN-1));
+}
+
+void ws_arena_init ( struct ws_arena * arena, void * data, uint64 size )
+{
+    char *const base = (char*)data;
+    const uint64 skip = MIN(_ws_arena_round((size_t)base) - (size_t)base, size);
+    // each page needs an entry in the table that follows the pages.
+    const uint64 count =
+        (size - skip) / (WS_ARENA_PAGE + sizeof(struct ws_arena_info));
+    arena->pages = 0;
+    arena->base  = base + skip;
+    arena->next  = arena->base;
+    arena->stop  = arena->base + count*WS_ARENA_PAGE;
+    arena->info  = (struct ws_arena_info*)arena->stop;
+    arena->spare = 0;
+}
+
+/*!
+ * @internal
+ * @brief Find the bookkeeping of the page that holds @a data.
+ */
+static struct ws_arena_info * _ws_arena_info
+    ( const struct ws_arena * arena, const void * data )
+{
+    return (arena->info + ((const char*)data - arena->base) / WS_ARENA_PAGE);
+}
+
+/*!
+ * @internal
+ * @brief Find the page described by @a info.
+ */
+static char * _ws_arena_data
+    ( const struct ws_arena * arena, const struct ws_arena_info * info )
+{
+    return (arena->base + (info - arena->info) * WS_ARENA_PAGE);
+}
+
+/*!
+ * @internal
+ * @brief Insert a page at the head of a list.
+ */
+static void _ws_arena_push
+    ( struct ws_arena_info ** list, struct ws_arena_info * info )
+{
+    info->prev = 0;
+    info->next = *list;
+    if ( *list ) {
+        (*list)->prev = info;
+    }
+    *list = info;
+}
+
+/*!
+ * @internal
+ * @brief Remove a page from a list.
+ */
+static void _ws_arena_drop
+    ( struct ws_arena_info ** list, struct ws_arena_info * info )
+{
+    if ( info->prev ) {
+        info->prev->next = info->next;
+    }
+    else {
+        *list = info->next;
+    }
+    if ( info->next ) {
+        info->next->prev = info->prev;
+    }
+    info->next = info->prev = 0;
+}
+
+void * ws_arena_page ( struct ws_arena * arena )
+{
+    char * page = 0;
+    struct ws_arena_info * info = arena->spare;
+    if ( info ) {
+        _ws_arena_drop(&arena->spare, info);
+        page = _ws_arena_data(arena, info);
+    }
+    else
+    {
+        if ( arena->next == arena->stop ) {
+            return (0);
+        }
+        page = arena->next, arena->next += WS_ARENA_PAGE;
+        info = _ws_arena_info(arena, page);
+        info->next = info->prev = 0;
+    }
+    info->free   = 0;
+    info->used   = 0;
+    info->carved = 0;
+    ++arena->pages;
+    return (page);
+}
+
+void ws_arena_release ( struct ws_arena * arena, void * page )
+{
+    if ( page == 0 ) {
+        return;
+    }
+    _ws_arena_push(&arena->spare, _ws_arena_info(arena, page));
+    --arena->pages;
+}
+
+uint64 ws_arena_left ( const struct ws_arena * arena )
+{
+    // pages handed out before are either in use or spare.
+    return ((arena->stop - arena->base) / WS_ARENA_PAGE - arena->pages);
+}
+
+void ws_slab_init ( struct ws_slab * slab,
+                    struct ws_arena * arena, uint64 size )
+{
+    slab->arena = arena;
+    slab->size  = _ws_arena_round(size? size : 1);
+    slab->used  = 0;
+    slab->open  = 0;
+}
+
+/*!
+ * @internal
+ * @brief Check whether a page can't hold any more objects.
+ */
+static int _ws_slab_full
+    ( const struct ws_slab * slab, const struct ws_arena_info * info )
+{
+    return ((info->free == 0) && (info->carved + slab->size > WS_ARENA_PAGE));
+}
+
+void * ws_slab_get ( struct ws_slab * slab )
+{
+    void * data = 0;
+    struct ws_arena_info * info = slab->open;
+    if ( slab->size > WS_ARENA_PAGE ) {
+        return (0);
+    }
+    if ( info == 0 )
+    {
+        char *const page = (char*)ws_arena_page(slab->arena);
+        if ( page == 0 ) {
+            return (0);
+        }
+        info = _ws_arena_info(slab->arena, page);
+        _ws_arena_push(&slab->open, info);
+    }
+    if ( info->free ) {
+        // released objects store the next free object in their first bytes.
+        data = info->free, info->free = *(void**)data;
+    }
+    else {
+        data = _ws_arena_data(slab->arena, info) + info->carved;
+        info->carved += (uint32)slab->size;
+    }
+    if ( _ws_slab_full(slab, info) ) {
+        _ws_arena_drop(&slab->open, info);
+    }
+    ++info->used, ++slab->used;
+    return (data);
+}
+
+void ws_slab_put ( struct ws_slab * slab, void * data )
+{
+    struct ws_arena_info * info = 0;
+    if ( data == 0 ) {
+        return;
+    }
+    info = _ws_arena_info(slab->arena, data);
+    if ( _ws_slab_full(slab, info) ) {
+        _ws_arena_push(&slab->open, info);
+    }
+    *(void**)data = info->free;
+    info->free = data;
+    --info->used, --slab->used;
+    // let other slabs use the page once it is empty.
+    if ( info->used == 0 ) {
+        _ws_arena_drop(&slab->open, info);
+        ws_arena_release(slab->arena, _ws_arena_data(slab->arena, info));
+    }
+}
+
+/*!
+ * @internal
+ * @brief Index of the slab that serves @a size bytes.
+ */
+static int _ws_pool_class ( uint64 size )
+{
+    int index = 0;
+    while ( ((uint64)64 << index) < size ) {
+        ++index;
+    }
+    return (index);
+}
+
+void ws_pool_init ( struct ws_pool * pool, struct ws_arena * arena )
+{
+    int i;
+    for ( i = 0; i < WS_POOL_CLASSES; ++i ) {
+        ws_slab_init(&pool->slabs[i], arena, (uint64)64 << i);
+    }
+}
+
+uint64 ws_pool_fit ( uint64 size )
+{
+    if ( size > WS_ARENA_PAGE ) {
+        return (0);
+    }
+    return ((uint64)64 << _ws_pool_class(size));
+}
+
+void * ws_pool_get ( struct ws_pool * pool, uint64 size )
+{
+    if ( size > WS_ARENA_PAGE ) {
+        return (0);
+    }
+    return (ws_slab_get(&pool->slabs[_ws_pool_class(size)]));
+}
+
+void ws_pool_put ( struct ws_pool * pool, void * data, uint64 size )
+{
+    if ( size > WS_ARENA_PAGE ) {
+        return;
+    }
+    ws_slab_put(&pool->slabs[_ws_pool_class(size)], data);
+}
+
+uint64 ws_pool_used ( const struct ws_pool * pool )
+{
+    uint64 used = 0;
+    int i;
+    for ( i = 0; i < WS_POOL_CLASSES; ++i ) {
+        used += pool->slabs[i].used;
+    }
+    return (used);
+}
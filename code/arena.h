@@ -0,0 +1,320 @@
+#ifndef _arena_h__
+#define _arena_h__
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file arena.h
+ * @brief Allocation-free memory management for connections and messages.
+ *
+ * The library never allocates memory on its own.  These facilities carve
+ * a block of memory supplied by the application into fixed-size objects, so
+ * servers that open and close connections at a high rate can recycle
+ * connection state and message buffers without going through the heap.
+ */
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * @def WS_ARENA_PAGE
+ * @brief Size of the pages slabs obtain from an arena, in bytes.
+ *
+ * This is also the size of the largest object a slab can hold.
+ */
+#define WS_ARENA_PAGE (64*1024)
+
+/*!
+ * @def WS_ARENA_ALIGN
+ * @brief Alignment of pages and slab objects, in bytes.
+ */
+#define WS_ARENA_ALIGN 16
+
+/*!
+ * @def WS_POOL_CLASSES
+ * @brief Number of buffer sizes in a pool: 64 bytes, 128 bytes, ... 64 KB.
+ */
+#define WS_POOL_CLASSES 11
+
+/*!
+ * @internal
+ * @brief Bookkeeping for one page, stored after the arena's pages.
+ */
+struct ws_arena_info
+{
+    /*!
+     * @private
+     * @brief Released objects on this page.
+     */
+    void * free;
+
+    /*!
+     * @private
+     * @brief Next page in the same list (the arena's spare pages or a slab's
+     *  pages with room left).
+     */
+    struct ws_arena_info * next;
+
+    /*!
+     * @private
+     * @brief Previous page in the same list.
+     */
+    struct ws_arena_info * prev;
+
+    /*!
+     * @private
+     * @brief Number of objects in use on this page.
+     */
+    uint32 used;
+
+    /*!
+     * @private
+     * @brief Number of bytes carved into objects so far, from the start of
+     *  the page.
+     */
+    uint32 carved;
+};
+
+/*!
+ * @brief Memory block split into pages.
+ *
+ * Pages are handed out in order at first, then pages given back with
+ * @c ws_arena_release() are handed out again before any new page.  The end
+ * of the block holds a few bytes of bookkeeping per page.  An arena and the
+ * slabs and pools that draw from it are @e not thread-safe.  Use one arena
+ * per thread (e.g. per event loop) so that threads never contend for memory.
+ *
+ * @see ws_slab
+ */
+struct ws_arena
+{
+    /*!
+     * @public
+     * @brief Number of pages in use.
+     */
+    uint64 pages;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Start of the first page.
+     */
+    char * base;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Start of the next page never handed out.
+     */
+    char * next;
+
+    /*!
+     * @internal
+     * @private
+     * @brief End of the last page.
+     */
+    char * stop;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Bookkeeping, one entry per page.
+     */
+    struct ws_arena_info * info;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Pages given back, handed out again first.
+     */
+    struct ws_arena_info * spare;
+};
+
+/*!
+ * @brief Initialize an arena.
+ * @param arena Uninitialized arena.
+ * @param data Memory block, owned by the application.  It must remain
+ *  valid as long as any object obtained from the arena is in use.
+ * @param size Number of bytes in @a data.
+ *
+ * Bytes before the first aligned address and after the last complete page
+ * and its bookkeeping are left unused.
+ */
+void ws_arena_init ( struct ws_arena * arena, void * data, uint64 size );
+
+/*!
+ * @brief Take a page from the arena.
+ * @param arena Current arena state.
+ * @return A block of @c WS_ARENA_PAGE bytes, or 0 if the arena is exhausted.
+ */
+void * ws_arena_page ( struct ws_arena * arena );
+
+/*!
+ * @brief Give a page back to the arena.
+ * @param arena Arena that handed out @a page.
+ * @param page Page to release, or 0 (ignored).
+ */
+void ws_arena_release ( struct ws_arena * arena, void * page );
+
+/*!
+ * @brief Number of pages left in the arena.
+ * @param arena Current arena state.
+ */
+uint64 ws_arena_left ( const struct ws_arena * arena );
+
+/*!
+ * @brief Allocator for objects of a single size.
+ *
+ * Released objects are kept on a free list, per page, and handed out again
+ * first.  Slabs take a new page from their arena only when all their pages
+ * are full, and give a page back as soon as none of its objects is in use,
+ * so a steady number of connections uses a steady amount of memory, however
+ * many connections come and go, and memory freed by one slab is available
+ * to the others.
+ *
+ * @see ws_slab_get()
+ * @see ws_slab_put()
+ */
+struct ws_slab
+{
+    /*!
+     * @public
+     * @brief Source of pages.
+     */
+    struct ws_arena * arena;
+
+    /*!
+     * @public
+     * @brief Size of objects, in bytes, rounded up to @c WS_ARENA_ALIGN.
+     */
+    uint64 size;
+
+    /*!
+     * @public
+     * @brief Number of objects in use.
+     */
+    uint64 used;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Pages with room for at least one more object.
+     */
+    struct ws_arena_info * open;
+};
+
+/*!
+ * @brief Initialize a slab.
+ * @param slab Uninitialized slab.
+ * @param arena Source of pages.
+ * @param size Size of objects, in bytes, at most @c WS_ARENA_PAGE.
+ */
+void ws_slab_init ( struct ws_slab * slab,
+                    struct ws_arena * arena, uint64 size );
+
+/*!
+ * @brief Obtain an object.
+ * @param slab Current slab state.
+ * @return Uninitialized memory for one object, aligned on
+ *  @c WS_ARENA_ALIGN bytes, or 0 if the arena is exhausted.
+ */
+void * ws_slab_get ( struct ws_slab * slab );
+
+/*!
+ * @brief Release an object.
+ * @param slab Slab that handed out @a data.
+ * @param data Object to release, or 0 (ignored).
+ */
+void ws_slab_put ( struct ws_slab * slab, void * data );
+
+/*!
+ * @brief Allocator for buffers of several sizes.
+ *
+ * Requests are rounded up to the next power of 2, from 64 bytes to
+ * @c WS_ARENA_PAGE bytes, and served by one slab per size.  Sizes share
+ * their arena's pages: once all buffers on a page are released, the page
+ * may serve any size.
+ *
+ * @see ws_pool_get()
+ * @see ws_pool_put()
+ */
+struct ws_pool
+{
+    /*!
+     * @internal
+     * @private
+     * @brief One slab per buffer size, smallest first.
+     */
+    struct ws_slab slabs[WS_POOL_CLASSES];
+};
+
+/*!
+ * @brief Initialize a pool.
+ * @param pool Uninitialized pool.
+ * @param arena Source of pages.
+ */
+void ws_pool_init ( struct ws_pool * pool, struct ws_arena * arena );
+
+/*!
+ * @brief Size of the buffer that serves a request.
+ * @param size Number of bytes requested.
+ * @return Buffer capacity in bytes, or 0 if @a size exceeds
+ *  @c WS_ARENA_PAGE.
+ */
+uint64 ws_pool_fit ( uint64 size );
+
+/*!
+ * @brief Obtain a buffer.
+ * @param pool Current pool state.
+ * @param size Number of bytes needed.  Use @c ws_pool_fit() to know how many
+ *  bytes are actually available.
+ * @return Uninitialized buffer, or 0 if @a size is too large or if the arena
+ *  is exhausted.
+ */
+void * ws_pool_get ( struct ws_pool * pool, uint64 size );
+
+/*!
+ * @brief Release a buffer.
+ * @param pool Pool that handed out @a data.
+ * @param data Buffer to release, or 0 (ignored).
+ * @param size Size requested when @a data was obtained (or its capacity).
+ */
+void ws_pool_put ( struct ws_pool * pool, void * data, uint64 size );
+
+/*!
+ * @brief Number of buffers in use.
+ * @param pool Current pool state.
+ */
+uint64 ws_pool_used ( const struct ws_pool * pool );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _arena_h__ */
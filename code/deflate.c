@@ -0,0 +1,922 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file deflate.c
+ * @brief Web Socket per-message compression extension for C.
+ *
+ * @see http://tools.ietf.org/html/rfc7692
+ */
+
+#include "deflate.h"
+
+#ifdef WS_HAVE_ZLIB
+
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+/*!
+ * @internal
+ * @brief Size of the allocation header used to track zlib memory usage.
+ */
+#define _WS_DEFLATE_HEADER 16
+
+/*!
+ * @internal
+ * @brief Empty stored block that ends each compressed message.
+ */
+static const uint8 _ws_deflate_trailer[4] = { 0x00, 0x00, 0xff, 0xff };
+
+/*!
+ * @internal
+ * @brief Pooled zlib stream, linked in the pool's idle list.
+ */
+struct _ws_deflate_context
+{
+    z_stream zstream;
+    struct _ws_deflate_context * next;
+};
+
+static void * _ws_deflate_default_alloc ( struct ws_deflate * stream,
+                                          uint64 size )
+{
+    return (malloc((size_t)size));
+}
+
+static void _ws_deflate_default_release ( struct ws_deflate * stream,
+                                          void * data )
+{
+    free(data);
+}
+
+static void * _ws_deflate_pool_default_alloc ( struct ws_deflate_pool * pool,
+                                               uint64 size )
+{
+    return (malloc((size_t)size));
+}
+
+static void _ws_deflate_pool_default_release ( struct ws_deflate_pool * pool,
+                                               void * data )
+{
+    free(data);
+}
+
+static void _ws_deflate_default_accept
+    ( struct ws_deflate * stream, const void * data, uint64 size )
+{
+}
+
+/*!
+ * @internal
+ * @brief zlib allocator, forwards to the application's allocator.
+ */
+static voidpf _ws_deflate_zalloc ( voidpf opaque, uInt items, uInt size )
+{
+    struct ws_deflate *const stream = (struct ws_deflate*)opaque;
+    const uint64 total = (uint64)items*size + _WS_DEFLATE_HEADER;
+    uint8 * data = 0;
+    if ((stream->memory_limit != 0) &&
+        (stream->memory+total > stream->memory_limit))
+    {
+        return (Z_NULL);
+    }
+    data = (uint8*)stream->alloc(stream, total);
+    if ( data == 0 ) {
+        return (Z_NULL);
+    }
+    // remember size to account for it when released.
+    memcpy(data, &total, sizeof(total));
+    stream->memory += total;
+    return (data + _WS_DEFLATE_HEADER);
+}
+
+/*!
+ * @internal
+ * @brief zlib allocator, forwards to the application's allocator.
+ */
+static void _ws_deflate_zfree ( voidpf opaque, voidpf address )
+{
+    struct ws_deflate *const stream = (struct ws_deflate*)opaque;
+    uint8 *const data = (uint8*)address - _WS_DEFLATE_HEADER;
+    uint64 total = 0;
+    memcpy(&total, data, sizeof(total));
+    stream->memory -= total;
+    stream->release(stream, data);
+}
+
+/*!
+ * @internal
+ * @brief zlib allocator, forwards to the pool's allocator.
+ */
+static voidpf _ws_deflate_pool_zalloc ( voidpf opaque, uInt items, uInt size )
+{
+    struct ws_deflate_pool *const pool = (struct ws_deflate_pool*)opaque;
+    const uint64 total = (uint64)items*size + _WS_DEFLATE_HEADER;
+    uint8 *const data = (uint8*)pool->alloc(pool, total);
+    if ( data == 0 ) {
+        return (Z_NULL);
+    }
+    memcpy(data, &total, sizeof(total));
+    pool->memory += total;
+    return (data + _WS_DEFLATE_HEADER);
+}
+
+/*!
+ * @internal
+ * @brief zlib allocator, forwards to the pool's allocator.
+ */
+static void _ws_deflate_pool_zfree ( voidpf opaque, voidpf address )
+{
+    struct ws_deflate_pool *const pool = (struct ws_deflate_pool*)opaque;
+    uint8 *const data = (uint8*)address - _WS_DEFLATE_HEADER;
+    uint64 total = 0;
+    memcpy(&total, data, sizeof(total));
+    pool->memory -= total;
+    pool->release(pool, data);
+}
+
+/*!
+ * @internal
+ * @brief Allocate a zlib stream object through the application's allocator.
+ */
+static z_stream * _ws_deflate_zstream ( struct ws_deflate * stream )
+{
+    z_stream * zstream = (z_stream*)_ws_deflate_zalloc
+        (stream, 1, (uInt)sizeof(z_stream));
+    if ( zstream == 0 ) {
+        stream->status = ws_deflate_no_memory;
+        return (0);
+    }
+    memset(zstream, 0, sizeof(z_stream));
+    zstream->zalloc = &_ws_deflate_zalloc;
+    zstream->zfree = &_ws_deflate_zfree;
+    zstream->opaque = stream;
+    return (zstream);
+}
+
+/*!
+ * @internal
+ * @brief Window size (base-2 logarithm) for a negotiated parameter.
+ */
+static int _ws_deflate_window ( int bits )
+{
+    // zlib doesn't support 256-byte windows for raw deflate streams.
+    return ((bits <= 0)? 15 : ((bits < 9)? 9 : bits));
+}
+
+/*!
+ * @internal
+ * @brief Check if the peer resets its compression context after each message.
+ */
+static int _ws_deflate_peer_resets ( const struct ws_deflate * stream )
+{
+    return (stream->server?
+            stream->params.client_no_context_takeover :
+            stream->params.server_no_context_takeover);
+}
+
+/*!
+ * @internal
+ * @brief Check if we reset our compression context after each message.
+ */
+static int _ws_deflate_self_resets ( const struct ws_deflate * stream )
+{
+    return (stream->server?
+            stream->params.server_no_context_takeover :
+            stream->params.client_no_context_takeover);
+}
+
+/*!
+ * @internal
+ * @brief Check if our compression context is borrowed from the pool.
+ */
+static int _ws_deflate_pooled_self ( const struct ws_deflate * stream )
+{
+    return ((stream->pool != 0) && _ws_deflate_self_resets(stream));
+}
+
+/*!
+ * @internal
+ * @brief Check if our decompression context is borrowed from the pool.
+ */
+static int _ws_deflate_pooled_peer ( const struct ws_deflate * stream )
+{
+    return ((stream->pool != 0) && _ws_deflate_peer_resets(stream));
+}
+
+/*!
+ * @internal
+ * @brief Borrow a context from the pool.
+ * @param stream Connection that borrows the context.
+ * @param compress 1 for a compression context, 0 for decompression.
+ */
+static z_stream * _ws_deflate_borrow ( struct ws_deflate * stream,
+                                       int compress )
+{
+    struct ws_deflate_pool *const pool = stream->pool;
+    struct _ws_deflate_context ** idle = (struct _ws_deflate_context**)
+        (compress? &pool->deflaters : &pool->inflaters);
+    struct _ws_deflate_context * context = *idle;
+    const int bits = _ws_deflate_window(pool->window_bits);
+    const int self = _ws_deflate_window(stream->server?
+                                        stream->params.server_max_window_bits :
+                                        stream->params.client_max_window_bits);
+    const int peer = _ws_deflate_window(stream->server?
+                                        stream->params.client_max_window_bits :
+                                        stream->params.server_max_window_bits);
+
+    // pooled windows must fit the negotiated windows.
+    if ((compress && (bits > self)) || (!compress && (bits < peer))) {
+        stream->status = ws_deflate_invalid_params;
+        return (0);
+    }
+    if ( context != 0 ) {
+        *idle = context->next;
+    }
+    else
+    {
+        int result = 0;
+        if ((pool->capacity != 0) && (pool->contexts >= pool->capacity)) {
+            ++pool->misses;
+            stream->status = ws_deflate_exhausted;
+            return (0);
+        }
+        context = (struct _ws_deflate_context*)_ws_deflate_pool_zalloc
+            (pool, 1, (uInt)sizeof(struct _ws_deflate_context));
+        if ( context == 0 ) {
+            ++pool->misses;
+            stream->status = ws_deflate_no_memory;
+            return (0);
+        }
+        memset(context, 0, sizeof(struct _ws_deflate_context));
+        context->zstream.zalloc = &_ws_deflate_pool_zalloc;
+        context->zstream.zfree = &_ws_deflate_pool_zfree;
+        context->zstream.opaque = pool;
+        result = compress?
+            deflateInit2(&context->zstream, pool->level, Z_DEFLATED,
+                         -bits, 8, Z_DEFAULT_STRATEGY) :
+            inflateInit2(&context->zstream, -bits);
+        if ( result != Z_OK ) {
+            _ws_deflate_pool_zfree(pool, context);
+            ++pool->misses;
+            stream->status = ws_deflate_no_memory;
+            return (0);
+        }
+        ++pool->contexts;
+    }
+    context->next = 0;
+    ++pool->loans;
+    if ( ++pool->in_use > pool->peak ) {
+        pool->peak = pool->in_use;
+    }
+    return (&context->zstream);
+}
+
+/*!
+ * @internal
+ * @brief Return a borrowed context to the pool.
+ */
+static void _ws_deflate_return ( struct ws_deflate * stream,
+                                 void * zstream, int compress )
+{
+    struct ws_deflate_pool *const pool = stream->pool;
+    struct _ws_deflate_context *const context =
+        (struct _ws_deflate_context*)zstream;
+    struct _ws_deflate_context ** idle = (struct _ws_deflate_context**)
+        (compress? &pool->deflaters : &pool->inflaters);
+    if ( compress ) {
+        deflateReset(&context->zstream);
+    }
+    else {
+        inflateReset(&context->zstream);
+    }
+    context->next = *idle, *idle = context;
+    --pool->in_use;
+}
+
+static z_stream * _ws_deflate_inflater ( struct ws_deflate * stream )
+{
+    z_stream * zstream = (z_stream*)stream->inflater;
+    if ((zstream == 0) && _ws_deflate_pooled_peer(stream)) {
+        zstream = _ws_deflate_borrow(stream, 0);
+        stream->inflater = zstream;
+    }
+    else if ( zstream == 0 )
+    {
+        const int bits = _ws_deflate_window(stream->server?
+                                            stream->params.client_max_window_bits :
+                                            stream->params.server_max_window_bits);
+        zstream = _ws_deflate_zstream(stream);
+        if ( zstream == 0 ) {
+            return (0);
+        }
+        if ( inflateInit2(zstream, -bits) != Z_OK ) {
+            _ws_deflate_zfree(stream, zstream);
+            stream->status = ws_deflate_no_memory;
+            return (0);
+        }
+        stream->inflater = zstream;
+    }
+    return (zstream);
+}
+
+static z_stream * _ws_deflate_deflater ( struct ws_deflate * stream )
+{
+    z_stream * zstream = (z_stream*)stream->deflater;
+    const int self = (stream->server?
+                      stream->params.server_max_window_bits :
+                      stream->params.client_max_window_bits);
+    // can't honor 256-byte windows (see _ws_deflate_window()).
+    if ((self > 0) && (self < 9)) {
+        stream->status = ws_deflate_invalid_params;
+        return (0);
+    }
+    if ((zstream == 0) && _ws_deflate_pooled_self(stream)) {
+        zstream = _ws_deflate_borrow(stream, 1);
+        stream->deflater = zstream;
+    }
+    else if ( zstream == 0 )
+    {
+        const int bits = _ws_deflate_window(self);
+        zstream = _ws_deflate_zstream(stream);
+        if ( zstream == 0 ) {
+            return (0);
+        }
+        if ( deflateInit2(zstream, stream->level, Z_DEFLATED,
+                          -bits, 8, Z_DEFAULT_STRATEGY) != Z_OK )
+        {
+            _ws_deflate_zfree(stream, zstream);
+            stream->status = ws_deflate_no_memory;
+            return (0);
+        }
+        stream->deflater = zstream;
+    }
+    return (zstream);
+}
+
+/*!
+ * @internal
+ * @brief Decompress data and forward the output to the application.
+ */
+static void _ws_deflate_inflate ( struct ws_deflate * stream,
+                                  const uint8 * data, uint64 size )
+{
+    uint8 output[4096];
+    z_stream *const zstream = _ws_deflate_inflater(stream);
+    if ((zstream == 0) || stream->ended) {
+        return;
+    }
+    while ( size > 0 )
+    {
+        // zlib counts in 32-bit integers.
+        const uInt part = (uInt)MIN(size, 0x40000000);
+        zstream->next_in = (Bytef*)data;
+        zstream->avail_in = part;
+        do {
+            int result = 0;
+            zstream->next_out = output;
+            zstream->avail_out = sizeof(output);
+            result = inflate(zstream, Z_SYNC_FLUSH);
+            if ((result != Z_OK) &&
+                (result != Z_STREAM_END) &&
+                (result != Z_BUF_ERROR))
+            {
+                stream->status = (result == Z_MEM_ERROR)?
+                    ws_deflate_no_memory : ws_deflate_corrupt;
+                return;
+            }
+            if ( zstream->avail_out < sizeof(output) ) {
+                stream->accept_content
+                    (stream, output, sizeof(output)-zstream->avail_out);
+            }
+            // final block, drop whatever follows, including the trailer.
+            if ( result == Z_STREAM_END ) {
+                stream->ended = 1;
+                return;
+            }
+            if ((result == Z_BUF_ERROR) && (zstream->avail_in > 0)) {
+                stream->status = ws_deflate_corrupt;
+                return;
+            }
+        }
+        while ((zstream->avail_in > 0) || (zstream->avail_out == 0));
+        data += part, size -= part;
+    }
+}
+
+/*!
+ * @internal
+ * @brief Start a new stream after a final block, keeping the window.
+ *
+ * With context takeover, the next message may refer to data of this one,
+ * but a stream is over once it has seen a final block.
+ */
+static void _ws_deflate_restart ( struct ws_deflate * stream )
+{
+    uint8 window[1 << 15];
+    uInt size = sizeof(window);
+    z_stream *const zstream = (z_stream*)stream->inflater;
+    if ((inflateGetDictionary(zstream, window, &size) != Z_OK) ||
+        (inflateReset(zstream) != Z_OK) ||
+        ((size > 0) && (inflateSetDictionary(zstream, window, size) != Z_OK)))
+    {
+        stream->status = ws_deflate_corrupt;
+    }
+}
+
+/*!
+ * @internal
+ * @brief Send one fragment of a compressed message.
+ */
+static void _ws_deflate_send ( struct ws_owire * wire, ws_type type,
+                               const uint8 * data, uint64 size, int last )
+{
+    ws_owire_new_frame(wire, type, size, last,
+                       (type == ws_same)? 0 : WS_DEFLATE_EXTENSION);
+    ws_owire_feed(wire, data, size);
+    ws_owire_end_frame(wire);
+}
+
+/*!
+ * @internal
+ * @brief Skip whitespace at both ends of a token.
+ */
+static void _ws_deflate_trim ( const char ** lower, const char ** upper )
+{
+    while ((*lower < *upper) && ((**lower == ' ') || (**lower == '\t'))) {
+        ++*lower;
+    }
+    while ((*lower < *upper) && ((*(*upper-1) == ' ') || (*(*upper-1) == '\t'))) {
+        --*upper;
+    }
+}
+
+/*!
+ * @internal
+ * @brief Compare a token to a (lowercase) name, ignoring case.
+ */
+static int _ws_deflate_match ( const char * lower, const char * upper,
+                               const char * name )
+{
+    for ( ; (lower < upper) && (*name != '\0'); ++lower, ++name )
+    {
+        char c = *lower;
+        if ((c >= 'A') && (c <= 'Z')) {
+            c = (char)(c - 'A' + 'a');
+        }
+        if ( c != *name ) {
+            return (0);
+        }
+    }
+    return ((lower == upper) && (*name == '\0'));
+}
+
+/*!
+ * @internal
+ * @brief Parse a window size parameter value, possibly quoted.
+ * @return The window size, or 0 if the value is invalid.
+ */
+static int _ws_deflate_bits ( const char * lower, const char * upper )
+{
+    int bits = 0;
+    if (((upper-lower) >= 2) && (*lower == '"') && (*(upper-1) == '"')) {
+        ++lower, --upper;
+    }
+    if ((lower == upper) || ((upper-lower) > 2)) {
+        return (0);
+    }
+    for ( ; lower < upper; ++lower )
+    {
+        if ((*lower < '0') || (*lower > '9')) {
+            return (0);
+        }
+        bits = bits*10 + (*lower - '0');
+    }
+    return (((bits >= 8) && (bits <= 15))? bits : 0);
+}
+
+/*!
+ * @internal
+ * @brief Parse a single extension offer.
+ * @return 1 if the offer is a valid "permessage-deflate" offer, else 0.
+ */
+static int _ws_deflate_offer ( const char * lower, const char * upper,
+                               struct ws_deflate_params * params )
+{
+    const char * next = lower;
+    int index = 0;
+    memset(params, 0, sizeof(*params));
+    for ( index = 0; lower < upper; ++index, lower = next+1 )
+    {
+        const char * name = lower;
+        const char * stop = lower;
+        const char * value = 0;
+        for ( next = lower; (next < upper) && (*next != ';'); ++next ) {
+        }
+        for ( stop = lower; (stop < next) && (*stop != '='); ++stop ) {
+        }
+        if ( stop < next ) {
+            value = stop + 1;
+        }
+        _ws_deflate_trim(&name, &stop);
+        if ( index == 0 )
+        {
+            if ((value != 0) ||
+                !_ws_deflate_match(name, stop, "permessage-deflate")) {
+                return (0);
+            }
+            continue;
+        }
+        if ( value != 0 ) {
+            _ws_deflate_trim(&value, &next);
+        }
+        if ( _ws_deflate_match(name, stop, "server_no_context_takeover") )
+        {
+            if ((value != 0) || params->server_no_context_takeover) {
+                return (0);
+            }
+            params->server_no_context_takeover = 1;
+        }
+        else if ( _ws_deflate_match(name, stop, "client_no_context_takeover") )
+        {
+            if ((value != 0) || params->client_no_context_takeover) {
+                return (0);
+            }
+            params->client_no_context_takeover = 1;
+        }
+        else if ( _ws_deflate_match(name, stop, "server_max_window_bits") )
+        {
+            if ((value == 0) || (params->server_max_window_bits != 0)) {
+                return (0);
+            }
+            params->server_max_window_bits = _ws_deflate_bits(value, next);
+            if ( params->server_max_window_bits == 0 ) {
+                return (0);
+            }
+        }
+        else if ( _ws_deflate_match(name, stop, "client_max_window_bits") )
+        {
+            if ( params->client_max_window_bits != 0 ) {
+                return (0);
+            }
+            params->client_max_window_bits = -1;
+            if ( value != 0 )
+            {
+                params->client_max_window_bits = _ws_deflate_bits(value, next);
+                if ( params->client_max_window_bits == 0 ) {
+                    return (0);
+                }
+            }
+        }
+        else {
+            return (0);
+        }
+        // the trailing ';' separator ends the offer.
+        if ( next == upper ) {
+            break;
+        }
+    }
+    return (index > 0);
+}
+
+/*!
+ * @internal
+ * @brief Append a string to a fixed-size buffer.
+ */
+static uint64 _ws_deflate_append ( char * data, uint64 size, uint64 used,
+                                   const char * text )
+{
+    const uint64 length = strlen(text);
+    if ( used+length > size ) {
+        return (size+1);
+    }
+    memcpy(data+used, text, length);
+    return (used+length);
+}
+
+/*!
+ * @internal
+ * @brief Format a window size parameter value.
+ */
+static void _ws_deflate_number ( char * text, const char * name, int bits )
+{
+    const uint64 length = strlen(name);
+    memcpy(text, name, length);
+    text[length+0] = '=';
+    text[length+1] = (char)('0' + bits/10);
+    text[length+2] = (char)('0' + bits%10);
+    text[length+3] = '\0';
+    if ( bits < 10 ) {
+        text[length+1] = (char)('0' + bits);
+        text[length+2] = '\0';
+    }
+}
+
+void ws_deflate_pool_init ( struct ws_deflate_pool * pool )
+{
+    pool->alloc = &_ws_deflate_pool_default_alloc;
+    pool->release = &_ws_deflate_pool_default_release;
+    pool->baton = 0;
+    pool->window_bits = 15;
+    pool->level = Z_DEFAULT_COMPRESSION;
+    pool->capacity = 0;
+    pool->contexts = 0;
+    pool->in_use = 0;
+    pool->peak = 0;
+    pool->loans = 0;
+    pool->misses = 0;
+    pool->memory = 0;
+    pool->deflaters = 0;
+    pool->inflaters = 0;
+}
+
+void ws_deflate_pool_clear ( struct ws_deflate_pool * pool )
+{
+    struct _ws_deflate_context * context = 0;
+    while ((context = (struct _ws_deflate_context*)pool->deflaters) != 0) {
+        pool->deflaters = context->next;
+        deflateEnd(&context->zstream);
+        _ws_deflate_pool_zfree(pool, context);
+        --pool->contexts;
+    }
+    while ((context = (struct _ws_deflate_context*)pool->inflaters) != 0) {
+        pool->inflaters = context->next;
+        inflateEnd(&context->zstream);
+        _ws_deflate_pool_zfree(pool, context);
+        --pool->contexts;
+    }
+}
+
+void ws_deflate_init ( struct ws_deflate * stream )
+{
+    stream->alloc = &_ws_deflate_default_alloc;
+    stream->release = &_ws_deflate_default_release;
+    stream->accept_content = &_ws_deflate_default_accept;
+    stream->baton = 0;
+    memset(&stream->params, 0, sizeof(stream->params));
+    stream->server = 0;
+    stream->level = Z_DEFAULT_COMPRESSION;
+    stream->memory_limit = 0;
+    stream->buffer = 0;
+    stream->buffer_size = 0;
+    stream->status = ws_deflate_ok;
+    stream->memory = 0;
+    stream->pool = 0;
+    stream->deflater = 0;
+    stream->inflater = 0;
+    stream->compressed = 0;
+    stream->ended = 0;
+}
+
+void ws_deflate_clear ( struct ws_deflate * stream )
+{
+    if ( stream->deflater && _ws_deflate_pooled_self(stream) ) {
+        _ws_deflate_return(stream, stream->deflater, 1);
+        stream->deflater = 0;
+    }
+    if ( stream->inflater && _ws_deflate_pooled_peer(stream) ) {
+        _ws_deflate_return(stream, stream->inflater, 0);
+        stream->inflater = 0;
+    }
+    if ( stream->deflater ) {
+        deflateEnd((z_stream*)stream->deflater);
+        _ws_deflate_zfree(stream, stream->deflater);
+        stream->deflater = 0;
+    }
+    if ( stream->inflater ) {
+        inflateEnd((z_stream*)stream->inflater);
+        _ws_deflate_zfree(stream, stream->inflater);
+        stream->inflater = 0;
+    }
+}
+
+int ws_deflate_parse ( const char * data, uint64 size,
+                       struct ws_deflate_params * params )
+{
+    const char *const upper = data + size;
+    const char * lower = data;
+    const char * next = data;
+    for ( ; lower < upper; lower = next+1 )
+    {
+        for ( next = lower; (next < upper) && (*next != ','); ++next ) {
+        }
+        if ( _ws_deflate_offer(lower, next, params) ) {
+            return (1);
+        }
+    }
+    memset(params, 0, sizeof(*params));
+    return (0);
+}
+
+int ws_deflate_accept ( const struct ws_deflate_params * offer,
+                        const struct ws_deflate_params * limits,
+                        struct ws_deflate_params * params )
+{
+    int bits = 0;
+    memset(params, 0, sizeof(*params));
+    params->server_no_context_takeover =
+        offer->server_no_context_takeover || limits->server_no_context_takeover;
+    params->client_no_context_takeover =
+        offer->client_no_context_takeover || limits->client_no_context_takeover;
+
+    // our window may be smaller than what the client allows.
+    bits = _ws_deflate_window(limits->server_max_window_bits);
+    if ( offer->server_max_window_bits > 0 ) {
+        bits = MIN(bits, offer->server_max_window_bits);
+    }
+    // can't honor 256-byte windows (see _ws_deflate_window()).
+    if ( bits < 9 ) {
+        return (0);
+    }
+    if ((offer->server_max_window_bits > 0) || (bits < 15)) {
+        params->server_max_window_bits = bits;
+    }
+
+    // the client's window can only be limited if it supports it.
+    if ( offer->client_max_window_bits != 0 )
+    {
+        bits = _ws_deflate_window(limits->client_max_window_bits);
+        if ( offer->client_max_window_bits > 0 ) {
+            bits = MIN(bits, offer->client_max_window_bits);
+        }
+        if ((offer->client_max_window_bits > 0) || (bits < 15)) {
+            params->client_max_window_bits = bits;
+        }
+    }
+    return (1);
+}
+
+int ws_deflate_confirm ( const struct ws_deflate_params * response )
+{
+    // the value is mandatory in responses.
+    return ((response->client_max_window_bits == 0) ||
+            (response->client_max_window_bits >= 9));
+}
+
+uint64 ws_deflate_format ( const struct ws_deflate_params * params,
+                           char * data, uint64 size )
+{
+    char text[32];
+    uint64 used = 0;
+    used = _ws_deflate_append(data, size, used, "permessage-deflate");
+    if ( params->server_no_context_takeover ) {
+        used = _ws_deflate_append
+            (data, size, used, "; server_no_context_takeover");
+    }
+    if ( params->client_no_context_takeover ) {
+        used = _ws_deflate_append
+            (data, size, used, "; client_no_context_takeover");
+    }
+    if ( params->server_max_window_bits > 0 ) {
+        _ws_deflate_number(text, "; server_max_window_bits",
+                           params->server_max_window_bits);
+        used = _ws_deflate_append(data, size, used, text);
+    }
+    if ( params->client_max_window_bits > 0 ) {
+        _ws_deflate_number(text, "; client_max_window_bits",
+                           params->client_max_window_bits);
+        used = _ws_deflate_append(data, size, used, text);
+    }
+    if ( params->client_max_window_bits < 0 ) {
+        used = _ws_deflate_append
+            (data, size, used, "; client_max_window_bits");
+    }
+    return ((used > size)? 0 : used);
+}
+
+void ws_deflate_new_message ( struct ws_deflate * stream, int compressed )
+{
+    stream->compressed = compressed;
+    stream->ended = 0;
+}
+
+void ws_deflate_inflate ( struct ws_deflate * stream,
+                          const void * data, uint64 size )
+{
+    if ( stream->status != ws_deflate_ok ) {
+        return;
+    }
+    if ( !stream->compressed ) {
+        stream->accept_content(stream, data, size);
+        return;
+    }
+    _ws_deflate_inflate(stream, (const uint8*)data, size);
+}
+
+void ws_deflate_end_message ( struct ws_deflate * stream )
+{
+    if ((stream->status != ws_deflate_ok) || !stream->compressed) {
+        return;
+    }
+    // restore the trailer the peer stripped, unless the message ended with a
+    // final block.
+    _ws_deflate_inflate(stream, _ws_deflate_trailer, 4);
+    if ((stream->inflater != 0) && _ws_deflate_pooled_peer(stream)) {
+        _ws_deflate_return(stream, stream->inflater, 0);
+        stream->inflater = 0;
+    }
+    else if ((stream->inflater != 0) && _ws_deflate_peer_resets(stream)) {
+        inflateReset((z_stream*)stream->inflater);
+    }
+    else if ((stream->inflater != 0) && stream->ended) {
+        _ws_deflate_restart(stream);
+    }
+    stream->compressed = 0;
+    stream->ended = 0;
+}
+
+void ws_deflate_put ( struct ws_deflate * stream, struct ws_owire * wire,
+                      ws_type type, const void * data, uint64 size )
+{
+    uint8 chunk[4096];
+    uint8 * output = chunk;
+    uint64 capacity = sizeof(chunk);
+    uint64 used = 0;
+    const uint8 * next = (const uint8*)data;
+    z_stream * zstream = 0;
+    if ( stream->status != ws_deflate_ok ) {
+        return;
+    }
+    // control frames can be neither compressed nor fragmented.
+    if ((type == ws_ping) || (type == ws_pong) || (type == ws_kill))
+    {
+        ws_owire_new_frame(wire, type, size, 1, 0);
+        ws_owire_feed(wire, data, size);
+        ws_owire_end_frame(wire);
+        return;
+    }
+    if ((type != ws_text) && (type != ws_data)) {
+        return;
+    }
+    zstream = _ws_deflate_deflater(stream);
+    if ( zstream == 0 ) {
+        return;
+    }
+    // use the application's buffer, when large enough.
+    if ((stream->buffer != 0) && (stream->buffer_size >= 64)) {
+        output = (uint8*)stream->buffer;
+        capacity = MIN(stream->buffer_size, 0x40000000);
+    }
+    do {
+        const uInt part = (uInt)MIN(size, 0x40000000);
+        zstream->next_in = (Bytef*)next;
+        zstream->avail_in = part;
+        next += part, size -= part;
+        for (;;)
+        {
+            int result = 0;
+            zstream->next_out = output + used;
+            zstream->avail_out = (uInt)(capacity - used);
+            result = deflate(zstream, (size > 0)? Z_NO_FLUSH : Z_SYNC_FLUSH);
+            if ((result != Z_OK) && (result != Z_BUF_ERROR)) {
+                stream->status = ws_deflate_no_memory;
+                return;
+            }
+            used = capacity - zstream->avail_out;
+            if ( used < capacity ) {
+                break;
+            }
+            // buffer full: send it, except the (potential) trailer.
+            _ws_deflate_send(wire, type, output, used-4, 0);
+            memmove(output, output+used-4, 4), used = 4;
+            type = ws_same;
+        }
+    }
+    while ( size > 0 );
+
+    // strip the trailer, the peer will restore it.
+    _ws_deflate_send(wire, type, output, used-4, 1);
+    if ( _ws_deflate_pooled_self(stream) ) {
+        _ws_deflate_return(stream, zstream, 1);
+        stream->deflater = 0;
+    }
+    else if ( _ws_deflate_self_resets(stream) ) {
+        deflateReset(zstream);
+    }
+}
+
+#endif
@@ -0,0 +1,503 @@
+#ifndef _deflate_h__
+#define _deflate_h__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file deflate.h
+ * @brief Web Socket per-message compression extension for C.
+ *
+ * This implements the "permessage-deflate" extension on top of the wire
+ * protocol objects.  Compressed messages have the RSV1 bit set on their first
+ * fragment (extension code 0x4).  Enable it on the parser by setting 0x4 in
+ * @c ws_iwire::extension_mask.
+ *
+ * @note This part of the library requires zlib.  It is only compiled when
+ *  zlib is found at configuration time (@c WS_HAVE_ZLIB is then defined).
+ *  The rest of the library has no dependencies.
+ *
+ * @see http://tools.ietf.org/html/rfc7692
+ */
+
+#include "types.h"
+#include "owire.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * @def WS_DEFLATE_EXTENSION
+ * @brief Extension code (RSV1) of compressed messages.
+ */
+#define WS_DEFLATE_EXTENSION 0x4
+
+/*!
+ * @brief Compression error codes.
+ */
+typedef enum ws_deflate_status
+{
+    /*!
+     * @brief Normal state, no error.
+     */
+    ws_deflate_ok,
+
+    /*!
+     * @brief The allocator failed, or @c ws_deflate::memory_limit was
+     *  reached.
+     */
+    ws_deflate_no_memory,
+
+    /*!
+     * @brief A compressed message contains invalid data.
+     */
+    ws_deflate_corrupt,
+
+    /*!
+     * @brief Negotiated parameters are out of range.
+     */
+    ws_deflate_invalid_params,
+
+    /*!
+     * @brief All contexts in the pool are lent to other connections.
+     *
+     * @see ws_deflate_pool::capacity
+     */
+    ws_deflate_exhausted,
+
+} ws_deflate_status;
+
+/*!
+ * @brief Extension parameters, as negotiated during the handshake.
+ *
+ * Window sizes are base-2 logarithms, in the range [8, 15].  A value of 0
+ * means the parameter was not specified (in which case the peer may use the
+ * largest window, 15).
+ *
+ * @see ws_deflate_parse()
+ * @see ws_deflate_format()
+ */
+struct ws_deflate_params
+{
+    /*!
+     * @brief The server resets its compression context after each message.
+     */
+    int server_no_context_takeover;
+
+    /*!
+     * @brief The client resets its compression context after each message.
+     */
+    int client_no_context_takeover;
+
+    /*!
+     * @brief Server's LZ77 sliding window size.
+     */
+    int server_max_window_bits;
+
+    /*!
+     * @brief Client's LZ77 sliding window size.  In an offer, -1 means the
+     *  parameter was present without a value (the client supports it).
+     */
+    int client_max_window_bits;
+};
+
+/*!
+ * @brief Compression contexts shared by many connections.
+ *
+ * Connections that negotiated "no context takeover" only need zlib state
+ * while they process a message.  When @c ws_deflate::pool is set, such
+ * connections borrow a context from the pool when a message starts and
+ * return it when the message ends, so memory use depends on the number of
+ * messages being processed rather than on the number of open connections.
+ *
+ * All contexts use the same window size.  Servers should limit the
+ * negotiated window sizes to @c window_bits (see @c ws_deflate_accept()).
+ *
+ * @see ws_deflate::pool
+ */
+struct ws_deflate_pool
+{
+    /*!
+     * @public
+     * @brief Callback allocating zlib state.
+     *
+     * Defaults to @c malloc().
+     */
+    void*(*alloc)(struct ws_deflate_pool*,uint64);
+
+    /*!
+     * @public
+     * @brief Callback releasing zlib state.
+     *
+     * Defaults to @c free().
+     */
+    void(*release)(struct ws_deflate_pool*,void*);
+
+    /*!
+     * @public
+     * @brief External state reserved for use by application callbacks.
+     */
+    void * baton;
+
+    /*!
+     * @public
+     * @brief LZ77 sliding window size of all contexts, in [9, 15].
+     */
+    int window_bits;
+
+    /*!
+     * @public
+     * @brief Compression level, from 1 (fastest) to 9 (smallest), or -1
+     *  (the default) for zlib's default level, currently 6.
+     */
+    int level;
+
+    /*!
+     * @public
+     * @brief Maximum number of contexts (of both kinds), 0 for no limit.
+     */
+    uint64 capacity;
+
+    /*!
+     * @public
+     * @brief Number of contexts allocated (lent or idle).
+     */
+    uint64 contexts;
+
+    /*!
+     * @public
+     * @brief Number of contexts currently lent to connections.
+     */
+    uint64 in_use;
+
+    /*!
+     * @public
+     * @brief Largest value reached by @c in_use.
+     */
+    uint64 peak;
+
+    /*!
+     * @public
+     * @brief Number of times a context was lent.
+     */
+    uint64 loans;
+
+    /*!
+     * @public
+     * @brief Number of times a connection was refused a context.
+     */
+    uint64 misses;
+
+    /*!
+     * @public
+     * @brief Number of bytes of zlib state currently allocated.
+     */
+    uint64 memory;
+
+    /*!
+     * @private
+     * @brief Idle compression contexts.
+     */
+    void * deflaters;
+
+    /*!
+     * @private
+     * @brief Idle decompression contexts.
+     */
+    void * inflaters;
+};
+
+/*!
+ * @brief Per-connection compression state.
+ *
+ * The compression and decompression contexts are allocated on first use,
+ * through the @c alloc and @c release callbacks.  Each context is about
+ * (1 << (window+2)) bytes plus internal tables for compression, and
+ * (1 << window) bytes plus a few kilobytes for decompression.  Use the
+ * negotiated window sizes and @c memory_limit to bound per-connection memory.
+ *
+ * Decompressed data is forwarded to @c accept_content.  Compressed data is
+ * sent through a @c ws_owire writer.
+ */
+struct ws_deflate
+{
+    /*!
+     * @public
+     * @brief Callback allocating zlib state.
+     *
+     * Defaults to @c malloc().
+     */
+    void*(*alloc)(struct ws_deflate*,uint64);
+
+    /*!
+     * @public
+     * @brief Callback releasing zlib state.
+     *
+     * Defaults to @c free().
+     */
+    void(*release)(struct ws_deflate*,void*);
+
+    /*!
+     * @public
+     * @brief Callback that accepts decompressed message content.
+     */
+    void(*accept_content)(struct ws_deflate*,const void*,uint64);
+
+    /*!
+     * @public
+     * @brief External state reserved for use by application callbacks.
+     */
+    void * baton;
+
+    /*!
+     * @public
+     * @brief Negotiated extension parameters.
+     *
+     * @warning Must not be changed after the first message is processed.
+     */
+    struct ws_deflate_params params;
+
+    /*!
+     * @public
+     * @brief 1 for the server end of the connection, 0 for the client.
+     *
+     * Determines which of the parameters apply to compression and which apply
+     * to decompression.
+     */
+    int server;
+
+    /*!
+     * @public
+     * @brief Compression level, from 1 (fastest) to 9 (smallest), or -1
+     *  (the default) for zlib's default level, currently 6.
+     *
+     * Contexts borrowed from @c pool use the pool's level.
+     */
+    int level;
+
+    /*!
+     * @public
+     * @brief Maximum number of bytes of zlib state, 0 for no limit.
+     */
+    uint64 memory_limit;
+
+    /*!
+     * @public
+     * @brief Application buffer for compressed output.
+     *
+     * Compressed messages larger than this buffer are sent in many fragments.
+     * When not set, a small buffer on the stack is used.
+     */
+    void * buffer;
+
+    /*!
+     * @public
+     * @brief Number of bytes in @a buffer.
+     */
+    uint64 buffer_size;
+
+    /*!
+     * @public
+     * @brief Current status, check after each call.
+     */
+    ws_deflate_status status;
+
+    /*!
+     * @public
+     * @brief Number of bytes of zlib state currently allocated.
+     */
+    uint64 memory;
+
+    /*!
+     * @public
+     * @brief Optional pool lending contexts to connections that negotiated
+     *  "no context takeover".
+     *
+     * Contexts for directions with context takeover are still allocated with
+     * @c alloc.  Must not be changed after the first message is processed.
+     */
+    struct ws_deflate_pool * pool;
+
+    /*!
+     * @private
+     * @brief Compression context (opaque zlib stream).
+     */
+    void * deflater;
+
+    /*!
+     * @private
+     * @brief Decompression context (opaque zlib stream).
+     */
+    void * inflater;
+
+    /*!
+     * @private
+     * @brief 1 if the message being decompressed is compressed.
+     */
+    int compressed;
+
+    /*!
+     * @private
+     * @brief 1 once the message being decompressed ended with a final block.
+     */
+    int ended;
+};
+
+/*!
+ * @brief Initialize a context pool.
+ * @param pool Uninitialized pool.
+ *
+ * Invoking this function clears @e all state, including application callbacks.
+ */
+void ws_deflate_pool_init ( struct ws_deflate_pool * pool );
+
+/*!
+ * @brief Release all idle contexts.
+ * @param pool Current pool state.
+ *
+ * @warning Contexts lent to connections are not released.  Call
+ *  @c ws_deflate_clear() on all connections using the pool first.
+ */
+void ws_deflate_pool_clear ( struct ws_deflate_pool * pool );
+
+/*!
+ * @brief Initialize a compression state.
+ * @param stream Uninitialized compression state.
+ *
+ * Invoking this function clears @e all state, including application callbacks.
+ * Call @c ws_deflate_clear() to release zlib state before re-initializing.
+ */
+void ws_deflate_init ( struct ws_deflate * stream );
+
+/*!
+ * @brief Release all zlib state.
+ * @param stream Current compression state.
+ *
+ * Contexts borrowed from @c ws_deflate::pool are returned to the pool.
+ */
+void ws_deflate_clear ( struct ws_deflate * stream );
+
+/*!
+ * @brief Parse a "Sec-WebSocket-Extensions" header value.
+ * @param data Header value.  Accessing past @a size bytes in this array results
+ *  in undefined behavior.
+ * @param size Number of bytes in @a data.
+ * @param params Receives the parameters of the first valid
+ *  "permessage-deflate" offer (or response).
+ * @return 1 if a valid offer was found, else 0.
+ *
+ * Offers with unknown or duplicate parameters, or out of range window sizes
+ * are skipped, as required by RFC7692.
+ */
+int ws_deflate_parse ( const char * data, uint64 size,
+                       struct ws_deflate_params * params );
+
+/*!
+ * @brief Select parameters to accept a client's offer.
+ * @param offer Parameters offered by the client.
+ * @param limits Server policy: context takeover flags that are set are
+ *  required, window sizes are upper bounds (0 for no limit).
+ * @param params Receives the parameters to respond with.
+ * @return 1 if the offer can be accepted, else 0.
+ *
+ * @see ws_deflate_format()
+ */
+int ws_deflate_accept ( const struct ws_deflate_params * offer,
+                        const struct ws_deflate_params * limits,
+                        struct ws_deflate_params * params );
+
+/*!
+ * @brief Check the parameters of a server's response to our offer.
+ * @param response Parameters parsed from the server's response.
+ * @return 1 if the client can use these parameters, else 0.
+ *
+ * zlib can't compress with 256-byte windows, so responses that limit the
+ * client's window to 8 bits are refused, just like @c ws_deflate_accept()
+ * refuses such offers.  The client must then fail the connection.
+ */
+int ws_deflate_confirm ( const struct ws_deflate_params * response );
+
+/*!
+ * @brief Format a "Sec-WebSocket-Extensions" header value.
+ * @param params Parameters to advertise.
+ * @param data Buffer that receives the header value.
+ * @param size Number of bytes in @a data.  128 bytes is always enough.
+ * @return The number of bytes written to @a data, or 0 if the buffer is too
+ *  small.  The value is @e not null-terminated.
+ */
+uint64 ws_deflate_format ( const struct ws_deflate_params * params,
+                           char * data, uint64 size );
+
+/*!
+ * @brief Start processing an in-bound message.
+ * @param stream Current compression state.
+ * @param compressed 1 if the message's first frame has the RSV1 bit set.
+ *
+ * Uncompressed messages are forwarded as is.
+ *
+ * @see ws_iwire_extension()
+ */
+void ws_deflate_new_message ( struct ws_deflate * stream, int compressed );
+
+/*!
+ * @brief Decompress in-bound message content.
+ * @param stream Current compression state.
+ * @param data Message payload (unmasked).  Accessing past @a size bytes in
+ *  this array results in undefined behavior.
+ * @param size Number of bytes in @a data.
+ */
+void ws_deflate_inflate ( struct ws_deflate * stream,
+                          const void * data, uint64 size );
+
+/*!
+ * @brief Finish processing an in-bound message.
+ * @param stream Current compression state.
+ */
+void ws_deflate_end_message ( struct ws_deflate * stream );
+
+/*!
+ * @brief Compress and send a complete message.
+ * @param stream Current compression state.
+ * @param wire Writer through which the compressed message is sent.
+ * @param type Message type.  Only @c ws_text and @c ws_data messages are
+ *  compressed: control messages are sent as is, in a single frame, and
+ *  other types are ignored.
+ * @param data Message payload.  Accessing past @a size bytes in this array
+ *  results in undefined behavior.
+ * @param size Number of bytes in @a data.
+ *
+ * The message is sent in one frame if the compressed payload fits in
+ * @c ws_deflate::buffer, else in many fragments.
+ */
+void ws_deflate_put ( struct ws_deflate * stream, struct ws_owire * wire,
+                      ws_type type, const void * data, uint64 size );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _deflate_h__ */
@@ -0,0 +1,156 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file frame.c
+ * @brief Web Socket frame views (in-bound, pull-style) for C.
+ *
+ * @see http://tools.ietf.org/html/rfc6455#section-5.2
+ */
+
+#include "frame.h"
+#include "iwire.h"
+#include <string.h>
+
+/*!
+ * @internal
+ * @brief Load a 16-bit big endian integer from an unaligned address.
+ */
+static uint16 _ws_load16 ( const uint8 * data )
+{
+    return ((uint16)(((uint16)data[0] << 8) | ((uint16)data[1] << 0)));
+}
+
+/*!
+ * @internal
+ * @brief Load a 64-bit big endian integer from an unaligned address.
+ */
+static uint64 _ws_load64 ( const uint8 * data )
+{
+#if defined(__GNUC__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    uint64 value = 0;
+    memcpy(&value, data, 8);
+    return (__builtin_bswap64(value));
+#elif defined(_MSC_VER)
+    uint64 value = 0;
+    memcpy(&value, data, 8);
+    return (_byteswap_uint64(value));
+#else
+    return (((uint64)data[0] << 56)
+           |((uint64)data[1] << 48)
+           |((uint64)data[2] << 40)
+           |((uint64)data[3] << 32)
+           |((uint64)data[4] << 24)
+           |((uint64)data[5] << 16)
+           |((uint64)data[6] <<  8)
+           |((uint64)data[7] <<  0));
+#endif
+}
+
+ws_frame_status ws_frame_head ( const void * data, uint64 size,
+                                struct ws_frame * frame, uint64 * need )
+{
+    const uint8 *const head = (const uint8*)data;
+    uint64 used = 2;
+    *need = 0;
+    if ( size < 2 ) {
+        return (*need = 2-size, ws_frame_partial);
+    }
+    // parse fields.
+    frame->last = ((head[0] & 0x80) != 0);
+    frame->extension = ((head[0] & 0x70) >> 4);
+    frame->opcode = ((head[0] & 0x0f) >> 0);
+    frame->masked = ((head[1] & 0x80) != 0);
+    frame->size = ((head[1] & 0x7f) >> 0);
+    // compute header size.
+    used += (frame->size == 126)? 2 : (frame->size == 127)? 8 : 0;
+    used += frame->masked? 4 : 0;
+    if ( size < used ) {
+        return (*need = used-size, ws_frame_partial);
+    }
+    // parse extended size and mask.
+    if ( frame->size == 126 ) {
+        frame->size = _ws_load16(head+2);
+    }
+    else if ( frame->size == 127 ) {
+        frame->size = _ws_load64(head+2);
+    }
+    if ( frame->masked ) {
+        memcpy(frame->mask, head+used-4, 4);
+    }
+    frame->start = 0;
+    frame->offset = used;
+    // check for invalid frames.
+    if ((frame->opcode != 0) && !ws_known_message_type(frame->opcode)) {
+        return (ws_frame_unknown_message_type);
+    }
+    if ((frame->opcode & 0x08) && (!frame->last || (frame->size > 125))) {
+        return (ws_frame_invalid_control);
+    }
+    if ((frame->size >> 63) != 0) {
+        return (ws_frame_invalid_size);
+    }
+    return (ws_frame_ok);
+}
+
+ws_frame_status ws_frame_next ( const void * data, uint64 size,
+                                struct ws_frame * frame, uint64 * need )
+{
+    const ws_frame_status status = ws_frame_head(data, size, frame, need);
+    if ( status != ws_frame_ok ) {
+        return (status);
+    }
+    // make sure the payload is complete.
+    if ( frame->size > (size - frame->offset) ) {
+        return (*need = frame->size-(size-frame->offset), ws_frame_partial);
+    }
+    return (ws_frame_ok);
+}
+
+ws_frame_status ws_frame_scan ( const void * data, uint64 size,
+                                struct ws_frame * frames, uint64 capacity,
+                                uint64 * count, uint64 * used, uint64 * need )
+{
+    const uint8 *const base = (const uint8*)data;
+    ws_frame_status status = ws_frame_ok;
+    *count = 0;
+    *used = 0;
+    *need = 0;
+    while ((*count < capacity) && (*used < size))
+    {
+        struct ws_frame *const frame = &frames[*count];
+        status = ws_frame_next(base+*used, size-*used, frame, need);
+        if ( status != ws_frame_ok ) {
+            break;
+        }
+        // make positions relative to the start of the buffer.
+        frame->start = *used;
+        frame->offset += *used;
+        *used = frame->offset + frame->size;
+        ++*count;
+    }
+    return (status);
+}
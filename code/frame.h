@@ -0,0 +1,195 @@
+#ifndef _frame_h__
+#define _frame_h__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file frame.h
+ * @brief Web Socket frame views (in-bound, pull-style) for C.
+ *
+ * @see http://tools.ietf.org/html/rfc6455#section-5.2
+ */
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * @brief Frame view error codes.
+ */
+typedef enum ws_frame_status
+{
+    /*!
+     * @brief A complete frame was decoded.
+     */
+    ws_frame_ok,
+
+    /*!
+     * @brief The frame is incomplete, more data is required.
+     */
+    ws_frame_partial,
+
+    /*!
+     * @brief A frame containing an unknown message type was detected.
+     */
+    ws_frame_unknown_message_type,
+
+    /*!
+     * @brief A control frame is fragmented or has a payload larger than 125
+     *  bytes (see RFC6455, section 5.5).
+     */
+    ws_frame_invalid_control,
+
+    /*!
+     * @brief A frame size has the most significant bit set (see RFC6455,
+     *  section 5.2).
+     */
+    ws_frame_invalid_size,
+
+} ws_frame_status;
+
+/*!
+ * @brief Description of a frame, referring to the application's buffer.
+ *
+ * Frame views never copy (nor unmask) any data.  They merely describe where
+ * the frame payload lies in the buffer that was decoded.
+ *
+ * @see ws_frame_scan()
+ */
+struct ws_frame
+{
+    /*!
+     * @brief Message type (0 for continuation frames).
+     */
+    int opcode;
+
+    /*!
+     * @brief 1 if the frame ends the message, else 0.
+     */
+    int last;
+
+    /*!
+     * @brief Extension field, 3-bit value (RSV1 is the most significant bit).
+     */
+    int extension;
+
+    /*!
+     * @brief 1 if the frame's payload is masked, else 0.
+     */
+    int masked;
+
+    /*!
+     * @brief Frame mask.  Contents are undefined if @c masked is 0.
+     *
+     * @see ws_mask_apply()
+     */
+    uint8 mask[4];
+
+    /*!
+     * @brief Position of the frame's first byte in the buffer.
+     */
+    uint64 start;
+
+    /*!
+     * @brief Position of the frame's payload in the buffer.
+     */
+    uint64 offset;
+
+    /*!
+     * @brief Size of the frame's payload, in bytes.
+     */
+    uint64 size;
+};
+
+/*!
+ * @brief Decode a frame header.
+ * @param data Array of bytes starting with a frame header.  Accessing past
+ *  @a size bytes in this array results in undefined behavior.
+ * @param size Number of bytes in @a data.
+ * @param frame Receives the frame description.  The @c start field is set to
+ *  0.
+ * @param need Receives the number of bytes missing to complete the header.
+ *  Set to 0 unless @c ws_frame_partial is returned.
+ * @return @c ws_frame_ok if the header is complete, even if the payload isn't.
+ *
+ * @see ws_frame_next()
+ */
+ws_frame_status ws_frame_head ( const void * data, uint64 size,
+                                struct ws_frame * frame, uint64 * need );
+
+/*!
+ * @brief Decode a complete frame.
+ * @param data Array of bytes starting with a frame header.  Accessing past
+ *  @a size bytes in this array results in undefined behavior.
+ * @param size Number of bytes in @a data.
+ * @param frame Receives the frame description.  The @c start field is set to
+ *  0.
+ * @param need Receives the number of bytes missing to complete the frame
+ *  (or its header, if the header is incomplete).  Set to 0 unless
+ *  @c ws_frame_partial is returned.
+ * @return @c ws_frame_ok if the frame, including its payload, is complete.
+ *
+ * @see ws_frame_head()
+ */
+ws_frame_status ws_frame_next ( const void * data, uint64 size,
+                                struct ws_frame * frame, uint64 * need );
+
+/*!
+ * @brief Decode all complete frames in a buffer.
+ * @param data Array of bytes starting with a frame header.  Accessing past
+ *  @a size bytes in this array results in undefined behavior.
+ * @param size Number of bytes in @a data.
+ * @param frames Array that receives frame descriptions.
+ * @param capacity Number of frame descriptions @a frames can hold.
+ * @param count Receives the number of frames stored in @a frames.
+ * @param used Receives the number of bytes spanned by those frames.  The
+ *  application should consume these bytes, then keep the rest of the buffer
+ *  and call again when more data is available.
+ * @param need Receives the number of bytes missing to complete the next frame.
+ *  Set to 0 unless @c ws_frame_partial is returned.
+ * @return @c ws_frame_ok if all frames in the buffer were decoded or if
+ *  @a capacity was reached, @c ws_frame_partial if the buffer ends with a
+ *  partial frame, or an error code.  Frames stored before an error are valid.
+ *
+ * This function is stateless: it doesn't check that the sequence of frames
+ * makes sense (e.g. message types of fragmented messages), nor that extension
+ * fields are negotiated.  Applications that route frames without looking at
+ * their payload can use this to forward complete frames without copying them.
+ *
+ * @see ws_frame_next()
+ */
+ws_frame_status ws_frame_scan ( const void * data, uint64 size,
+                                struct ws_frame * frames, uint64 capacity,
+                                uint64 * count, uint64 * used, uint64 * need );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _frame_h__ */
@@ -0,0 +1,464 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file handshake.c
+ * @brief Web Socket opening handshake (HTTP upgrade) for C.
+ *
+ * @see http://tools.ietf.org/html/rfc6455#section-4
+ */
+
+#include "handshake.h"
+
+#include <string.h>
+
+/*!
+ * @internal
+ * @brief Parser states.
+ */
+enum
+{
+    _ws_handshake_line,
+    _ws_handshake_name,
+    _ws_handshake_space,
+    _ws_handshake_value,
+    _ws_handshake_done,
+};
+
+/*!
+ * @internal
+ * @brief Required headers (bits in @c ws_handshake::seen).
+ */
+enum
+{
+    _ws_handshake_upgrade    = 0x1,
+    _ws_handshake_connection = 0x2,
+    _ws_handshake_version    = 0x4,
+    _ws_handshake_key        = 0x8,
+};
+
+/*!
+ * @internal
+ * @brief Compare ASCII strings, ignoring case.
+ */
+static int _ws_handshake_ieq ( const char * lhs, const char * rhs,
+                               uint64 size )
+{
+    uint64 i = 0;
+    for ( ; i < size; ++i )
+    {
+        char a = lhs[i];
+        char b = rhs[i];
+        a = ((a >= 'A') && (a <= 'Z'))? (char)(a-'A'+'a') : a;
+        b = ((b >= 'A') && (b <= 'Z'))? (char)(b-'A'+'a') : b;
+        if ( a != b ) {
+            return (0);
+        }
+    }
+    return (1);
+}
+
+/*!
+ * @internal
+ * @brief Check if a comma-separated list contains @a token, ignoring case.
+ */
+static int _ws_handshake_token ( const char * list, const char * token )
+{
+    const uint64 size = strlen(token);
+    const char * lower = list;
+    const char * upper = list;
+    const char * end = list;
+    while ( *lower != '\0' )
+    {
+        while ((*lower == ' ') || (*lower == '\t') || (*lower == ',')) {
+            ++lower;
+        }
+        upper = lower;
+        while ((*upper != '\0') && (*upper != ',')) {
+            ++upper;
+        }
+        // item ends at the first white space.
+        end = lower;
+        while ((end < upper) && (*end != ' ') && (*end != '\t')) {
+            ++end;
+        }
+        if (((uint64)(end-lower) == size) &&
+            _ws_handshake_ieq(lower, token, size)) {
+            return (1);
+        }
+        lower = upper;
+    }
+    return (0);
+}
+
+/*!
+ * @internal
+ * @brief Check if the handshake needs the value of header @a name.
+ */
+static int _ws_handshake_kept ( const char * name )
+{
+    const uint64 size = strlen(name);
+    return (((size ==  4) && _ws_handshake_ieq(name, "host", 4)) ||
+            ((size ==  7) && _ws_handshake_ieq(name, "upgrade", 7)) ||
+            ((size == 10) && _ws_handshake_ieq(name, "connection", 10)) ||
+            ((size >= 14) && _ws_handshake_ieq(name, "sec-websocket-", 14)));
+}
+
+/*!
+ * @internal
+ * @brief Check if @a text is the base64 encoding of 16 bytes.
+ */
+static int _ws_handshake_nonce ( const char * text )
+{
+    int i = 0;
+    for ( ; i < 22; ++i )
+    {
+        const char c = text[i];
+        if (!(((c >= 'A') && (c <= 'Z')) || ((c >= 'a') && (c <= 'z')) ||
+              ((c >= '0') && (c <= '9')) || (c == '+') || (c == '/'))) {
+            return (0);
+        }
+    }
+    return ((text[22] == '=') && (text[23] == '=') && (text[24] == '\0'));
+}
+
+/*!
+ * @internal
+ * @brief Check the request line (server) or status line (client).
+ */
+static void _ws_handshake_line_done ( struct ws_handshake * handshake )
+{
+    const char *const line = handshake->text;
+    const uint64 size = (uint64)handshake->size;
+    if ( handshake->accept_line ) {
+        handshake->accept_line(handshake, line);
+    }
+    if ( handshake->client )
+    {
+        // "HTTP/1.1 101 Switching Protocols"
+        if ((size < 12) || (memcmp(line, "HTTP/1.1 ", 9) != 0)) {
+            handshake->status = ws_handshake_malformed;
+        }
+        else if ( memcmp(line+9, "101", 3) != 0 ) {
+            handshake->status = ws_handshake_rejected;
+        }
+        return;
+    }
+    // "GET /path HTTP/1.1"
+    if ((size < 14) || (memcmp(line, "GET ", 4) != 0) ||
+        (memcmp(line+size-9, " HTTP/1.1", 9) != 0)) {
+        handshake->status = ws_handshake_malformed;
+    }
+}
+
+/*!
+ * @internal
+ * @brief Interpret the header that was just parsed.
+ */
+static void _ws_handshake_header_done ( struct ws_handshake * handshake )
+{
+    const char *const name = handshake->name;
+    const char *const value = handshake->text;
+    const uint64 size = strlen(name);
+    if ( handshake->accept_header ) {
+        handshake->accept_header(handshake, name, value);
+    }
+    if ((size == 7) && _ws_handshake_ieq(name, "upgrade", 7))
+    {
+        if ( _ws_handshake_token(value, "websocket") ) {
+            handshake->seen |= _ws_handshake_upgrade;
+        }
+    }
+    else if ((size == 10) && _ws_handshake_ieq(name, "connection", 10))
+    {
+        if ( _ws_handshake_token(value, "upgrade") ) {
+            handshake->seen |= _ws_handshake_connection;
+        }
+    }
+    else if ( handshake->client )
+    {
+        if ((size == 20) &&
+            _ws_handshake_ieq(name, "sec-websocket-accept", 20) &&
+            (strlen(value) == 28))
+        {
+            memcpy(handshake->key, value, 29);
+            handshake->seen |= _ws_handshake_key;
+        }
+    }
+    else if ((size == 21) &&
+             _ws_handshake_ieq(name, "sec-websocket-version", 21))
+    {
+        if ( strcmp(value, "13") == 0 ) {
+            handshake->seen |= _ws_handshake_version;
+        }
+    }
+    else if ((size == 17) &&
+             _ws_handshake_ieq(name, "sec-websocket-key", 17))
+    {
+        if ( _ws_handshake_nonce(value) ) {
+            memcpy(handshake->key, value, 25);
+            handshake->seen |= _ws_handshake_key;
+        }
+    }
+}
+
+/*!
+ * @internal
+ * @brief Check that all required headers were present.
+ */
+static void _ws_handshake_head_done ( struct ws_handshake * handshake )
+{
+    const int upgrade = _ws_handshake_upgrade|_ws_handshake_connection;
+    handshake->state = _ws_handshake_done;
+    if ((handshake->seen & upgrade) != upgrade) {
+        handshake->status = ws_handshake_not_upgrade;
+    }
+    else if (!handshake->client &&
+             ((handshake->seen & _ws_handshake_version) == 0)) {
+        handshake->status = ws_handshake_bad_version;
+    }
+    else if ((handshake->seen & _ws_handshake_key) == 0) {
+        handshake->status = ws_handshake_bad_key;
+    }
+}
+
+/*!
+ * @internal
+ * @brief Append one byte to the start line, header name or value.
+ */
+static void _ws_handshake_push ( struct ws_handshake * handshake,
+                                 char * text, char c )
+{
+    if ( handshake->size < WS_HANDSHAKE_TEXT ) {
+        text[handshake->size++] = c;
+        return;
+    }
+    if ( handshake->state == _ws_handshake_line )
+    {
+        // keep the protocol version at the end of long request targets.
+        memmove(text+WS_HANDSHAKE_TEXT-9, text+WS_HANDSHAKE_TEXT-8, 8);
+        text[WS_HANDSHAKE_TEXT-1] = c;
+    }
+    else if ((handshake->state == _ws_handshake_value) && handshake->keep) {
+        handshake->status = ws_handshake_too_large;
+    }
+    // other names and values are truncated.
+}
+
+/*!
+ * @internal
+ * @brief Append a string to a fixed-size buffer.
+ */
+static uint64 _ws_handshake_append ( char * data, uint64 size, uint64 used,
+                                     const char * text )
+{
+    const uint64 length = (text == 0)? 0 : strlen(text);
+    if ( used+length > size ) {
+        return (size+1);
+    }
+    memcpy(data+used, text, length);
+    return (used+length);
+}
+
+void ws_handshake_init ( struct ws_handshake * handshake )
+{
+    handshake->accept_line   = 0;
+    handshake->accept_header = 0;
+    handshake->baton         = 0;
+    handshake->limit         = 8*1024;
+    handshake->status        = ws_handshake_ok;
+    handshake->client        = 0;
+    handshake->state         = _ws_handshake_line;
+    handshake->used          = 0;
+    handshake->seen          = 0;
+    handshake->keep          = 0;
+    handshake->name[0]       = '\0';
+    handshake->text[0]       = '\0';
+    handshake->size          = 0;
+    handshake->key[0]        = '\0';
+}
+
+uint64 ws_handshake_feed ( struct ws_handshake * handshake,
+                           const void * data, uint64 size )
+{
+    const char *const text = (const char*)data;
+    uint64 used = 0;
+    while ((used < size) && !ws_handshake_done(handshake))
+    {
+        const char c = text[used++];
+        if ( ++handshake->used > handshake->limit ) {
+            handshake->status = ws_handshake_too_large;
+            break;
+        }
+        // line breaks are LF, ignore the CR that precedes it.
+        if ( c == '\r' ) {
+            continue;
+        }
+        switch ( handshake->state )
+        {
+        case _ws_handshake_line:
+            if ((c == '\n') && (handshake->size == 0)) {
+                // ignore empty lines before the start line.
+            }
+            else if ( c == '\n' ) {
+                handshake->text[handshake->size] = '\0';
+                _ws_handshake_line_done(handshake);
+                handshake->state = _ws_handshake_name;
+                handshake->size = 0;
+            }
+            else {
+                _ws_handshake_push(handshake, handshake->text, c);
+            }
+            break;
+        case _ws_handshake_name:
+            if ((c == '\n') && (handshake->size == 0)) {
+                _ws_handshake_head_done(handshake);
+            }
+            else if ((c == ':') && (handshake->size > 0)) {
+                handshake->name[handshake->size] = '\0';
+                handshake->keep = _ws_handshake_kept(handshake->name);
+                handshake->state = _ws_handshake_space;
+                handshake->size = 0;
+            }
+            else if ((c == '\n') || (c == ':') || (c == ' ') || (c == '\t')) {
+                // no folded headers, no white space in names.
+                handshake->status = ws_handshake_malformed;
+            }
+            else {
+                _ws_handshake_push(handshake, handshake->name, c);
+            }
+            break;
+        case _ws_handshake_space:
+            if ((c == ' ') || (c == '\t')) {
+                break;
+            }
+            handshake->state = _ws_handshake_value;
+            // fall through.
+        case _ws_handshake_value:
+            if ( c == '\n' )
+            {
+                while ((handshake->size > 0) &&
+                       ((handshake->text[handshake->size-1] == ' ') ||
+                        (handshake->text[handshake->size-1] == '\t'))) {
+                    --handshake->size;
+                }
+                handshake->text[handshake->size] = '\0';
+                _ws_handshake_header_done(handshake);
+                handshake->state = _ws_handshake_name;
+                handshake->size = 0;
+            }
+            else {
+                _ws_handshake_push(handshake, handshake->text, c);
+            }
+            break;
+        }
+    }
+    return (used);
+}
+
+int ws_handshake_done ( const struct ws_handshake * handshake )
+{
+    return ((handshake->state == _ws_handshake_done) ||
+            (handshake->status != ws_handshake_ok));
+}
+
+const char * ws_handshake_key ( const struct ws_handshake * handshake )
+{
+    return (handshake->key);
+}
+
+uint64 ws_handshake_accept ( const struct ws_handshake * handshake,
+                             const char * accept, const char * headers,
+                             char * data, uint64 size )
+{
+    uint64 used = 0;
+    if ( !ws_handshake_done(handshake) ||
+         (handshake->status != ws_handshake_ok) ) {
+        return (0);
+    }
+    used = _ws_handshake_append(data, size, used,
+        "HTTP/1.1 101 Switching Protocols\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: ");
+    used = _ws_handshake_append(data, size, used, accept);
+    used = _ws_handshake_append(data, size, used, "\r\n");
+    used = _ws_handshake_append(data, size, used, headers);
+    used = _ws_handshake_append(data, size, used, "\r\n");
+    return ((used > size)? 0 : used);
+}
+
+uint64 ws_handshake_reject ( const struct ws_handshake * handshake,
+                             char * data, uint64 size )
+{
+    uint64 used = 0;
+    switch ( handshake->status )
+    {
+    case ws_handshake_too_large:
+        used = _ws_handshake_append(data, size, used,
+            "HTTP/1.1 431 Request Header Fields Too Large\r\n");
+        break;
+    case ws_handshake_bad_version:
+        used = _ws_handshake_append(data, size, used,
+            "HTTP/1.1 426 Upgrade Required\r\n");
+        break;
+    default:
+        used = _ws_handshake_append(data, size, used,
+            "HTTP/1.1 400 Bad Request\r\n");
+        break;
+    }
+    used = _ws_handshake_append(data, size, used,
+        "Sec-WebSocket-Version: 13\r\n"
+        "Connection: close\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n");
+    return ((used > size)? 0 : used);
+}
+
+uint64 ws_handshake_request ( struct ws_handshake * handshake,
+                              const char * host, const char * path,
+                              const char * key, const char * headers,
+                              char * data, uint64 size )
+{
+    uint64 used = 0;
+    handshake->client = 1;
+    used = _ws_handshake_append(data, size, used, "GET ");
+    used = _ws_handshake_append(data, size, used, path);
+    used = _ws_handshake_append(data, size, used, " HTTP/1.1\r\nHost: ");
+    used = _ws_handshake_append(data, size, used, host);
+    used = _ws_handshake_append(data, size, used,
+        "\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: ");
+    used = _ws_handshake_append(data, size, used, key);
+    used = _ws_handshake_append(data, size, used,
+        "\r\n"
+        "Sec-WebSocket-Version: 13\r\n");
+    used = _ws_handshake_append(data, size, used, headers);
+    used = _ws_handshake_append(data, size, used, "\r\n");
+    return ((used > size)? 0 : used);
+}
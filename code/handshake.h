@@ -0,0 +1,329 @@
+#ifndef _handshake_h__
+#define _handshake_h__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file handshake.h
+ * @brief Web Socket opening handshake (HTTP upgrade) for C.
+ *
+ * The handshake object parses an HTTP upgrade request (server side) or
+ * response (client side) incrementally, one buffer at a time, as bytes
+ * arrive on a non-blocking socket.  It keeps only the few header values the
+ * protocol needs, in fixed-size fields, and formats its own messages into
+ * buffers supplied by the application.  It never allocates memory.
+ *
+ * Bytes that follow the HTTP message head belong to the wire protocol: feed
+ * them to a @c ws_iwire.
+ *
+ * @see http://tools.ietf.org/html/rfc6455#section-4
+ */
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * @def WS_HANDSHAKE_TEXT
+ * @brief Longest start line, header name or header value kept, in bytes.
+ *
+ * Longer start lines keep their beginning and their protocol version, and
+ * the middle of the request target is dropped.  Longer names and values of
+ * headers the handshake doesn't interpret (e.g. `Cookie`) are truncated.
+ * Only the values of `Host`, `Upgrade`, `Connection` and `Sec-WebSocket-*`
+ * headers must fit.
+ */
+#define WS_HANDSHAKE_TEXT 256
+
+/*!
+ * @brief Handshake error codes.
+ */
+enum ws_handshake_status
+{
+    /*!
+     * @brief No error, the handshake is in progress or has completed.
+     */
+    ws_handshake_ok,
+
+    /*!
+     * @brief The HTTP message head is larger than @c ws_handshake::limit, or
+     *  the value of a header the handshake interprets is longer than
+     *  @c WS_HANDSHAKE_TEXT.
+     */
+    ws_handshake_too_large,
+
+    /*!
+     * @brief The data is not a valid HTTP/1.1 message head.
+     */
+    ws_handshake_malformed,
+
+    /*!
+     * @brief The message does not ask for (or approve) an upgrade to the Web
+     *  Socket protocol.
+     */
+    ws_handshake_not_upgrade,
+
+    /*!
+     * @brief The client speaks another version of the protocol.
+     */
+    ws_handshake_bad_version,
+
+    /*!
+     * @brief The client's nonce is missing or is not 16 base64 encoded bytes.
+     */
+    ws_handshake_bad_key,
+
+    /*!
+     * @brief The server answered with another status code than 101.
+     */
+    ws_handshake_rejected,
+};
+
+/*!
+ * @brief Handshake error code.
+ */
+typedef enum ws_handshake_status ws_handshake_status;
+
+/*!
+ * @brief Incremental parser and formatter for the opening handshake.
+ *
+ * Servers feed the client's request and, once @c ws_handshake_done()
+ * reports success, format the response with @c ws_handshake_accept().
+ * Clients format their request with @c ws_handshake_request() first, then
+ * feed the server's response.
+ *
+ * @see ws_handshake_feed()
+ */
+struct ws_handshake
+{
+    /*!
+     * @public
+     * @brief Called for each start line, optional.
+     * @param handshake The current handshake state.
+     * @param line Request line (server) or status line (client), without
+     *  the line break, shortened to @c WS_HANDSHAKE_TEXT bytes.  The string
+     *  is only valid during the call.
+     *
+     * @see baton
+     */
+    void(*accept_line)
+        (struct ws_handshake * handshake, const char * line);
+
+    /*!
+     * @public
+     * @brief Called for each header, optional.
+     * @param handshake The current handshake state.
+     * @param name Header name, as sent by the peer.
+     * @param value Header value, without surrounding white space.  Both are
+     *  truncated to @c WS_HANDSHAKE_TEXT bytes.
+     *
+     * Use this to pick up headers the handshake object doesn't interpret,
+     * such as `Sec-WebSocket-Protocol` and `Sec-WebSocket-Extensions`.
+     * Both strings are only valid during the call.
+     *
+     * @see baton
+     */
+    void(*accept_header)
+        (struct ws_handshake * handshake, const char * name, const char * value);
+
+    /*!
+     * @public
+     * @brief External state reserved for use by application callbacks.
+     */
+    void * baton;
+
+    /*!
+     * @public
+     * @brief Largest HTTP message head accepted, in bytes.
+     *
+     * Defaults to 8 KiB.
+     */
+    uint64 limit;
+
+    /*!
+     * @public
+     * @brief The current handshake status.
+     *
+     * This value should be considered as read-only and should never be
+     * modified by applications.
+     */
+    ws_handshake_status status;
+
+    /*!
+     * @internal
+     * @private
+     * @brief 1 when parsing the server's response, 0 for the request.
+     */
+    int client;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Current parser state.
+     */
+    int state;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Bytes of the message head parsed so far.
+     */
+    uint64 used;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Required headers seen so far (bit mask).
+     */
+    int seen;
+
+    /*!
+     * @internal
+     * @private
+     * @brief 1 if the current header's value must fit in @c text, else 0.
+     */
+    int keep;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Current header name, NUL-terminated.
+     */
+    char name[WS_HANDSHAKE_TEXT+1];
+
+    /*!
+     * @internal
+     * @private
+     * @brief Current start line or header value, NUL-terminated.
+     */
+    char text[WS_HANDSHAKE_TEXT+1];
+
+    /*!
+     * @internal
+     * @private
+     * @brief Number of bytes in @c name or @c text.
+     */
+    int size;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Client nonce (server) or server's approval (client).
+     */
+    char key[29];
+};
+
+/*!
+ * @brief Initialize a handshake, ready to parse a client's request.
+ * @param handshake Uninitialized handshake state.
+ */
+void ws_handshake_init ( struct ws_handshake * handshake );
+
+/*!
+ * @brief Parse the next bytes received from the peer.
+ * @param handshake The current handshake state.
+ * @param data Array of bytes received.  Accessing past @a size bytes in this
+ *  array results in undefined behavior.
+ * @param size Number of bytes in @a data.
+ * @return The number of bytes that belong to the HTTP message head.  When
+ *  this is less than @a size, the remaining bytes are Web Socket frames.
+ *
+ * Parsing stops at the end of the message head or at the first error (see
+ * @c ws_handshake::status).  Call again with more data until
+ * @c ws_handshake_done() returns 1.
+ */
+uint64 ws_handshake_feed ( struct ws_handshake * handshake,
+                           const void * data, uint64 size );
+
+/*!
+ * @brief Check if the whole message head was parsed.
+ * @param handshake The current handshake state.
+ * @return 1 if the handshake is over (successfully or not), else 0.
+ */
+int ws_handshake_done ( const struct ws_handshake * handshake );
+
+/*!
+ * @brief Get the key sent by the peer.
+ * @param handshake A handshake that completed successfully.
+ * @return The client's `Sec-WebSocket-Key` (server side) or the server's
+ *  `Sec-WebSocket-Accept` (client side), NUL-terminated.
+ *
+ * Clients must check that the server's value matches the one expected for
+ * their nonce before using the connection.
+ */
+const char * ws_handshake_key ( const struct ws_handshake * handshake );
+
+/*!
+ * @brief Format the server's response that approves the upgrade.
+ * @param handshake A handshake that completed successfully.
+ * @param accept `Sec-WebSocket-Accept` value for the client's key.
+ * @param headers Extra header lines, each terminated by CRLF, or 0.
+ * @param data Buffer receiving the response.
+ * @param size Size of @a data, in bytes.
+ * @return The length of the response, or 0 if @a data is too small or if
+ *  the handshake is not over or failed.
+ */
+uint64 ws_handshake_accept ( const struct ws_handshake * handshake,
+                             const char * accept, const char * headers,
+                             char * data, uint64 size );
+
+/*!
+ * @brief Format the server's response that refuses the upgrade.
+ * @param handshake A handshake that failed.
+ * @param data Buffer receiving the response.
+ * @param size Size of @a data, in bytes.
+ * @return The length of the response, or 0 if @a data is too small.
+ *
+ * The response advertises the protocol version this library speaks.  The
+ * server should close the connection once it has been sent.
+ */
+uint64 ws_handshake_reject ( const struct ws_handshake * handshake,
+                             char * data, uint64 size );
+
+/*!
+ * @brief Format the client's request, then expect the server's response.
+ * @param handshake A freshly initialized handshake state.
+ * @param host Value of the `Host` header.
+ * @param path Requested resource, such as "/".
+ * @param key Base64 encoding of a 16-byte random nonce.
+ * @param headers Extra header lines, each terminated by CRLF, or 0.
+ * @param data Buffer receiving the request.
+ * @param size Size of @a data, in bytes.
+ * @return The length of the request, or 0 if @a data is too small.
+ */
+uint64 ws_handshake_request ( struct ws_handshake * handshake,
+                              const char * host, const char * path,
+                              const char * key, const char * headers,
+                              char * data, uint64 size );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _handshake_h__ */
@@ -0,0 +1,265 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file imessage.c
+ * @brief Web Socket in-bound message reassembly for C.
+ *
+ * @see http://tools.ietf.org/html/rfc6455#section-5.4
+ */
+
+#include "imessage.h"
+
+#include <string.h>
+
+/*!
+ * @internal
+ * @brief Space taken by a chunk's header at the start of its buffer.
+ */
+#define _WS_IMESSAGE_HEAD \
+    ((sizeof(struct ws_imessage_chunk) + (WS_ARENA_ALIGN-1)) & \
+     ~(uint64)(WS_ARENA_ALIGN-1))
+
+/*!
+ * @internal
+ * @brief Maximum of two sizes.
+ */
+static uint64 _ws_imessage_max ( uint64 a, uint64 b )
+{
+    return ((a > b)? a : b);
+}
+
+/*!
+ * @internal
+ * @brief Index of the chain that holds the current message.
+ */
+static int _ws_imessage_index ( const struct ws_iwire * wire )
+{
+    return ((ws_iwire_text(wire) || ws_iwire_data(wire))? 0 : 1);
+}
+
+/*!
+ * @internal
+ * @brief Type of the message that just ended.
+ */
+static ws_type _ws_imessage_type ( const struct ws_iwire * wire )
+{
+    if ( ws_iwire_text(wire) ) {
+        return (ws_text);
+    }
+    if ( ws_iwire_data(wire) ) {
+        return (ws_data);
+    }
+    if ( ws_iwire_ping(wire) ) {
+        return (ws_ping);
+    }
+    if ( ws_iwire_pong(wire) ) {
+        return (ws_pong);
+    }
+    return (ws_kill);
+}
+
+/*!
+ * @internal
+ * @brief Report an error and drop partial messages.
+ */
+static void _ws_imessage_fail ( struct ws_imessage * message,
+                                ws_imessage_status status )
+{
+    message->status = status;
+    ws_imessage_clear(message);
+}
+
+/*!
+ * @internal
+ * @brief Append an empty chunk with room for about @a want bytes.
+ */
+static struct ws_imessage_chunk * _ws_imessage_grow
+    ( struct ws_imessage * message, int index, uint64 want )
+{
+    struct ws_imessage_chunk * chunk;
+    char * block;
+    uint64 size = ws_pool_fit(MIN(want, WS_ARENA_PAGE-_WS_IMESSAGE_HEAD)
+                              + _WS_IMESSAGE_HEAD);
+
+    // settle for a smaller buffer rather than exceed the memory limit.
+    if ( message->max_memory > 0 )
+    {
+        while ((size > 64) && (message->memory+size > message->max_memory)) {
+            size /= 2;
+        }
+        if ( message->memory+size > message->max_memory ) {
+            _ws_imessage_fail(message, ws_imessage_out_of_memory);
+            return (0);
+        }
+    }
+    block = (char*)ws_pool_get(message->pool, size);
+    if ( block == 0 ) {
+        _ws_imessage_fail(message, ws_imessage_out_of_memory);
+        return (0);
+    }
+    message->memory += size;
+
+    chunk = (struct ws_imessage_chunk*)block;
+    chunk->next     = 0;
+    chunk->data     = block + _WS_IMESSAGE_HEAD;
+    chunk->size     = 0;
+    chunk->capacity = size - _WS_IMESSAGE_HEAD;
+    if ( message->chains[index][1] ) {
+        message->chains[index][1]->next = chunk;
+    }
+    else {
+        message->chains[index][0] = chunk;
+    }
+    message->chains[index][1] = chunk;
+    return (chunk);
+}
+
+static void _ws_imessage_new_fragment ( struct ws_iwire * wire, uint64 size )
+{
+    struct ws_imessage *const message = (struct ws_imessage*)wire->baton;
+    const int index = _ws_imessage_index(wire);
+    message->frame = size;
+    if ( message->status != ws_imessage_ok ) {
+        return;
+    }
+    // reject huge frames before buffering any of their payload.
+    if ((message->max_message > 0) &&
+        (size > message->max_message - message->sizes[index]))
+    {
+        _ws_imessage_fail(message, ws_imessage_too_large);
+    }
+}
+
+static void _ws_imessage_accept_content
+    ( struct ws_iwire * wire, const void * data, uint64 size )
+{
+    struct ws_imessage *const message = (struct ws_imessage*)wire->baton;
+    const int index = _ws_imessage_index(wire);
+    const char * next = (const char*)data;
+    if ( message->status != ws_imessage_ok ) {
+        return;
+    }
+    while ( size > 0 )
+    {
+        uint64 used;
+        struct ws_imessage_chunk * chunk = message->chains[index][1];
+        if ((chunk == 0) || (chunk->size == chunk->capacity))
+        {
+            // size buffers after the frame, and grow them geometrically for
+            // messages split in many small frames.
+            chunk = _ws_imessage_grow(message, index,
+                _ws_imessage_max(_ws_imessage_max(message->frame, size),
+                                 message->sizes[index]));
+            if ( chunk == 0 ) {
+                return;
+            }
+        }
+        used = MIN(size, chunk->capacity-chunk->size);
+        memcpy(chunk->data+chunk->size, next, used);
+        chunk->size += used;
+        message->sizes[index] += used;
+        message->frame -= MIN(message->frame, used);
+        next += used, size -= used;
+    }
+}
+
+static void _ws_imessage_end_message ( struct ws_iwire * wire )
+{
+    struct ws_imessage *const message = (struct ws_imessage*)wire->baton;
+    const int index = _ws_imessage_index(wire);
+    struct ws_imessage_chunk *const chain = message->chains[index][0];
+    const uint64 size = message->sizes[index];
+    message->chains[index][0] = message->chains[index][1] = 0;
+    message->sizes[index] = 0;
+    if ((message->status != ws_imessage_ok) ||
+        (message->accept_message == 0))
+    {
+        ws_imessage_release(message, chain);
+        return;
+    }
+    message->accept_message(message, _ws_imessage_type(wire), chain, size);
+}
+
+void ws_imessage_init ( struct ws_imessage * message,
+                        struct ws_iwire * wire, struct ws_pool * pool )
+{
+    message->pool           = pool;
+    message->max_message    = 16*1024*1024;
+    message->max_memory     = 0;
+    message->accept_message = 0;
+    message->baton          = 0;
+    message->status         = ws_imessage_ok;
+    message->memory         = 0;
+    message->chains[0][0]   = message->chains[0][1] = 0;
+    message->chains[1][0]   = message->chains[1][1] = 0;
+    message->sizes[0]       = message->sizes[1] = 0;
+    message->frame          = 0;
+
+    wire->baton          = message;
+    wire->new_message    = 0;
+    wire->end_message    = &_ws_imessage_end_message;
+    wire->new_fragment   = &_ws_imessage_new_fragment;
+    wire->end_fragment   = 0;
+    wire->accept_content = &_ws_imessage_accept_content;
+}
+
+void ws_imessage_release ( struct ws_imessage * message,
+                           struct ws_imessage_chunk * chain )
+{
+    while ( chain )
+    {
+        struct ws_imessage_chunk *const next = chain->next;
+        const uint64 size = chain->capacity + _WS_IMESSAGE_HEAD;
+        message->memory -= size;
+        ws_pool_put(message->pool, chain, size);
+        chain = next;
+    }
+}
+
+void ws_imessage_clear ( struct ws_imessage * message )
+{
+    int i;
+    for ( i = 0; i < 2; ++i )
+    {
+        ws_imessage_release(message, message->chains[i][0]);
+        message->chains[i][0] = message->chains[i][1] = 0;
+        message->sizes[i] = 0;
+    }
+}
+
+uint64 ws_imessage_copy ( const struct ws_imessage_chunk * chain,
+                          void * data, uint64 size )
+{
+    uint64 used = 0;
+    for ( ; chain && (used < size); chain = chain->next )
+    {
+        const uint64 part = MIN(chain->size, size-used);
+        memcpy((char*)data+used, chain->data, part);
+        used += part;
+    }
+    return (used);
+}
@@ -0,0 +1,252 @@
+#ifndef _imessage_h__
+#define _imessage_h__
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file imessage.h
+ * @brief Web Socket in-bound message reassembly for C.
+ *
+ * @see http://tools.ietf.org/html/rfc6455#section-5.4
+ */
+
+#include "types.h"
+#include "arena.h"
+#include "iwire.h"
+#include "owire.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum ws_imessage_status
+{
+    /*!
+     * @brief No errors were detected.
+     */
+    ws_imessage_ok,
+
+    /*!
+     * @brief A message is larger than @c ws_imessage::max_message.
+     *
+     * Applications should close the connection with status code 1009.
+     */
+    ws_imessage_too_large,
+
+    /*!
+     * @brief Buffering a message would exceed @c ws_imessage::max_memory, or
+     *  the pool ran out of memory.
+     */
+    ws_imessage_out_of_memory,
+
+} ws_imessage_status;
+
+/*!
+ * @brief Part of a message's payload.
+ *
+ * Messages are stored in a chain of buffers obtained from a @c ws_pool.  The
+ * payload is never moved once received: a message is the concatenation of
+ * the @c size first bytes of @c data for each chunk in the chain.
+ */
+struct ws_imessage_chunk
+{
+    /*!
+     * @public
+     * @brief Next chunk in the message, or 0.
+     */
+    struct ws_imessage_chunk * next;
+
+    /*!
+     * @public
+     * @brief Payload bytes.
+     */
+    char * data;
+
+    /*!
+     * @public
+     * @brief Number of payload bytes in @c data.
+     */
+    uint64 size;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Number of bytes available in @c data.
+     */
+    uint64 capacity;
+};
+
+/*!
+ * @brief Collects fragments of in-bound messages.
+ *
+ * The reassembler registers itself as a @c ws_iwire parser's callbacks and
+ * delivers complete messages, in order, to @c accept_message.  Control
+ * messages injected between fragments of a data message are assembled
+ * separately and delivered when they end.
+ *
+ * The size of each frame is checked against @c max_message as soon as its
+ * header is parsed, before its payload is buffered.  When a limit is
+ * exceeded, @c status reports the error and all further input is ignored:
+ * the application should close the connection.
+ *
+ * @see ws_imessage_init()
+ */
+struct ws_imessage
+{
+    /*!
+     * @public
+     * @brief Source of buffers.
+     */
+    struct ws_pool * pool;
+
+    /*!
+     * @public
+     * @brief Largest message accepted, in bytes, or 0 for no limit.
+     *
+     * This is 16 MB by default.
+     */
+    uint64 max_message;
+
+    /*!
+     * @public
+     * @brief Largest amount of pool memory held by this connection, in
+     *  bytes, or 0 for no limit.
+     *
+     * This includes buffer overhead and messages delivered to the application
+     * but not released yet.  There is no limit by default.
+     *
+     * @see memory
+     */
+    uint64 max_memory;
+
+    /*!
+     * @public
+     * @brief Called for each complete message.
+     * @param message The reassembler.
+     * @param type Message type (text, data, ping, pong or kill).
+     * @param chain Message payload, 0 if the message is empty.
+     * @param size Number of payload bytes in @a chain.
+     *
+     * The application owns the chain: it must release it with
+     * @c ws_imessage_release(), possibly after this callback returns.  If
+     * this callback isn't set, messages are released right away.
+     */
+    void(*accept_message)(struct ws_imessage * message, ws_type type,
+                          struct ws_imessage_chunk * chain, uint64 size);
+
+    /*!
+     * @public
+     * @brief External state reserved for use by application callbacks.
+     */
+    void * baton;
+
+    /*!
+     * @public
+     * @brief The current reassembly status.
+     *
+     * This value should be considered as read-only and should never be
+     * modified by applications.
+     */
+    ws_imessage_status status;
+
+    /*!
+     * @public
+     * @brief Number of pool bytes held by this connection.
+     *
+     * @see max_memory
+     */
+    uint64 memory;
+
+    /*!
+     * @internal
+     * @private
+     * @brief First and last chunks of the data and control messages being
+     *  assembled.
+     */
+    struct ws_imessage_chunk * chains[2][2];
+
+    /*!
+     * @internal
+     * @private
+     * @brief Payload size of the data and control messages being assembled.
+     */
+    uint64 sizes[2];
+
+    /*!
+     * @internal
+     * @private
+     * @brief Number of payload bytes left in the current frame.
+     */
+    uint64 frame;
+};
+
+/*!
+ * @brief Initialize a reassembler.
+ * @param message Uninitialized reassembler.
+ * @param wire Parser that delivers fragments.  Its callbacks and @c baton are
+ *  replaced: use the reassembler's instead.
+ * @param pool Source of buffers.
+ *
+ * Invoking this function clears @e all state, including application callbacks.
+ * It doesn't release buffers held by a previous use of @a message.
+ */
+void ws_imessage_init ( struct ws_imessage * message,
+                        struct ws_iwire * wire, struct ws_pool * pool );
+
+/*!
+ * @brief Return a message's buffers to the pool.
+ * @param message The reassembler that delivered the message.
+ * @param chain First chunk of the message, or 0 (ignored).
+ */
+void ws_imessage_release ( struct ws_imessage * message,
+                           struct ws_imessage_chunk * chain );
+
+/*!
+ * @brief Drop messages being assembled and return their buffers to the pool.
+ * @param message Current reassembler state.
+ *
+ * Call this before tearing down a connection.  Messages already delivered to
+ * the application are not affected.
+ */
+void ws_imessage_clear ( struct ws_imessage * message );
+
+/*!
+ * @brief Copy a message to a contiguous buffer.
+ * @param chain First chunk of the message.
+ * @param data Destination buffer.
+ * @param size Number of bytes available in @a data.
+ * @return The number of bytes copied.
+ *
+ * Only use this for consumers that need a contiguous payload.
+ */
+uint64 ws_imessage_copy ( const struct ws_imessage_chunk * chain,
+                          void * data, uint64 size );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _imessage_h__ */
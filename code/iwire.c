@@ -32,7 +32,10 @@
  */
 
 #include "iwire.h"
+#include "frame.h"
+#include "mask.h"
 #include <stddef.h>
+#include <string.h>
 
 /*!
  * @internal
@@ -74,6 +77,17 @@ static uint64 _ws_idle
     return (0);
 }
 
+/*!
+ * @internal
+ * @brief Check if the current frame's payload must be valid UTF-8.
+ *
+ * Control messages injected in a text message are not part of the text.
+ */
+static int _ws_validating ( const struct ws_iwire * stream )
+{
+    return (stream->validating && !stream->interleaved);
+}
+
 /*!
  * @internal
  * @brief Invokes end-of-frame and end-of-message callbacks and resets state.
@@ -84,8 +98,25 @@ static void _ws_done ( struct ws_iwire * stream )
         stream->end_fragment(stream);
     }
     stream->handler = &_ws_wait;
+    // resume the interrupted message.
+    if ( stream->interleaved )
+    {
+        if ( stream->end_message ) {
+            stream->end_message(stream);
+        }
+        stream->message_type = stream->held_type;
+        stream->held_type = 0;
+        stream->interleaved = 0;
+        stream->last_fragment = 0;
+        return;
+    }
     if ( stream->last_fragment )
     {
+        // text can't end in the middle of a character.
+        if ( stream->validating && !ws_utf8_done(&stream->utf8) ) {
+            stream->status = ws_iwire_invalid_utf8;
+            return;
+        }
         if ( stream->end_message ) {
 	    stream->end_message(stream);
 	}
@@ -94,6 +125,71 @@ static void _ws_done ( struct ws_iwire * stream )
     }
 }
 
+/*!
+ * @internal
+ * @brief Check the first byte of a frame header against the parser state.
+ * @return @c ws_iwire_ok if the frame is acceptable, else an error code.
+ */
+static ws_iwire_status _ws_check_head
+    ( const struct ws_iwire * stream, uint8 byte )
+{
+    const int extension_code = ((byte & 0x70) >> 4);
+    const int message_type = ((byte & 0x0f) >> 0);
+    const int control = ((message_type & 0x08) != 0);
+    // check for invalid extension fields.
+    if ((extension_code & ~stream->extension_mask) != 0) {
+        return (ws_iwire_invalid_extension);
+    }
+    // for fragmented messages, the opcode is set on the first
+    // frame only and is required to be 0 on subsequent frames.
+    // control messages may be injected between fragments.
+    if ((stream->message_type != 0) && (message_type != 0) &&
+        !(control && ws_known_message_type(message_type)))
+    {
+        return (ws_iwire_message_type_changed);
+    }
+    // if this is the first fragment, make sure the message type is supported.
+    if ((stream->message_type == 0) && !ws_known_message_type(message_type)) {
+        return (ws_iwire_unknown_message_type);
+    }
+    // control messages can't be fragmented.
+    if (control && ((byte & 0x80) == 0)) {
+        return (ws_iwire_invalid_control);
+    }
+    return (ws_iwire_ok);
+}
+
+/*!
+ * @internal
+ * @brief Store fields from the first byte of a (valid) frame header.
+ *
+ * @see _ws_check_head
+ */
+static void _ws_parse_head ( struct ws_iwire * stream, uint8 byte )
+{
+    stream->last_fragment = ((byte & 0x80) != 0);
+    stream->extension_code = ((byte & 0x70) >> 4);
+    // if this is the first fragment, store the message type.
+    if ( stream->message_type == 0 )
+    {
+        stream->message_type = ((byte & 0x0f) >> 0);
+        stream->validating = stream->validate_text
+            && (stream->message_type == 0x01)
+            && (stream->extension_code == 0);
+        ws_utf8_init(&stream->utf8);
+    }
+    // control message injected between fragments, start it now.
+    else if ((byte & 0x08) != 0)
+    {
+        stream->held_type = stream->message_type;
+        stream->message_type = ((byte & 0x0f) >> 0);
+        stream->interleaved = 1;
+        if ( stream->new_message ) {
+            stream->new_message(stream);
+        }
+    }
+}
+
 /*!
  * @internal
  * @ingroup parser-states
@@ -103,39 +199,17 @@ static uint64 _ws_wait
     ( struct ws_iwire * stream, const uint8 * data, uint64 size )
 {
     uint64 used = 0;
-    uint8 message_type = 0;
     while ( used < size )
     {
         // fetch next byte.
         const uint8 byte = data[used++];
-        // parse fields.
-        stream->last_fragment = ((byte & 0x80) != 0);
-        stream->extension_code = ((byte & 0x70) >> 4);
-        message_type = ((byte & 0x0f) >> 0);
-        // check for invalid extension fields.
-        if ((stream->extension_code & ~stream->extension_mask) != 0)
-        {
-            stream->status = ws_iwire_invalid_extension;
+        // make sure the frame is acceptable.
+        stream->status = _ws_check_head(stream, byte);
+        if ( stream->status != ws_iwire_ok ) {
             return (used);
         }
-        // for fragmented messages, the opcode is set on the first
-        // frame only and is required to be 0 on subsequent frames.
-        if ((stream->message_type != 0) && (message_type != 0))
-        {
-            stream->status = ws_iwire_message_type_changed;
-            return (used);
-        }
-        // if this is the first fragment, store the message type.
-        if ( stream->message_type == 0 )
-        {
-            // make sure the message type is supported.
-            if (!ws_known_message_type(message_type))
-            {
-                stream->status = ws_iwire_unknown_message_type;
-                return (used);
-            }
-            stream->message_type = message_type;
-        }
+        // parse fields.
+        _ws_parse_head(stream, byte);
         // done.  look at fragment size.
         stream->handler = &_ws_parse_size_1; break;
     }
@@ -166,6 +240,12 @@ static uint64 _ws_parse_size_1
         stream->unmask_payload = ((byte & 0x80) != 0);
         stream->buffer[0] = ((byte & 0x7f) >> 0);
         stream->stored = 1;
+        // control frames have small payloads.
+        if (((stream->message_type & 0x08) != 0) && (stream->buffer[0] > 125))
+        {
+            stream->status = ws_iwire_invalid_control;
+            return (used);
+        }
         // reject unmasked frames if masking is required by the host.
         if (stream->masking_required && !stream->unmask_payload)
         {
@@ -317,8 +397,8 @@ static uint64 _ws_parse_mask
             stream->handler = &_ws_parse_data; break;
         }
     }
-    // fast-track to next message (see comment above).
-    if ( stream->pass == 0 ) {
+    // fast-track to next message (see comment above), once the mask is done.
+    if ((stream->handler == &_ws_parse_data) && (stream->pass == 0)) {
         return (used + _ws_parse_data(stream, data+used, size-used));
     }
     return (used);
@@ -335,6 +415,13 @@ static uint64 _ws_parse_data_1
 {
     // don't smear across frames.
     const uint64 used = MIN(stream->pass, size);
+    // reject invalid text before passing any of it.
+    if ( _ws_validating(stream) &&
+         !ws_utf8_feed(&stream->utf8, data, used) )
+    {
+        stream->status = ws_iwire_invalid_utf8;
+        return (0);
+    }
     // pass all possible data.
     if ( stream->accept_content ) {
         stream->accept_content(stream, data, used);
@@ -363,13 +450,39 @@ static uint64 _ws_parse_data_2
     size_t bufsize = 0;
     // don't smear across frame boundaries.
     size = MIN(stream->pass, size);
+    // un-mask in the application's buffer, if allowed.
+    if ( stream->inplace && (size > 0) )
+    {
+        uint8 *const mutable_data = (uint8*)data;
+        ws_mask_apply(stream->mask, stream->used, data, mutable_data, size);
+        if ( _ws_validating(stream) &&
+             !ws_utf8_feed(&stream->utf8, mutable_data, size) )
+        {
+            stream->status = ws_iwire_invalid_utf8;
+            return (0);
+        }
+        stream->used += size;
+        used = size;
+        // pass data to stream owner.
+        if ( stream->accept_content ) {
+            stream->accept_content(stream, mutable_data, size);
+        }
+    }
     // start parsing data.
     while ( used < size )
     {
-        // copy butes to buffer and un-mask.
-        for ( bufsize = 0; ((used < size) && (bufsize < 256)); ++bufsize ) {
-            bufdata[bufsize] = data[used++] ^ stream->mask[stream->used++%4];
+        // copy bytes to buffer and un-mask.
+        bufsize = (size_t)MIN(size-used, sizeof(bufdata));
+        ws_mask_apply(stream->mask, stream->used, data+used, bufdata, bufsize);
+        if ( _ws_validating(stream) &&
+             !ws_utf8_feed(&stream->utf8, bufdata, bufsize) )
+        {
+            stream->pass -= used;
+            stream->status = ws_iwire_invalid_utf8;
+            return (used);
         }
+        stream->used += bufsize;
+        used += bufsize;
         // pass data to stream owner.
         if ( stream->accept_content ) {
             stream->accept_content(stream, bufdata, bufsize);
@@ -400,6 +513,66 @@ static uint64 _ws_parse_data
         _ws_parse_data_1(stream, data, size));
 }
 
+/*!
+ * @internal
+ * @brief Parse a complete frame header in one shot.
+ * @return The number of bytes consumed, or 0 if the header is incomplete or
+ *  contains errors.
+ *
+ * This is equivalent to running the @c _ws_wait, @c _ws_parse_size_* and
+ * @c _ws_parse_mask states in sequence.  When the header is not entirely
+ * available, or when it contains an error, nothing is consumed and the
+ * parser state is left untouched so that the byte-wise states handle (and
+ * report) it.
+ *
+ * @see ws_frame_head()
+ */
+static uint64 _ws_parse_frame
+    ( struct ws_iwire * stream, const uint8 * data, uint64 size )
+{
+    struct ws_frame frame;
+    uint64 need = 0;
+    // leave incomplete headers and errors to the byte-wise states.
+    if ((ws_frame_head(data, size, &frame, &need) != ws_frame_ok) ||
+        (_ws_check_head(stream, data[0]) != ws_iwire_ok) ||
+        (stream->masking_required && !frame.masked))
+    {
+        return (0);
+    }
+    // commit fields.
+    _ws_parse_head(stream, data[0]);
+    stream->unmask_payload = frame.masked;
+    if ( frame.masked ) {
+        memcpy(stream->mask, frame.mask, 4);
+    }
+    stream->stored = 0;
+    stream->used = 0;
+    stream->pass = frame.size;
+    if ( stream->new_fragment ) {
+        stream->new_fragment(stream, stream->pass);
+    }
+    stream->handler = &_ws_parse_data;
+    // fast-track to next message (see comment in '_ws_parse_mask()').
+    if ( stream->pass == 0 ) {
+        return (frame.offset + _ws_parse_data
+                (stream, data+frame.offset, size-frame.offset));
+    }
+    return (frame.offset);
+}
+
+/*!
+ * @internal
+ * @brief Check if an empty, unmasked frame's header was just parsed.
+ *
+ * Such frames are complete and must be delivered without waiting for more
+ * data (e.g. a ping at the end of the buffer).
+ */
+static int _ws_pending ( const struct ws_iwire * stream )
+{
+    return ((stream->handler == &_ws_parse_mask) &&
+            !stream->unmask_payload && (stream->pass == 0));
+}
+
 /*!
  * @internal
  * @brief Consume available data and trigger appropriate application callbacks.
@@ -411,12 +584,21 @@ static uint64 _ws_iwire_feed
 {
     uint64 used = 0;
     do {
+        // Fast path: parse buffered frame headers in one shot.
+        if ( stream->handler == &_ws_wait )
+        {
+            const uint64 pass = _ws_parse_frame(stream, data+used, size-used);
+            if ( pass > 0 ) {
+                used += pass; continue;
+            }
+        }
         // Note: invoking the state handler might move the parser to a new
         //   state.  In the end, all data will be consumed by one state or
         //   the other.
         used += (*stream->handler)(stream, data+used, size-used);
     }
-    while ((used < size) && (stream->status == ws_iwire_ok));
+    while (((used < size) || _ws_pending(stream)) &&
+           (stream->status == ws_iwire_ok));
     return (used);
 }
 
@@ -443,11 +625,17 @@ void ws_iwire_init ( struct ws_iwire * stream )
     stream->end_fragment = 0;
     stream->accept_content = 0;
     stream->masking_required = 0;
+    stream->validate_text = 0;
+    stream->validating = 0;
+    ws_utf8_init(&stream->utf8);
     stream->extension_mask = 0;
     stream->extension_code = 0;
     stream->unmask_payload = 0;
+    stream->inplace = 0;
     stream->stored = 0;
     stream->message_type = 0;
+    stream->held_type = 0;
+    stream->interleaved = 0;
     stream->handler = &_ws_idle;
     stream->status = ws_iwire_ok;
 }
@@ -458,11 +646,61 @@ uint64 ws_iwire_feed
     return (_ws_iwire_feed(stream, (const uint8*)data, size));
 }
 
+uint64 ws_iwire_feed_inplace
+    ( struct ws_iwire * stream, void * data, uint64 size )
+{
+    uint64 used = 0;
+    stream->inplace = 1;
+    used = _ws_iwire_feed(stream, (const uint8*)data, size);
+    stream->inplace = 0;
+    return (used);
+}
+
+uint64 ws_iwire_payload ( const struct ws_iwire * stream )
+{
+    // unmasked payload follows the header right away.
+    if ((stream->handler == &_ws_parse_data) ||
+        ((stream->handler == &_ws_parse_mask) && !stream->unmask_payload))
+    {
+        return (stream->pass);
+    }
+    return (0);
+}
+
+uint64 ws_iwire_skip ( struct ws_iwire * stream, uint64 size )
+{
+    // the parser must see masked payloads and validated text.
+    if ( stream->unmask_payload || _ws_validating(stream) ) {
+        return (0);
+    }
+    size = MIN(size, ws_iwire_payload(stream));
+    if ( size == 0 ) {
+        return (0);
+    }
+    stream->handler = &_ws_parse_data;
+    stream->pass -= size;
+    stream->used += size;
+    if ( stream->pass == 0 ) {
+        _ws_done(stream);
+    }
+    return (size);
+}
+
 int ws_iwire_masked ( const struct ws_iwire * stream )
 {
     return (stream->unmask_payload);
 }
 
+int ws_iwire_extension ( const struct ws_iwire * stream )
+{
+    return (stream->extension_code);
+}
+
+int ws_iwire_interleaved ( const struct ws_iwire * stream )
+{
+    return (stream->interleaved);
+}
+
 int ws_iwire_last_fragment ( const struct ws_iwire * stream )
 {
     return (stream->last_fragment);
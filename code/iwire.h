@@ -35,6 +35,7 @@
  */
 
 #include "types.h"
+#include "utf8.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -73,6 +74,19 @@ typedef enum ws_iwire_status
      */
     ws_iwire_masking_required,
 
+    /*!
+     * @brief A text message contains invalid UTF-8 data.
+     *
+     * @see ws_iwire::validate_text
+     */
+    ws_iwire_invalid_utf8,
+
+    /*!
+     * @brief A control frame is fragmented or has a payload larger than 125
+     *  bytes (see RFC6455, section 5.5).
+     */
+    ws_iwire_invalid_control,
+
 } ws_iwire_status;
 
 struct ws_iwire;
@@ -103,8 +117,13 @@ typedef uint64(*ws_iwire_handler)
  * @see ws_iwire_handler
  * @see http://tools.ietf.org/html/rfc6455
  *
- * @bug The current parser implementation cannot handle control messages
- *  injected between message fragments (see RFC6455, section 5.4).
+ * Control messages (ping, pong and close) may be injected between the
+ * fragments of a data message (see RFC6455, section 5.4).  They are
+ * delivered right away, as complete messages: @c new_message(),
+ * @c new_fragment(), @c accept_content(), @c end_fragment() and
+ * @c end_message() are called for the control message, during which
+ * @c ws_iwire_interleaved() returns 1.  The data message then continues
+ * with its next fragment.
  */
 struct ws_iwire
 {
@@ -118,7 +137,13 @@ struct ws_iwire
      *  callback should mostly be used to clear any leftover state from the
      *  previous message.
      *
+     * @note For control messages injected between fragments of a data
+     *  message, this callback is invoked @e after the frame header is parsed
+     *  and @c ws_iwire_interleaved() returns 1.  State for the data message
+     *  should be kept.
+     *
      * @see baton
+     * @see ws_iwire_interleaved
      */
     void(*new_message)(struct ws_iwire * wire);
 
@@ -228,6 +253,26 @@ struct ws_iwire
      */
     int masking_required;
 
+    /*!
+     * @public
+     * @brief Tells the parser if it should validate text messages.
+     *
+     * When set, text message payloads are checked as they are parsed, even
+     * when characters are split across frames or calls to
+     * @c ws_iwire_feed(), and @c ws_iwire_invalid_utf8 is reported for
+     * invalid data or for messages that end in the middle of a character.
+     * Invalid data is not passed to @c accept_content, except for the
+     * leading bytes of a character that is split across calls to
+     * @c ws_iwire_feed().
+     *
+     * Messages whose first frame sets extension bits (e.g. compressed
+     * messages) are not checked: their payload must be validated after it is
+     * decoded.
+     *
+     * @see ws_utf8_feed()
+     */
+    int validate_text;
+
     /*!
      * @public
      * @brief External state reserved for use by application callbacks.
@@ -247,6 +292,23 @@ struct ws_iwire
      */
     int message_type;
 
+    /*!
+     * @internal
+     * @private
+     * @brief Type of the data message interrupted by a control message.
+     *
+     * @see interleaved
+     */
+    int held_type;
+
+    /*!
+     * @internal
+     * @private
+     * @brief 1 while parsing a control message injected between fragments of
+     *  a data message, else 0.
+     */
+    int interleaved;
+
     /*!
      * @internal
      * @private
@@ -270,6 +332,33 @@ struct ws_iwire
      */
     int unmask_payload;
 
+    /*!
+     * @internal
+     * @private
+     * @brief 1 if the data being parsed may be modified, else 0.
+     *
+     * This is only set for the duration of a call to
+     * @c ws_iwire_feed_inplace().  When set, masked payloads are unmasked
+     * directly in the application's buffer.
+     */
+    int inplace;
+
+    /*!
+     * @internal
+     * @private
+     * @brief 1 if the current message's payload is validated, else 0.
+     *
+     * @see validate_text
+     */
+    int validating;
+
+    /*!
+     * @internal
+     * @private
+     * @brief UTF-8 validator for the current message.
+     */
+    struct ws_utf8 utf8;
+
     /*!
      * @internal
      * @private
@@ -362,6 +451,55 @@ void ws_iwire_init ( struct ws_iwire * stream );
 uint64 ws_iwire_feed
     ( struct ws_iwire * stream, const void * data, uint64 size );
 
+/*!
+ * @brief Consume available data, unmasking payloads in the supplied buffer.
+ * @param stream The current parser state.
+ * @param data Array of bytes available to the parser.  Accessing past @a size
+ *  bytes in this array results in undefined behavior.
+ * @param size Number of bytes in @a data the state can process.
+ * @return The number of bytes consumed by the state.
+ *
+ * This is identical to @c ws_iwire_feed(), except that masked payloads are
+ * unmasked directly in @a data instead of being copied to an internal buffer
+ * first.  Each contiguous span of payload in @a data is thus forwarded in a
+ * single call to @c ws_iwire::accept_content(), regardless of masking.
+ *
+ * @warning After this call, the payload sections of @a data contain the
+ *  unmasked payload.  Frame headers are left untouched.
+ *
+ * @see ws_iwire_feed
+ */
+uint64 ws_iwire_feed_inplace
+    ( struct ws_iwire * stream, void * data, uint64 size );
+
+/*!
+ * @brief Get the number of payload bytes left in the current frame.
+ * @param stream The current parser state.
+ * @return The number of payload bytes the parser expects before the next
+ *  frame header, or 0 if it is not inside a frame's payload.
+ *
+ * @see ws_iwire_skip()
+ */
+uint64 ws_iwire_payload ( const struct ws_iwire * stream );
+
+/*!
+ * @brief Account for payload bytes the application moved by other means.
+ * @param stream The current parser state.
+ * @param size Number of payload bytes the application removed from its input
+ *  instead of passing them to @c ws_iwire_feed().
+ * @return The number of bytes skipped, at most @c ws_iwire_payload().
+ *
+ * This lets applications forward large payloads without copying them, e.g.
+ * with @c splice(), while the parser only sees frame headers.  Only payloads
+ * the parser doesn't need to see can be skipped: nothing is skipped (0 is
+ * returned) for masked frames and for text that is being validated.
+ * @c ws_iwire::accept_content() is not invoked for skipped bytes, but the
+ * end-of-fragment and end-of-message callbacks are, as usual.
+ *
+ * @see ws_iwire_payload()
+ */
+uint64 ws_iwire_skip ( struct ws_iwire * stream, uint64 size );
+
 /*!
  * @brief Check if the current frame is masked.
  * @param stream The current parser state.
@@ -375,6 +513,32 @@ uint64 ws_iwire_feed
  */
 int ws_iwire_masked ( const struct ws_iwire * stream );
 
+/*!
+ * @brief Get the current frame's extension field.
+ * @param stream The current parser state.
+ * @return The 3-bit extension field (RSV1 is the most significant bit).
+ *
+ * Extensions such as per-message compression flag messages in their first
+ * fragment only.
+ *
+ * @warning This cannot be used inside the @c ws_iwire::new_message callback
+ *  because that callback is triggered before the message frame is parsed.
+ *
+ * @see ws_iwire::new_fragment
+ * @see ws_iwire::extension_mask
+ */
+int ws_iwire_extension ( const struct ws_iwire * stream );
+
+/*!
+ * @brief Check if the current message interrupts a fragmented message.
+ * @param stream The current parser state.
+ * @return 1 if the current message is a control message injected between
+ *  fragments of a data message, else 0.
+ *
+ * @see ws_iwire::new_message
+ */
+int ws_iwire_interleaved ( const struct ws_iwire * stream );
+
 /*!
  * @brief Check if the current frame is the message's last fragment.
  * @param stream The current parser state.
@@ -0,0 +1,305 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file mask.c
+ * @brief Web Socket payload masking for C.
+ *
+ * @see http://tools.ietf.org/html/rfc6455#section-5.3
+ */
+
+#include "mask.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) || defined(__SSE2__)
+#   define WS_MASK_SSE2 1
+#   include <emmintrin.h>
+#endif
+
+#if defined(WS_MASK_SSE2) && defined(__GNUC__)
+#   define WS_MASK_AVX2 1
+#   define WS_MASK_AVX2_TARGET __attribute__((target("avx2")))
+#   include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   define WS_MASK_NEON 1
+#   include <arm_neon.h>
+#endif
+
+/*!
+ * @internal
+ * @brief Function prototype of masking implementations.
+ * @param key Masking key, already rotated to match the first byte.
+ * @param idata Array of bytes to mask.
+ * @param odata Array of bytes that receives the masked data.
+ * @param size Number of bytes to process.
+ *
+ * @see ws_mask_apply()
+ */
+typedef void(*ws_mask_handler)
+    (const uint8 key[4], const uint8 * idata, uint8 * odata, uint64 size);
+
+/*!
+ * @internal
+ * @brief Mask trailing bytes that don't fill a complete machine word.
+ *
+ * Callers always process whole multiples of 4 bytes before calling this, so
+ * the key is still aligned on the first byte.
+ */
+static void _ws_mask_tail
+    ( const uint8 key[4], const uint8 * idata, uint8 * odata, uint64 size )
+{
+    uint64 used = 0;
+    for ( ; used < size; ++used ) {
+        odata[used] = idata[used] ^ key[used & 3];
+    }
+}
+
+/*!
+ * @internal
+ * @brief Portable implementation, processes 64 bits at a time.
+ */
+static void _ws_mask_scalar
+    ( const uint8 key[4], const uint8 * idata, uint8 * odata, uint64 size )
+{
+    uint64 used = 0;
+    uint64 word = 0;
+    uint64 mask = 0;
+    // repeat the key to fill a machine word.  the key is copied byte-wise,
+    // so this works regardless of the platform's byte order.
+    memcpy(((uint8*)&mask)+0, key, 4);
+    memcpy(((uint8*)&mask)+4, key, 4);
+    // memcpy() compiles to plain (unaligned) loads and stores.
+    for ( ; (size-used) >= 32; used += 32 )
+    {
+        memcpy(&word, idata+used+ 0, 8), word ^= mask;
+        memcpy(odata+used+ 0, &word, 8);
+        memcpy(&word, idata+used+ 8, 8), word ^= mask;
+        memcpy(odata+used+ 8, &word, 8);
+        memcpy(&word, idata+used+16, 8), word ^= mask;
+        memcpy(odata+used+16, &word, 8);
+        memcpy(&word, idata+used+24, 8), word ^= mask;
+        memcpy(odata+used+24, &word, 8);
+    }
+    for ( ; (size-used) >= 8; used += 8 )
+    {
+        memcpy(&word, idata+used, 8), word ^= mask;
+        memcpy(odata+used, &word, 8);
+    }
+    _ws_mask_tail(key, idata+used, odata+used, size-used);
+}
+
+#ifdef WS_MASK_SSE2
+/*!
+ * @internal
+ * @brief SSE2 implementation, processes 128 bits at a time.
+ */
+static void _ws_mask_sse2
+    ( const uint8 key[4], const uint8 * idata, uint8 * odata, uint64 size )
+{
+    uint64 used = 0;
+    uint32 word = 0;
+    __m128i mask;
+    memcpy(&word, key, 4);
+    mask = _mm_set1_epi32((int)word);
+    for ( ; (size-used) >= 64; used += 64 )
+    {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(idata+used+ 0));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(idata+used+16));
+        const __m128i c = _mm_loadu_si128((const __m128i*)(idata+used+32));
+        const __m128i d = _mm_loadu_si128((const __m128i*)(idata+used+48));
+        _mm_storeu_si128((__m128i*)(odata+used+ 0), _mm_xor_si128(a, mask));
+        _mm_storeu_si128((__m128i*)(odata+used+16), _mm_xor_si128(b, mask));
+        _mm_storeu_si128((__m128i*)(odata+used+32), _mm_xor_si128(c, mask));
+        _mm_storeu_si128((__m128i*)(odata+used+48), _mm_xor_si128(d, mask));
+    }
+    for ( ; (size-used) >= 16; used += 16 )
+    {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(idata+used));
+        _mm_storeu_si128((__m128i*)(odata+used), _mm_xor_si128(a, mask));
+    }
+    _ws_mask_scalar(key, idata+used, odata+used, size-used);
+}
+#endif
+
+#ifdef WS_MASK_AVX2
+/*!
+ * @internal
+ * @brief AVX2 implementation, processes 256 bits at a time.
+ *
+ * This is compiled for AVX2 regardless of the compiler flags and must only be
+ * selected after checking that the processor supports it.
+ */
+static WS_MASK_AVX2_TARGET void _ws_mask_avx2
+    ( const uint8 key[4], const uint8 * idata, uint8 * odata, uint64 size )
+{
+    uint64 used = 0;
+    uint32 word = 0;
+    __m256i mask;
+    memcpy(&word, key, 4);
+    mask = _mm256_set1_epi32((int)word);
+    for ( ; (size-used) >= 128; used += 128 )
+    {
+        const __m256i a = _mm256_loadu_si256((const __m256i*)(idata+used+ 0));
+        const __m256i b = _mm256_loadu_si256((const __m256i*)(idata+used+32));
+        const __m256i c = _mm256_loadu_si256((const __m256i*)(idata+used+64));
+        const __m256i d = _mm256_loadu_si256((const __m256i*)(idata+used+96));
+        _mm256_storeu_si256((__m256i*)(odata+used+ 0), _mm256_xor_si256(a,mask));
+        _mm256_storeu_si256((__m256i*)(odata+used+32), _mm256_xor_si256(b,mask));
+        _mm256_storeu_si256((__m256i*)(odata+used+64), _mm256_xor_si256(c,mask));
+        _mm256_storeu_si256((__m256i*)(odata+used+96), _mm256_xor_si256(d,mask));
+    }
+    for ( ; (size-used) >= 32; used += 32 )
+    {
+        const __m256i a = _mm256_loadu_si256((const __m256i*)(idata+used));
+        _mm256_storeu_si256((__m256i*)(odata+used), _mm256_xor_si256(a,mask));
+    }
+    _ws_mask_scalar(key, idata+used, odata+used, size-used);
+}
+#endif
+
+#ifdef WS_MASK_NEON
+/*!
+ * @internal
+ * @brief NEON implementation, processes 128 bits at a time.
+ */
+static void _ws_mask_neon
+    ( const uint8 key[4], const uint8 * idata, uint8 * odata, uint64 size )
+{
+    uint64 used = 0;
+    uint32 word = 0;
+    uint8x16_t mask;
+    memcpy(&word, key, 4);
+    mask = vreinterpretq_u8_u32(vdupq_n_u32(word));
+    for ( ; (size-used) >= 64; used += 64 )
+    {
+        const uint8x16_t a = vld1q_u8(idata+used+ 0);
+        const uint8x16_t b = vld1q_u8(idata+used+16);
+        const uint8x16_t c = vld1q_u8(idata+used+32);
+        const uint8x16_t d = vld1q_u8(idata+used+48);
+        vst1q_u8(odata+used+ 0, veorq_u8(a, mask));
+        vst1q_u8(odata+used+16, veorq_u8(b, mask));
+        vst1q_u8(odata+used+32, veorq_u8(c, mask));
+        vst1q_u8(odata+used+48, veorq_u8(d, mask));
+    }
+    for ( ; (size-used) >= 16; used += 16 ) {
+        vst1q_u8(odata+used, veorq_u8(vld1q_u8(idata+used), mask));
+    }
+    _ws_mask_scalar(key, idata+used, odata+used, size-used);
+}
+#endif
+
+/*!
+ * @internal
+ * @brief Check whether the implementation called @a name was asked for.
+ * @param want Name of the implementation asked for, or 0 for any.
+ */
+static int _ws_mask_wants ( const char * want, const char * name )
+{
+    return ((want == 0) || (strcmp(want, name) == 0));
+}
+
+/*!
+ * @internal
+ * @brief Pick the best implementation available on this processor.
+ * @param want Name of the implementation to pick, or 0 for the best one.
+ * @return 0 if @a want is not available.
+ */
+static ws_mask_handler _ws_mask_select ( const char * want, const char ** name )
+{
+#ifdef WS_MASK_AVX2
+    if (_ws_mask_wants(want, "avx2") && __builtin_cpu_supports("avx2")) {
+        return (*name = "avx2", &_ws_mask_avx2);
+    }
+#endif
+#ifdef WS_MASK_SSE2
+    if (_ws_mask_wants(want, "sse2")) {
+        return (*name = "sse2", &_ws_mask_sse2);
+    }
+#endif
+#ifdef WS_MASK_NEON
+    if (_ws_mask_wants(want, "neon")) {
+        return (*name = "neon", &_ws_mask_neon);
+    }
+#endif
+    if (_ws_mask_wants(want, "scalar")) {
+        return (*name = "scalar", &_ws_mask_scalar);
+    }
+    return (0);
+}
+
+/*!
+ * @internal
+ * @brief Selected implementation, resolved on first use.
+ *
+ * Concurrent first uses may race to resolve this, but they all store the
+ * same values.
+ */
+static ws_mask_handler _ws_mask_handler = 0;
+
+/*!
+ * @internal
+ * @brief Name of the selected implementation.
+ *
+ * @see _ws_mask_handler
+ */
+static const char * _ws_mask_name = 0;
+
+void ws_mask_apply ( const uint8 mask[4], uint64 offset,
+                     const void * idata, void * odata, uint64 size )
+{
+    uint8 key[4];
+    // rotate the key once so that key[0] applies to the first byte.
+    key[0] = mask[(offset+0) & 3];
+    key[1] = mask[(offset+1) & 3];
+    key[2] = mask[(offset+2) & 3];
+    key[3] = mask[(offset+3) & 3];
+    if ( _ws_mask_handler == 0 ) {
+        _ws_mask_handler = _ws_mask_select(0, &_ws_mask_name);
+    }
+    _ws_mask_handler(key, (const uint8*)idata, (uint8*)odata, size);
+}
+
+const char * ws_mask_engine ( void )
+{
+    if ( _ws_mask_handler == 0 ) {
+        _ws_mask_handler = _ws_mask_select(0, &_ws_mask_name);
+    }
+    return (_ws_mask_name);
+}
+
+int ws_mask_override ( const char * name )
+{
+    const char * found = 0;
+    const ws_mask_handler handler = _ws_mask_select(name, &found);
+    if ( handler == 0 ) {
+        return (0);
+    }
+    _ws_mask_handler = handler, _ws_mask_name = found;
+    return (1);
+}
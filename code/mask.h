@@ -0,0 +1,90 @@
+#ifndef _mask_h__
+#define _mask_h__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file mask.h
+ * @brief Web Socket payload masking for C.
+ *
+ * @see http://tools.ietf.org/html/rfc6455#section-5.3
+ */
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * @brief Apply (or remove) a frame mask to a span of payload data.
+ * @param mask The frame's 4-byte masking key.
+ * @param offset Position of the first byte of @a idata in the frame payload.
+ *  This selects which masking key byte applies to the first byte.
+ * @param idata Array of bytes to mask.  Accessing past @a size bytes in this
+ *  array results in undefined behavior.
+ * @param odata Array of bytes that receives the masked data.  This may be
+ *  equal to @a idata to mask the data in place, but the arrays must not
+ *  otherwise overlap.
+ * @param size Number of bytes to process.
+ *
+ * Masking is its own inverse, so this function is used both to mask outgoing
+ * frames and to unmask incoming frames.  The masking key is rotated to match
+ * @a offset once, then whole machine words (or vector registers, when the
+ * processor supports them) are processed at a time.  The best available
+ * implementation is selected at run time, on first use.
+ *
+ * @see ws_mask_engine()
+ */
+void ws_mask_apply ( const uint8 mask[4], uint64 offset,
+                     const void * idata, void * odata, uint64 size );
+
+/*!
+ * @brief Name the masking implementation selected for this processor.
+ * @return One of "avx2", "sse2", "neon" or "scalar".
+ *
+ * This is mostly useful for labeling benchmark results.
+ */
+const char * ws_mask_engine ( void );
+
+/*!
+ * @internal
+ * @brief Force the masking implementation, for testing.
+ * @param name One of the names returned by @c ws_mask_engine(), or 0 to select
+ *  the best implementation again.
+ * @return 1 if that implementation is available on this processor, else 0
+ *  (the current selection is kept).
+ *
+ * This is not thread-safe: call it only while no other thread masks data.
+ */
+int ws_mask_override ( const char * name );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _mask_h__ */
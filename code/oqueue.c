@@ -0,0 +1,163 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file oqueue.c
+ * @brief Web Socket out-bound message scheduling for C.
+ *
+ * @see http://tools.ietf.org/html/rfc6455#section-5.4
+ */
+
+#include "oqueue.h"
+
+/*!
+ * @internal
+ * @brief Append an entry to a queue.
+ */
+static void _ws_oqueue_append ( struct ws_oqueue_entry * queue[2],
+                                struct ws_oqueue_entry * entry )
+{
+    entry->next = 0;
+    if ( queue[1] ) {
+        queue[1]->next = entry;
+    }
+    else {
+        queue[0] = entry;
+    }
+    queue[1] = entry;
+}
+
+/*!
+ * @internal
+ * @brief Remove the first entry from a queue.
+ */
+static struct ws_oqueue_entry * _ws_oqueue_shift
+    ( struct ws_oqueue_entry * queue[2] )
+{
+    struct ws_oqueue_entry *const entry = queue[0];
+    if ( entry )
+    {
+        queue[0] = entry->next;
+        if ( queue[0] == 0 ) {
+            queue[1] = 0;
+        }
+        entry->next = 0;
+    }
+    return (entry);
+}
+
+/*!
+ * @internal
+ * @brief Send one frame of a message.
+ */
+static void _ws_oqueue_frame ( struct ws_oqueue * queue,
+                               struct ws_oqueue_entry * entry, uint64 size )
+{
+    const int first = (entry->sent == 0);
+    const int last = ((entry->sent + size) == entry->size);
+    ws_owire_new_frame(queue->wire, first? entry->type : ws_same,
+                       size, last, first? entry->extension : 0);
+    ws_owire_feed(queue->wire, (const uint8*)entry->data + entry->sent, size);
+    ws_owire_end_frame(queue->wire);
+    entry->sent += size;
+    queue->bytes -= size;
+    if ( last ) {
+        --queue->messages;
+        if ( queue->sent ) {
+            queue->sent(queue, entry);
+        }
+    }
+}
+
+void ws_oqueue_init ( struct ws_oqueue * queue )
+{
+    int i = 0;
+    queue->wire = 0;
+    queue->fragment_size = 16*1024;
+    queue->sent = 0;
+    queue->baton = 0;
+    queue->messages = 0;
+    queue->bytes = 0;
+    queue->current = 0;
+    queue->control[0] = queue->control[1] = 0;
+    for ( i = 0; i < WS_OQUEUE_PRIORITIES; ++i ) {
+        queue->queues[i][0] = queue->queues[i][1] = 0;
+    }
+}
+
+void ws_oqueue_push ( struct ws_oqueue * queue,
+                      struct ws_oqueue_entry * entry )
+{
+    int priority = entry->priority;
+    entry->sent = 0;
+    ++queue->messages;
+    queue->bytes += entry->size;
+    if ( entry->type >= ws_kill ) {
+        _ws_oqueue_append(queue->control, entry); return;
+    }
+    priority = (priority < 0)? 0 : priority;
+    priority = (priority >= WS_OQUEUE_PRIORITIES)?
+        WS_OQUEUE_PRIORITIES-1 : priority;
+    _ws_oqueue_append(queue->queues[priority], entry);
+}
+
+int ws_oqueue_pump ( struct ws_oqueue * queue )
+{
+    struct ws_oqueue_entry * entry = 0;
+    uint64 size = 0;
+    int i = 0;
+    // control messages go first, never fragmented.
+    if ((entry = _ws_oqueue_shift(queue->control)) != 0) {
+        _ws_oqueue_frame(queue, entry, entry->size);
+        return (1);
+    }
+    // then, finish the current message before starting another one.
+    if ( queue->current == 0 )
+    {
+        for ( i = 0; (i < WS_OQUEUE_PRIORITIES) && (entry == 0); ++i ) {
+            entry = _ws_oqueue_shift(queue->queues[i]);
+        }
+        if ( entry == 0 ) {
+            return (0);
+        }
+        queue->current = entry;
+    }
+    entry = queue->current;
+    size = entry->size - entry->sent;
+    if ((queue->fragment_size != 0) && (size > queue->fragment_size)) {
+        size = queue->fragment_size;
+    }
+    else {
+        queue->current = 0;
+    }
+    _ws_oqueue_frame(queue, entry, size);
+    return (1);
+}
+
+int ws_oqueue_empty ( const struct ws_oqueue * queue )
+{
+    return (queue->messages == 0);
+}
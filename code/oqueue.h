@@ -0,0 +1,232 @@
+#ifndef _oqueue_h__
+#define _oqueue_h__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file oqueue.h
+ * @brief Web Socket out-bound message scheduling for C.
+ *
+ * @see http://tools.ietf.org/html/rfc6455#section-5.4
+ */
+
+#include "types.h"
+#include "owire.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * @def WS_OQUEUE_PRIORITIES
+ * @brief Number of priority levels for data messages.
+ */
+#define WS_OQUEUE_PRIORITIES 4
+
+/*!
+ * @brief Message waiting to be sent.
+ *
+ * Entries are owned by the application: they (and the payload they refer to)
+ * must remain valid until @c ws_oqueue::sent is called for them.
+ *
+ * @see ws_oqueue_push()
+ */
+struct ws_oqueue_entry
+{
+    /*!
+     * @public
+     * @brief The message type (text, data, ping, etc.).
+     */
+    ws_type type;
+
+    /*!
+     * @public
+     * @brief Message payload.
+     */
+    const void * data;
+
+    /*!
+     * @public
+     * @brief Number of bytes in @a data.
+     */
+    uint64 size;
+
+    /*!
+     * @public
+     * @brief Extension code, 3-bit value (set on the first fragment only).
+     */
+    int extension;
+
+    /*!
+     * @public
+     * @brief Priority of data messages, 0 is the most urgent.
+     *
+     * Ignored for control messages, which are always sent first.
+     */
+    int priority;
+
+    /*!
+     * @public
+     * @brief External state reserved for use by application callbacks.
+     */
+    void * baton;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Number of payload bytes already sent.
+     */
+    uint64 sent;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Next entry in the same queue.
+     */
+    struct ws_oqueue_entry * next;
+};
+
+/*!
+ * @brief Out-bound message scheduler.
+ *
+ * Messages are queued by priority and sent through a @c ws_owire writer one
+ * frame at a time, as the application pumps the queue (e.g. while the socket
+ * is writable).  Data messages larger than @c fragment_size are fragmented so
+ * that control messages (pongs, close) are sent between fragments: they wait
+ * for at most one fragment.
+ *
+ * @note The WebSocket protocol forbids interleaving fragments of different
+ *  data messages.  Urgent data messages are sent before less urgent ones that
+ *  are still waiting, but they can't preempt a message that was already
+ *  started.  Use a small @c fragment_size and avoid huge messages at high
+ *  priority to bound the delay.
+ *
+ * @see ws_oqueue_pump()
+ */
+struct ws_oqueue
+{
+    /*!
+     * @public
+     * @brief Writer used to send frames.
+     */
+    struct ws_owire * wire;
+
+    /*!
+     * @public
+     * @brief Largest payload sent in a single frame of a data message.
+     *
+     * Set to 0 to never fragment messages.
+     */
+    uint64 fragment_size;
+
+    /*!
+     * @public
+     * @brief Called when a message is completely sent.
+     *
+     * The entry may be reused or released by the application.
+     */
+    void(*sent)(struct ws_oqueue*,struct ws_oqueue_entry*);
+
+    /*!
+     * @public
+     * @brief External state reserved for use by application callbacks.
+     */
+    void * baton;
+
+    /*!
+     * @public
+     * @brief Number of messages waiting (including one partially sent).
+     */
+    uint64 messages;
+
+    /*!
+     * @public
+     * @brief Number of payload bytes waiting to be sent.
+     */
+    uint64 bytes;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Data message being sent, if any.
+     */
+    struct ws_oqueue_entry * current;
+
+    /*!
+     * @internal
+     * @private
+     * @brief First and last control messages.
+     */
+    struct ws_oqueue_entry * control[2];
+
+    /*!
+     * @internal
+     * @private
+     * @brief First and last data messages, for each priority.
+     */
+    struct ws_oqueue_entry * queues[WS_OQUEUE_PRIORITIES][2];
+};
+
+/*!
+ * @brief Initialize a scheduler.
+ * @param queue Uninitialized scheduler.
+ *
+ * Invoking this function clears @e all state, including application callbacks.
+ * The default fragment size is 16 KB.
+ */
+void ws_oqueue_init ( struct ws_oqueue * queue );
+
+/*!
+ * @brief Queue a message.
+ * @param queue Current scheduler state.
+ * @param entry Message to send.  Its public fields must be set.
+ *
+ * Messages of the same priority are sent in order.  Control messages are sent
+ * in order, before all data messages (but after the current fragment).
+ */
+void ws_oqueue_push ( struct ws_oqueue * queue,
+                      struct ws_oqueue_entry * entry );
+
+/*!
+ * @brief Send the next frame.
+ * @param queue Current scheduler state.
+ * @return 1 if a frame was sent, 0 if there was nothing to send.
+ */
+int ws_oqueue_pump ( struct ws_oqueue * queue );
+
+/*!
+ * @brief Check if all messages were sent.
+ * @param queue Current scheduler state.
+ * @return 1 if no messages are waiting, else 0.
+ */
+int ws_oqueue_empty ( const struct ws_oqueue * queue );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _oqueue_h__ */
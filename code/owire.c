@@ -32,6 +32,7 @@
  */
 
 #include "owire.h"
+#include "mask.h"
 #include <time.h>
 #include <stdlib.h>
 #include <string.h>
@@ -74,6 +75,48 @@ static uint64 _ws_fail
     return (0);
 }
 
+/*!
+ * @internal
+ * @brief Forward all gathered spans to the application.
+ * @param stream Current writer state.
+ *
+ * @see ws_owire::accept_slices
+ */
+static void _ws_owire_flush ( struct ws_owire * stream )
+{
+    if ( stream->count > 0 ) {
+        stream->accept_slices(stream, stream->slices, stream->count);
+    }
+    stream->frames = 0;
+    stream->count = 0;
+    stream->staged = 0;
+}
+
+/*!
+ * @internal
+ * @brief Forward data to the application.
+ * @param stream Current writer state.
+ * @param data Data to be written.
+ * @param size Number of bytes to write.
+ *
+ * Any gathered frames are forwarded first to preserve ordering.
+ */
+static void _ws_owire_write
+    ( struct ws_owire * stream, const void * data, uint64 size )
+{
+    struct ws_owire_slice slice;
+    if ( stream->accept_slices )
+    {
+        _ws_owire_flush(stream);
+        slice.data = data;
+        slice.size = size;
+        stream->accept_slices(stream, &slice, 1);
+    }
+    else if ( stream->accept_content ) {
+        stream->accept_content(stream, data, size);
+    }
+}
+
 /*!
  * @internal
  * @brief Forward unmasked frame payload.
@@ -90,7 +133,7 @@ static uint64 _ws_body_1
     // don't smear across frames.
     size = MIN(size, stream->pass);
     // pass all possible data.
-    stream->accept_content(stream, data, size);
+    _ws_owire_write(stream, data, size);
     // update cursors.
     stream->used += size;
     stream->pass -= size;
@@ -117,19 +160,27 @@ static uint64 _ws_body_2
     ( struct ws_owire * stream, const uint8 * data, uint64 size )
 {
     uint64 used = 0;
-    uint8 bufdata[256];
-    size_t bufsize = 0;
+    uint8 bufdata[4096];
+    uint8 * buffer = bufdata;
+    uint64 capacity = sizeof(bufdata);
+    uint64 bufsize = 0;
+    // prefer the application's staging area, if any.
+    if ((stream->buffer != 0) && (stream->buffer_size > 0)) {
+        buffer = (uint8*)stream->buffer;
+        capacity = stream->buffer_size;
+    }
     // don't smear across frame boundaries.
     size = MIN(stream->pass, size);
     // start parsing data.
     while ( used < size )
     {
-        // copy butes to buffer and un-mask.
-        for ( bufsize = 0; ((used < size) && (bufsize < 256)); ++bufsize ) {
-            bufdata[bufsize] = data[used++] ^ stream->mask[stream->used++%4];
-        }
+        // copy bytes to buffer and mask.
+        bufsize = MIN(size-used, capacity);
+        ws_mask_apply(stream->mask, stream->used, data+used, buffer, bufsize);
+        stream->used += bufsize;
+        used += bufsize;
         // pass data to stream owner.
-        stream->accept_content(stream, bufdata, bufsize);
+        _ws_owire_write(stream, buffer, bufsize);
     }
     // adjust cursors.
     stream->pass -= used;
@@ -144,62 +195,23 @@ static uint64 _ws_body_2
 
 /*!
  * @internal
- * @brief Emit a complete message, fragmenting it if necessary.
- * @param stream Current writer state.
- * @param data Data to be written.
- * @param size Number of bytes to write.
- * @param code The message type (text, data, ping, etc.).
- *
- * @bug The message type is not considered when auto-fragmenting.  However,
- *  control frames (ping, pong and close) must not be fragmented (see RFC6455,
- *  section 5.4).
+ * @brief Format a frame header.
+ * @param data Buffer that receives the header, large enough for the largest
+ *  possible header (14 bytes).
+ * @param type The message type (text, data, ping, etc.).
+ * @param size Size of the frame payload, in bytes.
+ * @param last 1 if this frame ends the message, else 0.
+ * @param extension Extension code, 3-bit value.
+ * @param mask Frame mask, or null if the payload is not masked.
+ * @return The header size, in bytes.
  */
-static void ws_owire_put_full ( struct ws_owire * stream, ws_type type,
-                                const uint8 * data, uint64 size, int extension )
+static uint64 _ws_owire_header ( uint8 * data, ws_type type, uint64 size,
+                                 int last, int extension, const uint8 * mask )
 {
-    uint64 used = 0;
-    uint64 part = 0;
-    int last = 0;
-    if ((stream->auto_fragment == 0) || (size == 0))
-    {
-        ws_owire_new_frame(stream, type, size, 1, extension);
-        stream->handler(stream, data, size);
-        ws_owire_end_frame(stream);
-    }
-    else
-    {
-        do {
-            part = MIN(size-used, stream->auto_fragment);
-            last = ((used+part) < size);
-            ws_owire_new_frame(stream, type, size, last, extension);
-            stream->handler(stream, data+used, part), used += part;
-            ws_owire_end_frame(stream);
-
-            // make sure all but the first fragment have a null message type.
-            type = ws_same;
-        }
-        while (used < size);
-    }
-}
-
-void ws_owire_init ( struct ws_owire * stream )
-{
-    stream->accept_content = 0;
-    stream->rand = &_ws_unsafe_random_mask;
-    stream->baton = 0;
-    stream->auto_fragment = 0;
-    stream->mask_payload = 0;
-    stream->handler = &_ws_fail;
-    stream->pass = 0;
-}
-
-void ws_owire_new_frame ( struct ws_owire * stream, ws_type type, uint64 size,
-                          int last, int extension )
-{
-    unsigned char data[14] = { 0 };
-    uint64 used;
+    uint64 used = 2;
     // store the end-of-message flag, the extension code and the message type.
-    used = 2;
+    data[0] = 0;
+    data[1] = 0;
     if (last) {
         data[0] |= 0x80;
     }
@@ -210,7 +222,7 @@ void ws_owire_new_frame ( struct ws_owire * stream, ws_type type, uint64 size,
     {
         data[1] |= size;
     }
-    else if ( size < 65537 )
+    else if ( size < 65536 )
     {
         data[1] |= 126;
         data[2] = ((size >> 8) & 0xff);
@@ -230,22 +242,192 @@ void ws_owire_new_frame ( struct ws_owire * stream, ws_type type, uint64 size,
         data[9] = ((size >>  0) & 0xff);
         used += 8;
     }
+    // store the mask, if any.
+    if ( mask ) {
+        data[1] |= 0x80;
+        memcpy(data+used, mask, 4);
+        used += 4;
+    }
+    return (used);
+}
+
+/*!
+ * @internal
+ * @brief Compute the size of a frame header.
+ * @param size Size of the frame payload, in bytes.
+ * @param masked 1 if the frame payload is masked, else 0.
+ * @return The header size, in bytes.
+ *
+ * @see _ws_owire_header
+ */
+static uint64 _ws_owire_header_size ( uint64 size, int masked )
+{
+    uint64 used = 2;
+    if ( size >= 65536 ) {
+        used += 8;
+    }
+    else if ( size >= 126 ) {
+        used += 2;
+    }
+    if ( masked ) {
+        used += 4;
+    }
+    return (used);
+}
+
+/*!
+ * @internal
+ * @brief Gather a complete frame for output through @c accept_slices().
+ * @param stream Current writer state.
+ * @param type The message type (text, data, ping, etc.).
+ * @param data Frame payload.
+ * @param size Number of bytes in @a data.
+ * @param last 1 if this frame ends the message, else 0.
+ * @param extension Extension code, 3-bit value.
+ *
+ * The header and the payload are gathered as separate spans.  Masked payloads
+ * are staged in the application's buffer.  Payloads that don't fit are masked
+ * and forwarded in chunks, the first of which travels along with the header.
+ */
+static void _ws_owire_gather ( struct ws_owire * stream, ws_type type,
+                               const uint8 * data, uint64 size,
+                               int last, int extension )
+{
+    uint8 bufdata[4096];
+    uint8 * buffer = (uint8*)stream->buffer;
+    uint64 capacity = stream->buffer_size;
+    const uint8 * mask = 0;
+    uint8 * header = 0;
+    uint64 used = 0;
+    uint64 part = 0;
+    // generate mask if necessary.
+    if ( stream->mask_payload ) {
+        stream->rand(stream, stream->mask);
+        mask = stream->mask;
+    }
+    // prefer the application's staging area, if any.
+    if ((buffer == 0) || (capacity == 0)) {
+        buffer = bufdata;
+        capacity = sizeof(bufdata);
+    }
+    // make room for another frame (masked payloads need room to be staged).
+    if ((stream->frames == WS_OWIRE_FRAMES) ||
+        (mask && (size > (capacity - stream->staged))))
+    {
+        _ws_owire_flush(stream);
+    }
+    header = stream->headers[stream->frames++];
+    stream->slices[stream->count].data = header;
+    stream->slices[stream->count++].size = _ws_owire_header
+        (header, type, size, last, extension, mask);
+    // unmasked payload is forwarded as-is.
+    if ((mask == 0) && (size > 0))
+    {
+        stream->slices[stream->count].data = data;
+        stream->slices[stream->count++].size = size;
+    }
+    // masked payload is staged, forwarding the staging area when it's full.
+    while ((mask != 0) && (used < size))
+    {
+        part = MIN(size-used, capacity-stream->staged);
+        ws_mask_apply(mask, used, data+used, buffer+stream->staged, part);
+        stream->slices[stream->count].data = buffer+stream->staged;
+        stream->slices[stream->count++].size = part;
+        stream->staged += part;
+        used += part;
+        if ( used < size ) {
+            _ws_owire_flush(stream);
+        }
+    }
+    // temporary staging area doesn't outlive this call.
+    if ( mask && (buffer == bufdata) ) {
+        _ws_owire_flush(stream);
+    }
+}
+
+/*!
+ * @internal
+ * @brief Emit a complete message, fragmenting it if necessary.
+ * @param stream Current writer state.
+ * @param data Data to be written.
+ * @param size Number of bytes to write.
+ * @param code The message type (text, data, ping, etc.).
+ *
+ * Control frames (ping, pong and close) are never fragmented (see RFC6455,
+ * section 5.4).
+ */
+static void ws_owire_put_full ( struct ws_owire * stream, ws_type type,
+                                const uint8 * data, uint64 size, int extension )
+{
+    const int fragment = (stream->auto_fragment != 0) && (type < ws_kill);
+    uint64 used = 0;
+    uint64 part = size;
+    int last = 0;
+    do {
+        if ( fragment ) {
+            part = MIN(size-used, stream->auto_fragment);
+        }
+        last = ((used+part) == size);
+        if ( stream->accept_slices ) {
+            _ws_owire_gather(stream, type, data+used, part, last, extension);
+        }
+        else {
+            ws_owire_new_frame(stream, type, part, last, extension);
+            stream->handler(stream, data+used, part);
+            ws_owire_end_frame(stream);
+        }
+        used += part;
+
+        // make sure all but the first fragment have a null message type.
+        type = ws_same;
+    }
+    while (used < size);
+    // forward gathered frames right away, unless asked to hold them.
+    if ( stream->accept_slices && !stream->batch ) {
+        _ws_owire_flush(stream);
+    }
+}
+
+void ws_owire_init ( struct ws_owire * stream )
+{
+    stream->accept_content = 0;
+    stream->accept_slices = 0;
+    stream->rand = &_ws_unsafe_random_mask;
+    stream->baton = 0;
+    stream->auto_fragment = 0;
+    stream->mask_payload = 0;
+    stream->buffer = 0;
+    stream->buffer_size = 0;
+    stream->status = ws_owire_ok;
+    stream->handler = &_ws_fail;
+    stream->used = 0;
+    stream->pass = 0;
+    stream->batch = 0;
+    stream->frames = 0;
+    stream->count = 0;
+    stream->staged = 0;
+}
+
+void ws_owire_new_frame ( struct ws_owire * stream, ws_type type, uint64 size,
+                          int last, int extension )
+{
+    uint8 data[14];
+    uint64 used = 0;
     // generate mask if necessary.
     if (stream->mask_payload) {
-        data[1] |= 0x80;
         stream->rand(stream, stream->mask);
-        memcpy(stream->mask, data+used, 4);
-        used += 4;
+        used = _ws_owire_header
+            (data, type, size, last, extension, stream->mask);
         stream->handler = &_ws_body_2;
     }
     else {
+        used = _ws_owire_header(data, type, size, last, extension, 0);
         stream->handler = &_ws_body_1;
     }
     // transfer the frame header.
-    if (stream->accept_content) {
-        stream->accept_content(stream, data, used);
-    }
+    _ws_owire_write(stream, data, used);
     // keep track of how much data is left to send.
+    stream->used = 0;
     stream->pass = size;
 }
 
@@ -255,6 +437,65 @@ void ws_owire_end_frame ( struct ws_owire * stream )
     stream->pass = 0;
 }
 
+void ws_owire_begin_batch ( struct ws_owire * stream )
+{
+    stream->batch = 1;
+}
+
+void ws_owire_end_batch ( struct ws_owire * stream )
+{
+    stream->batch = 0;
+    if ( stream->accept_slices ) {
+        _ws_owire_flush(stream);
+    }
+}
+
+uint64 ws_owire_batch_size ( const struct ws_owire * stream,
+                             const struct ws_owire_message * messages,
+                             uint64 count )
+{
+    uint64 size = 0;
+    uint64 i = 0;
+    for ( ; i < count; ++i ) {
+        size += _ws_owire_header_size(messages[i].size, stream->mask_payload);
+        size += messages[i].size;
+    }
+    return (size);
+}
+
+uint64 ws_owire_put_batch ( struct ws_owire * stream,
+                            const struct ws_owire_message * messages,
+                            uint64 count, void * output )
+{
+    uint8 *const data = (uint8*)output;
+    uint64 used = 0;
+    uint64 i = 0;
+    for ( ; i < count; ++i )
+    {
+        const struct ws_owire_message *const message = &messages[i];
+        if ( stream->mask_payload )
+        {
+            // header and payload, masked as it is copied.
+            stream->rand(stream, stream->mask);
+            used += _ws_owire_header(data+used, message->type, message->size,
+                                     1, message->extension, stream->mask);
+            ws_mask_apply(stream->mask, 0,
+                          message->data, data+used, message->size);
+        }
+        else
+        {
+            // header and payload, as is.
+            used += _ws_owire_header(data+used, message->type, message->size,
+                                     1, message->extension, 0);
+            if ( message->size > 0 ) {
+                memcpy(data+used, message->data, (size_t)message->size);
+            }
+        }
+        used += message->size;
+    }
+    return (used);
+}
+
 uint64 ws_owire_feed
     ( struct ws_owire * stream, const void * data, uint64 size )
 {
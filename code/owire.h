@@ -85,6 +85,61 @@ typedef enum ws_type
 typedef uint64(*ws_owire_handler)
     (struct ws_owire * wire, const uint8 * data, uint64 size);
 
+/*!
+ * @def WS_OWIRE_FRAMES
+ * @brief Maximum number of frames gathered before they are forwarded.
+ *
+ * @see ws_owire::accept_slices
+ * @see ws_owire_begin_batch()
+ */
+#define WS_OWIRE_FRAMES 8
+
+/*!
+ * @brief Reference to a span of bytes to transfer.
+ *
+ * @see ws_owire::accept_slices
+ */
+struct ws_owire_slice
+{
+    /*!
+     * @brief Array of bytes to transfer.
+     */
+    const void * data;
+
+    /*!
+     * @brief Number of bytes in @a data.
+     */
+    uint64 size;
+};
+
+/*!
+ * @brief Description of a complete message to encode.
+ *
+ * @see ws_owire_put_batch()
+ */
+struct ws_owire_message
+{
+    /*!
+     * @brief The message type (text, data, ping, etc.).
+     */
+    ws_type type;
+
+    /*!
+     * @brief Message payload.
+     */
+    const void * data;
+
+    /*!
+     * @brief Number of bytes in @a data.
+     */
+    uint64 size;
+
+    /*!
+     * @brief Extension code, 3-bit value.
+     */
+    int extension;
+};
+
 /*!
  * @brief Writer error codes.
  */
@@ -122,6 +177,35 @@ struct ws_owire
     void(*accept_content)
         (struct ws_owire * wire, const void * data, uint64 size);
 
+    /*!
+     * @public
+     * @brief Called to signal that a list of spans should be transferred.
+     * @param wire The current writer state.
+     * @param slices Array of spans to be transferred to the peer, in order.
+     *  Accessing past @a count spans in this array results in undefined
+     *  behavior.
+     * @param count Number of spans in @a slices (at most
+     *  2*@c WS_OWIRE_FRAMES).
+     *
+     * This callback is optional.  When set, it replaces @c accept_content()
+     * for all output and lets the application transfer a frame's header and
+     * payload with a single scatter/gather operation (e.g. @c writev() or
+     * @c sendmsg()).  The high-level writer API functions pass the frame
+     * header and the payload in the same call.  Between calls to
+     * @c ws_owire_begin_batch() and @c ws_owire_end_batch(), several frames
+     * are passed in the same call.
+     *
+     * Unmasked payloads refer directly to the application's data.  Masked
+     * payloads are staged in @c buffer, or in a temporary buffer if the
+     * application doesn't provide one.  In all cases, the spans are only valid
+     * for the duration of the call.
+     *
+     * @see baton
+     * @see ws_owire_begin_batch()
+     */
+    void(*accept_slices)(struct ws_owire * wire,
+                         const struct ws_owire_slice * slices, int count);
+
     /*!
      * @public
      * @brief Called to signal that a mask must be generated.
@@ -186,10 +270,37 @@ struct ws_owire
      */
     int mask_payload;
 
+    /*!
+     * @public
+     * @brief Optional application buffer used to stage masked payloads.
+     *
+     * Masked payloads cannot be forwarded directly from the application's
+     * data, so the writer masks them into a staging area before calling
+     * @c accept_content().  By default, a small buffer on the stack is used
+     * and large frames are forwarded in many chunks.  Set this to an
+     * application-owned buffer of @c buffer_size bytes to receive masked
+     * payloads directly: any frame that fits is then written with exactly one
+     * call for the header and one call for the payload.
+     *
+     * This buffer is only used when @c mask_payload is enabled.
+     *
+     * @see buffer_size
+     * @see mask_payload
+     */
+    void * buffer;
+
+    /*!
+     * @public
+     * @brief Size of @c buffer, in bytes.
+     *
+     * @see buffer
+     */
+    uint64 buffer_size;
+
     /*!
      * @internal
      * @private
-     * @brief
+     * @brief Current frame's mask, if any.
      */
     uint8 mask[4];
 
@@ -220,6 +331,50 @@ struct ws_owire
      * @brief Handles payload output to the application, masking if necessary.
      */
     ws_owire_handler handler;
+
+    /*!
+     * @internal
+     * @private
+     * @brief 1 if frames should be held until the end of the batch, else 0.
+     *
+     * @see ws_owire_begin_batch()
+     */
+    int batch;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Storage for headers of gathered frames.
+     */
+    uint8 headers[WS_OWIRE_FRAMES][14];
+
+    /*!
+     * @internal
+     * @private
+     * @brief Gathered spans, waiting to be passed to @c accept_slices().
+     */
+    struct ws_owire_slice slices[2*WS_OWIRE_FRAMES];
+
+    /*!
+     * @internal
+     * @private
+     * @brief Number of gathered frames.
+     */
+    int frames;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Number of gathered spans.
+     */
+    int count;
+
+    /*!
+     * @internal
+     * @private
+     * @brief Number of bytes of masked payload staged in @c buffer.
+     */
+    uint64 staged;
 };
 
 /*!
@@ -274,6 +429,73 @@ void ws_owire_end_frame ( struct ws_owire * stream );
 uint64 ws_owire_feed
     ( struct ws_owire * stream, const void * data, uint64 size );
 
+/*!
+ * @brief Start gathering frames to forward them together.
+ * @param stream The current writer state.
+ *
+ * Until @c ws_owire_end_batch() is called, frames sent with the high-level
+ * writer API functions are held and forwarded together in a single call to
+ * @c ws_owire::accept_slices() (in groups of at most @c WS_OWIRE_FRAMES
+ * frames).  This allows the application to transfer many small messages with
+ * a single system call.
+ *
+ * This has no effect unless @c ws_owire::accept_slices is set.
+ *
+ * @warning Unmasked payloads are not copied.  The application must keep the
+ *  data passed to the high-level writer API functions valid until the call to
+ *  @c ws_owire_end_batch().
+ *
+ * @see ws_owire_end_batch()
+ */
+void ws_owire_begin_batch ( struct ws_owire * stream );
+
+/*!
+ * @brief Forward all gathered frames.
+ * @param stream The current writer state.
+ *
+ * @see ws_owire_begin_batch()
+ */
+void ws_owire_end_batch ( struct ws_owire * stream );
+
+/*!
+ * @brief Compute the encoded size of a list of messages.
+ * @param stream The current writer state.
+ * @param messages Array of messages.  Accessing past @a count messages in this
+ *  array results in undefined behavior.
+ * @param count Number of messages in @a messages.
+ * @return The number of bytes @c ws_owire_put_batch() will write.
+ *
+ * @see ws_owire_put_batch()
+ */
+uint64 ws_owire_batch_size ( const struct ws_owire * stream,
+                             const struct ws_owire_message * messages,
+                             uint64 count );
+
+/*!
+ * @brief Encode a list of complete messages into a contiguous buffer.
+ * @param stream The current writer state.
+ * @param messages Array of messages.  Accessing past @a count messages in this
+ *  array results in undefined behavior.
+ * @param count Number of messages in @a messages.
+ * @param output Buffer that receives the encoded frames.  It must be at least
+ *  as large as the size returned by @c ws_owire_batch_size().
+ * @return The number of bytes written to @a output.
+ *
+ * Each message is encoded as a single frame, masked if @c
+ * ws_owire::mask_payload is set.  Masked payloads are masked as they are
+ * copied.  The callbacks are @e not invoked: the application is expected to
+ * transfer the whole buffer at once, e.g. using a single system call per
+ * event loop iteration.
+ *
+ * @note Messages are never fragmented, regardless of the
+ *  @c ws_owire::auto_fragment setting.
+ *
+ * @see ws_owire_batch_size()
+ */
+uint64 ws_owire_put_batch ( struct ws_owire * stream,
+                            const struct ws_owire_message * messages,
+                            uint64 count, void * output );
+
 /*!
  * @brief Send a full text message in a single call.
  * @param stream The current writer state.
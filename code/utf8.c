@@ -0,0 +1,531 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file utf8.c
+ * @brief UTF-8 validation for Web Socket text messages in C.
+ *
+ * Multi-byte sequences are validated with the "lookup" algorithm described
+ * by John Keiser and Daniel Lemire in "Validating UTF-8 In Less Than One
+ * Instruction Per Byte" (2020): three 16-entry tables, indexed by nibbles of
+ * each byte and of the byte before it, flag all invalid 2-byte patterns and
+ * the remaining checks only involve saturated subtractions.
+ *
+ * @see http://tools.ietf.org/html/rfc3629#section-4
+ */
+
+#include "utf8.h"
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   define WS_UTF8_SSSE3 1
+#   define WS_UTF8_SSSE3_TARGET __attribute__((target("ssse3")))
+#   define WS_UTF8_AVX2 1
+#   define WS_UTF8_AVX2_TARGET __attribute__((target("avx2")))
+#   include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#   define WS_UTF8_NEON 1
+#   include <arm_neon.h>
+#endif
+
+/*!
+ * @internal
+ * @brief Function prototype of validator implementations.
+ * @param data Array of bytes to validate, starting on a character boundary.
+ * @param size Number of bytes in @a data.
+ * @param used Receives the number of bytes validated, ending on a character
+ *  boundary.  The remaining bytes are left to the decoder.
+ * @return 1 if the validated bytes are valid UTF-8, else 0.
+ */
+typedef int(*ws_utf8_handler)
+    (const uint8 * data, uint64 size, uint64 * used);
+
+/*!
+ * @internal
+ * @brief Decoder state for a character boundary.
+ */
+#define _WS_UTF8_ACCEPT 0
+
+/*!
+ * @internal
+ * @brief Decoder state after invalid data.
+ */
+#define _WS_UTF8_REJECT 1
+
+/*!
+ * @internal
+ * @brief Byte classes for the decoder.
+ *
+ * 0: ASCII, 1: 80-8F, 2: 90-9F, 3: A0-BF, 4: never valid, 5: C2-DF, 6: E0,
+ * 7: E1-EC and EE-EF, 8: ED, 9: F0, 10: F1-F3, 11: F4.
+ */
+static const uint8 _ws_utf8_classes[256] = {
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+     2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,
+     3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,
+     3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,
+     4,  4,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+     5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+     6,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  8,  7,  7,
+     9, 10, 10, 10, 11,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,
+};
+
+/*!
+ * @internal
+ * @brief Decoder state transitions, indexed by state and byte class.
+ *
+ * States 2, 3 and 7 expect 1, 2 and 3 more continuation bytes.  States 4, 5,
+ * 6 and 8 expect restricted second bytes after E0, ED, F0 and F4, which rule
+ * out overlong forms, surrogates and code points above U+10FFFF.
+ */
+static const uint8 _ws_utf8_states[9][12] = {
+    { 0, 1, 1, 1, 1, 2, 4, 3, 5, 6, 7, 8 },
+    { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+    { 1, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1 },
+    { 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1 },
+    { 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1 },
+    { 1, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+    { 1, 1, 3, 3, 1, 1, 1, 1, 1, 1, 1, 1 },
+    { 1, 3, 3, 3, 1, 1, 1, 1, 1, 1, 1, 1 },
+    { 1, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+};
+
+/*!
+ * @internal
+ * @brief Error flags for the first byte's high nibble.
+ */
+static const uint8 _ws_utf8_byte_1_high[16] = {
+    0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+    0x80, 0x80, 0x80, 0x80, 0x21, 0x01, 0x15, 0x49,
+};
+
+/*!
+ * @internal
+ * @brief Error flags for the first byte's low nibble.
+ */
+static const uint8 _ws_utf8_byte_1_low[16] = {
+    0xe7, 0xa3, 0x83, 0x83, 0x8b, 0xcb, 0xcb, 0xcb,
+    0xcb, 0xcb, 0xcb, 0xcb, 0xcb, 0xdb, 0xcb, 0xcb,
+};
+
+/*!
+ * @internal
+ * @brief Error flags for the second byte's high nibble.
+ */
+static const uint8 _ws_utf8_byte_2_high[16] = {
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+    0xe6, 0xae, 0xba, 0xba, 0x01, 0x01, 0x01, 0x01,
+};
+
+/*!
+ * @internal
+ * @brief Largest bytes that don't start a sequence truncated by the end of a
+ *  block (the last 16 or 32 entries are used).
+ */
+static const uint8 _ws_utf8_limits[32] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0xdf, 0xbf,
+};
+
+/*!
+ * @internal
+ * @brief Find the last character boundary in (valid) data.
+ * @return The position of the first byte of a trailing, incomplete sequence,
+ *  or @a size if the data ends on a character boundary.
+ */
+static uint64 _ws_utf8_boundary ( const uint8 * data, uint64 size )
+{
+    uint64 back = 1;
+    for ( ; (back <= 3) && (back <= size); ++back )
+    {
+        const uint8 byte = data[size-back];
+        if ( byte < 0x80 ) {
+            break;
+        }
+        if ( byte >= 0xc0 ) {
+            const uint64 length = (byte >= 0xf0)? 4 : ((byte >= 0xe0)? 3 : 2);
+            return ((length > back)? size-back : size);
+        }
+    }
+    return (size);
+}
+
+/*!
+ * @internal
+ * @brief Portable implementation, skips ASCII 64 bits at a time.
+ *
+ * Multi-byte sequences are left to the decoder.
+ */
+static int _ws_utf8_scalar
+    ( const uint8 * data, uint64 size, uint64 * used )
+{
+    uint64 next = 0;
+    uint64 word = 0;
+    for ( ; (size-next) >= 8; next += 8 )
+    {
+        memcpy(&word, data+next, 8);
+        if ((word & 0x8080808080808080ull) != 0) {
+            break;
+        }
+    }
+    for ( ; (next < size) && (data[next] < 0x80); ++next ) {
+    }
+    *used = next;
+    return (1);
+}
+
+#ifdef WS_UTF8_SSSE3
+/*!
+ * @internal
+ * @brief SSSE3 implementation, processes 128 bits at a time.
+ *
+ * This is compiled for SSSE3 regardless of the compiler flags and must only
+ * be selected after checking that the processor supports it.
+ */
+static WS_UTF8_SSSE3_TARGET int _ws_utf8_ssse3
+    ( const uint8 * data, uint64 size, uint64 * used )
+{
+    const __m128i byte_1_high =
+        _mm_loadu_si128((const __m128i*)_ws_utf8_byte_1_high);
+    const __m128i byte_1_low =
+        _mm_loadu_si128((const __m128i*)_ws_utf8_byte_1_low);
+    const __m128i byte_2_high =
+        _mm_loadu_si128((const __m128i*)_ws_utf8_byte_2_high);
+    const __m128i limits =
+        _mm_loadu_si128((const __m128i*)(_ws_utf8_limits+16));
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i third = _mm_set1_epi8(0xe0-0x80);
+    const __m128i fourth = _mm_set1_epi8(0xf0-0x80);
+    const __m128i high = _mm_set1_epi8((char)0x80);
+    __m128i previous = _mm_setzero_si128();
+    __m128i incomplete = _mm_setzero_si128();
+    __m128i error = _mm_setzero_si128();
+    uint64 next = 0;
+    for ( ; (size-next) >= 16; next += 16 )
+    {
+        const __m128i input = _mm_loadu_si128((const __m128i*)(data+next));
+        // ASCII only: just make sure the previous block was complete.
+        if ( _mm_movemask_epi8(input) == 0 ) {
+            error = _mm_or_si128(error, incomplete);
+        }
+        else
+        {
+            const __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+            const __m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+            const __m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+            // flag invalid pairs of bytes.
+            const __m128i special = _mm_and_si128(_mm_and_si128(
+                _mm_shuffle_epi8(byte_1_high,
+                    _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+                _mm_shuffle_epi8(byte_1_low,
+                    _mm_and_si128(prev1, nibble))),
+                _mm_shuffle_epi8(byte_2_high,
+                    _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+            // 3rd and 4th bytes of sequences must be continuation bytes.
+            const __m128i must23 = _mm_and_si128(_mm_or_si128(
+                _mm_subs_epu8(prev2, third),
+                _mm_subs_epu8(prev3, fourth)), high);
+            error = _mm_or_si128(error, _mm_xor_si128(must23, special));
+        }
+        incomplete = _mm_subs_epu8(input, limits);
+        previous = input;
+    }
+    if ( _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128()))
+         != 0xffff )
+    {
+        return (0);
+    }
+    *used = _ws_utf8_boundary(data, next);
+    if ( *used == next ) {
+        _ws_utf8_scalar(data+next, size-next, &next), *used += next;
+    }
+    return (1);
+}
+#endif
+
+#ifdef WS_UTF8_AVX2
+/*!
+ * @internal
+ * @brief AVX2 implementation, processes 256 bits at a time.
+ *
+ * This is compiled for AVX2 regardless of the compiler flags and must only be
+ * selected after checking that the processor supports it.
+ */
+static WS_UTF8_AVX2_TARGET int _ws_utf8_avx2
+    ( const uint8 * data, uint64 size, uint64 * used )
+{
+    const __m256i byte_1_high = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i*)_ws_utf8_byte_1_high));
+    const __m256i byte_1_low = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i*)_ws_utf8_byte_1_low));
+    const __m256i byte_2_high = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i*)_ws_utf8_byte_2_high));
+    const __m256i limits =
+        _mm256_loadu_si256((const __m256i*)_ws_utf8_limits);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i third = _mm256_set1_epi8(0xe0-0x80);
+    const __m256i fourth = _mm256_set1_epi8(0xf0-0x80);
+    const __m256i high = _mm256_set1_epi8((char)0x80);
+    __m256i previous = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    __m256i error = _mm256_setzero_si256();
+    uint64 next = 0;
+    for ( ; (size-next) >= 32; next += 32 )
+    {
+        const __m256i input =
+            _mm256_loadu_si256((const __m256i*)(data+next));
+        // ASCII only: just make sure the previous block was complete.
+        if ( _mm256_movemask_epi8(input) == 0 ) {
+            error = _mm256_or_si256(error, incomplete);
+        }
+        else
+        {
+            // previous block's upper half and this block's lower half.
+            const __m256i shifted =
+                _mm256_permute2x128_si256(previous, input, 0x21);
+            const __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+            const __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+            const __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+            // flag invalid pairs of bytes.
+            const __m256i special = _mm256_and_si256(_mm256_and_si256(
+                _mm256_shuffle_epi8(byte_1_high,
+                    _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+                _mm256_shuffle_epi8(byte_1_low,
+                    _mm256_and_si256(prev1, nibble))),
+                _mm256_shuffle_epi8(byte_2_high,
+                    _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+            // 3rd and 4th bytes of sequences must be continuation bytes.
+            const __m256i must23 = _mm256_and_si256(_mm256_or_si256(
+                _mm256_subs_epu8(prev2, third),
+                _mm256_subs_epu8(prev3, fourth)), high);
+            error = _mm256_or_si256(error, _mm256_xor_si256(must23, special));
+        }
+        incomplete = _mm256_subs_epu8(input, limits);
+        previous = input;
+    }
+    if ( !_mm256_testz_si256(error, error) ) {
+        return (0);
+    }
+    *used = _ws_utf8_boundary(data, next);
+    if ( *used == next ) {
+        _ws_utf8_scalar(data+next, size-next, &next), *used += next;
+    }
+    return (1);
+}
+#endif
+
+#ifdef WS_UTF8_NEON
+/*!
+ * @internal
+ * @brief NEON implementation, processes 128 bits at a time.
+ */
+static int _ws_utf8_neon
+    ( const uint8 * data, uint64 size, uint64 * used )
+{
+    const uint8x16_t byte_1_high = vld1q_u8(_ws_utf8_byte_1_high);
+    const uint8x16_t byte_1_low = vld1q_u8(_ws_utf8_byte_1_low);
+    const uint8x16_t byte_2_high = vld1q_u8(_ws_utf8_byte_2_high);
+    const uint8x16_t limits = vld1q_u8(_ws_utf8_limits+16);
+    const uint8x16_t nibble = vdupq_n_u8(0x0f);
+    const uint8x16_t third = vdupq_n_u8(0xe0-0x80);
+    const uint8x16_t fourth = vdupq_n_u8(0xf0-0x80);
+    const uint8x16_t high = vdupq_n_u8(0x80);
+    uint8x16_t previous = vdupq_n_u8(0);
+    uint8x16_t incomplete = vdupq_n_u8(0);
+    uint8x16_t error = vdupq_n_u8(0);
+    uint64 next = 0;
+    for ( ; (size-next) >= 16; next += 16 )
+    {
+        const uint8x16_t input = vld1q_u8(data+next);
+        // ASCII only: just make sure the previous block was complete.
+        if ( vmaxvq_u8(input) < 0x80 ) {
+            error = vorrq_u8(error, incomplete);
+        }
+        else
+        {
+            const uint8x16_t prev1 = vextq_u8(previous, input, 15);
+            const uint8x16_t prev2 = vextq_u8(previous, input, 14);
+            const uint8x16_t prev3 = vextq_u8(previous, input, 13);
+            // flag invalid pairs of bytes.
+            const uint8x16_t special = vandq_u8(vandq_u8(
+                vqtbl1q_u8(byte_1_high, vshrq_n_u8(prev1, 4)),
+                vqtbl1q_u8(byte_1_low, vandq_u8(prev1, nibble))),
+                vqtbl1q_u8(byte_2_high, vshrq_n_u8(input, 4)));
+            // 3rd and 4th bytes of sequences must be continuation bytes.
+            const uint8x16_t must23 = vandq_u8(vorrq_u8(
+                vqsubq_u8(prev2, third),
+                vqsubq_u8(prev3, fourth)), high);
+            error = vorrq_u8(error, veorq_u8(must23, special));
+        }
+        incomplete = vqsubq_u8(input, limits);
+        previous = input;
+    }
+    if ( vmaxvq_u8(error) != 0 ) {
+        return (0);
+    }
+    *used = _ws_utf8_boundary(data, next);
+    if ( *used == next ) {
+        _ws_utf8_scalar(data+next, size-next, &next), *used += next;
+    }
+    return (1);
+}
+#endif
+
+/*!
+ * @internal
+ * @brief Check whether the implementation called @a name was asked for.
+ * @param want Name of the implementation asked for, or 0 for any.
+ */
+static int _ws_utf8_wants ( const char * want, const char * name )
+{
+    return ((want == 0) || (strcmp(want, name) == 0));
+}
+
+/*!
+ * @internal
+ * @brief Pick the best implementation available on this processor.
+ * @param want Name of the implementation to pick, or 0 for the best one.
+ * @return 0 if @a want is not available.
+ */
+static ws_utf8_handler _ws_utf8_select ( const char * want, const char ** name )
+{
+#ifdef WS_UTF8_AVX2
+    if (_ws_utf8_wants(want, "avx2") && __builtin_cpu_supports("avx2")) {
+        return (*name = "avx2", &_ws_utf8_avx2);
+    }
+#endif
+#ifdef WS_UTF8_SSSE3
+    if (_ws_utf8_wants(want, "ssse3") && __builtin_cpu_supports("ssse3")) {
+        return (*name = "ssse3", &_ws_utf8_ssse3);
+    }
+#endif
+#ifdef WS_UTF8_NEON
+    if (_ws_utf8_wants(want, "neon")) {
+        return (*name = "neon", &_ws_utf8_neon);
+    }
+#endif
+    if (_ws_utf8_wants(want, "scalar")) {
+        return (*name = "scalar", &_ws_utf8_scalar);
+    }
+    return (0);
+}
+
+/*!
+ * @internal
+ * @brief Selected implementation, resolved on first use.
+ *
+ * Concurrent first uses may race to resolve this, but they all store the
+ * same values.
+ */
+static ws_utf8_handler _ws_utf8_handler = 0;
+
+/*!
+ * @internal
+ * @brief Name of the selected implementation.
+ *
+ * @see _ws_utf8_handler
+ */
+static const char * _ws_utf8_name = 0;
+
+void ws_utf8_init ( struct ws_utf8 * stream )
+{
+    stream->state = _WS_UTF8_ACCEPT;
+}
+
+int ws_utf8_feed ( struct ws_utf8 * stream, const void * data, uint64 size )
+{
+    const uint8 *const bytes = (const uint8*)data;
+    uint64 used = 0;
+    int state = stream->state;
+    if ( _ws_utf8_handler == 0 ) {
+        _ws_utf8_handler = _ws_utf8_select(0, &_ws_utf8_name);
+    }
+    while ((used < size) && (state != _WS_UTF8_REJECT))
+    {
+        // validate in bulk from character boundaries.
+        if ( state == _WS_UTF8_ACCEPT )
+        {
+            uint64 pass = 0;
+            if ( !_ws_utf8_handler(bytes+used, size-used, &pass) ) {
+                state = _WS_UTF8_REJECT; break;
+            }
+            used += pass;
+        }
+        // decode (the rest of) one character.
+        while ( used < size )
+        {
+            state = _ws_utf8_states[state][_ws_utf8_classes[bytes[used++]]];
+            if ((state == _WS_UTF8_ACCEPT) || (state == _WS_UTF8_REJECT)) {
+                break;
+            }
+        }
+    }
+    stream->state = state;
+    return (state != _WS_UTF8_REJECT);
+}
+
+int ws_utf8_done ( const struct ws_utf8 * stream )
+{
+    return (stream->state == _WS_UTF8_ACCEPT);
+}
+
+int ws_utf8_check ( const void * data, uint64 size )
+{
+    struct ws_utf8 stream;
+    ws_utf8_init(&stream);
+    return (ws_utf8_feed(&stream, data, size) && ws_utf8_done(&stream));
+}
+
+const char * ws_utf8_engine ( void )
+{
+    if ( _ws_utf8_handler == 0 ) {
+        _ws_utf8_handler = _ws_utf8_select(0, &_ws_utf8_name);
+    }
+    return (_ws_utf8_name);
+}
+
+int ws_utf8_override ( const char * name )
+{
+    const char * found = 0;
+    const ws_utf8_handler handler = _ws_utf8_select(name, &found);
+    if ( handler == 0 ) {
+        return (0);
+    }
+    _ws_utf8_handler = handler, _ws_utf8_name = found;
+    return (1);
+}
@@ -0,0 +1,126 @@
+#ifndef _utf8_h__
+#define _utf8_h__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// 
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// 
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file utf8.h
+ * @brief UTF-8 validation for Web Socket text messages in C.
+ *
+ * @see http://tools.ietf.org/html/rfc6455#section-8.1
+ * @see http://tools.ietf.org/html/rfc3629#section-4
+ */
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * @brief Streaming UTF-8 validator.
+ *
+ * Data may be split anywhere, including inside multi-byte sequences.
+ *
+ * @see ws_utf8_feed()
+ */
+struct ws_utf8
+{
+    /*!
+     * @internal
+     * @private
+     * @brief Decoder state (0 on a character boundary).
+     */
+    int state;
+};
+
+/*!
+ * @brief Initialize a validator.
+ * @param stream Uninitialized validator.
+ */
+void ws_utf8_init ( struct ws_utf8 * stream );
+
+/*!
+ * @brief Validate the next span of a text.
+ * @param stream Current validator state.
+ * @param data Array of bytes to validate.  Accessing past @a size bytes in
+ *  this array results in undefined behavior.
+ * @param size Number of bytes in @a data.
+ * @return 1 if the text is valid so far, else 0.  Once invalid data is
+ *  detected, the validator keeps returning 0.
+ *
+ * Runs of ASCII characters are skipped a machine word (or vector register,
+ * when the processor supports them) at a time and multi-byte sequences are
+ * checked with vector table lookups, 16 or 32 bytes at a time.  The best
+ * available implementation is selected at run time, on first use.
+ *
+ * @see ws_utf8_done()
+ * @see ws_utf8_engine()
+ */
+int ws_utf8_feed ( struct ws_utf8 * stream, const void * data, uint64 size );
+
+/*!
+ * @brief Check that the text doesn't end in the middle of a character.
+ * @param stream Current validator state.
+ * @return 1 if the text seen so far is complete and valid, else 0.
+ */
+int ws_utf8_done ( const struct ws_utf8 * stream );
+
+/*!
+ * @brief Validate a complete text.
+ * @param data Array of bytes to validate.  Accessing past @a size bytes in
+ *  this array results in undefined behavior.
+ * @param size Number of bytes in @a data.
+ * @return 1 if @a data is valid UTF-8, else 0.
+ */
+int ws_utf8_check ( const void * data, uint64 size );
+
+/*!
+ * @brief Name the validator implementation selected for this processor.
+ * @return One of "avx2", "ssse3", "neon" or "scalar".
+ *
+ * This is mostly useful for labeling benchmark results.
+ */
+const char * ws_utf8_engine ( void );
+
+/*!
+ * @internal
+ * @brief Force the validation implementation, for testing.
+ * @param name One of the names returned by @c ws_utf8_engine(), or 0 to select
+ *  the best implementation again.
+ * @return 1 if that implementation is available on this processor, else 0
+ *  (the current selection is kept).
+ *
+ * This is not thread-safe: call it only while no other thread validates text.
+ */
+int ws_utf8_override ( const char * name );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _utf8_h__ */
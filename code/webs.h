@@ -104,10 +104,9 @@
  *      standard_input = ...;
  *      socket_object = ...;
  *
- *      // use external HTTP parser, base64, SA-11 and whatenot libraries
- *      // to implement the WebSocket handshake (not provided by this
- *      // library).  look at the complete demo programs for concrete
- *      // implementation using only light-weight open source libraries.
+ *      // exchange the HTTP upgrade with 'ws_handshake' and compute the
+ *      // 'Sec-WebSocket-Accept' value with 'ws_accept_key'.  look at the
+ *      // complete demo programs for concrete implementation.
  *      // ...
  *
  *      ws_iwire_init(&iwire);
@@ -147,8 +146,17 @@
  */
 
 #include "types.h"
+#include "accept.h"
+#include "arena.h"
+#include "deflate.h"
+#include "frame.h"
+#include "handshake.h"
+#include "imessage.h"
 #include "iwire.h"
+#include "mask.h"
+#include "oqueue.h"
 #include "owire.h"
+#include "utf8.h"
 
 #endif /* _webs_h__ */
 
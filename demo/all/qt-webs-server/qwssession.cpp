@@ -87,6 +87,11 @@ namespace qws {
         myOWire.baton = this;
         myOWire.accept_content = &Session::accept_obound_content;
         
+          // Shrink the receive buffer after a second without traffic.
+        myQuiet.setSingleShot(true);
+        myQuiet.setInterval(1000);
+        QObject::connect(&myQuiet, SIGNAL(timeout()), this, SLOT(idle()));
+        
           // Delete this wrapper object when the socket is disconnected.
         QObject::connect(
             socket, SIGNAL(disconnected()), this, SLOT(deleteLater()));
@@ -109,6 +114,11 @@ namespace qws {
             this,   SLOT(pong(const void*,quint64)));
     }
 
+    const ::ReceiveBuffer& Session::input () const
+    {
+        return (myInput);
+    }
+
     void Session::sendtext ( const void * data, quint64 size )
     {
         ::ws_owire_put_text(&myOWire, data, size);
@@ -169,13 +179,16 @@ namespace qws {
         if ( myState == Open )
         {
               // Read all available data and feed websocket parser.
-            char data[1024];
             qint64 size = 0;
             do {
-                size = mySocket->read(data, sizeof(data));
-                ::ws_iwire_feed(&myIWire, data, size);
+                size = mySocket->read(myInput.data(), myInput.size());
+                if ( size > 0 ) {
+                    ::ws_iwire_feed(&myIWire, myInput.data(), size);
+                    myInput.update(size);
+                }
             }
             while ( size > 0 );
+            myQuiet.start();
         }
           // Complete web socket handshake.
         else if ( myState == Connecting )
@@ -248,6 +261,11 @@ namespace qws {
         }
     }
 
+    void Session::idle ()
+    {
+        myInput.idle();
+    }
+
     void Session::shutdown ()
     {
           // Start websocket closing handshake.
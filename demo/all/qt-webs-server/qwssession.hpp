@@ -34,10 +34,12 @@
 
 #include "ws.hpp"
 #include "Request.hpp"
+#include "buffer.hpp"
 
 #include <QtNetwork>
 #include <QObject>
 #include <QScopedPointer>
+#include <QTimer>
 
 namespace qws {
 
@@ -74,6 +76,10 @@ namespace qws {
         ::ws_iwire myIWire;
         ::ws_owire myOWire;
 
+          // Grows under sustained traffic, shrinks back when it calms down.
+        ::ReceiveBuffer myInput;
+        QTimer myQuiet;
+
         /* construction. */
     public:
         /*!
@@ -108,6 +114,11 @@ namespace qws {
          */
         void autopong ();
 
+        /*!
+         * @brief Buffer used to read websocket traffic, and its statistics.
+         */
+        const ::ReceiveBuffer& input () const;
+
         /*!
          * @brief Send a UTF-8 encoded text message over the wire.
          * @param data Pointer to first byte of UTF-8 text to send.
@@ -390,6 +401,9 @@ namespace qws {
         // Handle data received on socket.  Feed appropriate low-level parser.
         void consume ();
 
+        // Release the receive buffer once the peer has gone quiet.
+        void idle ();
+
         /* class methods. */
     private:
         // Callbacks registered with low-level incremental parsers.
@@ -0,0 +1,184 @@
+#ifndef _buffer_hpp__
+#define _buffer_hpp__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file demo/buffer.hpp
+ * @brief Receive buffer that adapts its size to the traffic.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+/*!
+ * @brief Read buffer that grows under sustained throughput.
+ *
+ * Read loops pass the buffer to @c read() and report how many bytes they got
+ * through @c update().  Reads that fill the buffer mean more data is probably
+ * queued, so the buffer doubles after a few of them in a row.  Reads that use
+ * less than a quarter of it halve it after a while, and @c idle() releases
+ * everything above the minimum size.  Bulk transfers then need fewer system
+ * calls and parser dispatches, while idle connections stay small.
+ */
+class ReceiveBuffer
+{
+    /* data. */
+private:
+    std::vector<char> myData;
+    std::size_t myLower;
+    std::size_t myUpper;
+
+      // consecutive full and lightly used reads.
+    int myFull;
+    int myLight;
+
+      // statistics.
+    std::size_t myPeak;
+    unsigned long long myReads;
+    unsigned long long myBytes;
+
+    /* construction. */
+public:
+    explicit ReceiveBuffer
+        ( std::size_t lower=1024, std::size_t upper=256*1024 )
+        : myData(lower), myLower(lower), myUpper(upper),
+          myFull(0), myLight(0), myPeak(lower), myReads(0), myBytes(0)
+    {
+    }
+
+    /* methods. */
+public:
+    char * data ()
+    {
+        return (&myData[0]);
+    }
+
+    /*!
+     * @brief Current size, in bytes.
+     */
+    std::size_t size () const
+    {
+        return (myData.size());
+    }
+
+    /*!
+     * @brief Check if the buffer is larger than its minimum size.
+     */
+    bool grown () const
+    {
+        return (myData.size() > myLower);
+    }
+
+    /*!
+     * @brief Largest size reached so far, in bytes.
+     */
+    std::size_t peak () const
+    {
+        return (myPeak);
+    }
+
+    /*!
+     * @brief Number of reads reported through @c update().
+     */
+    unsigned long long reads () const
+    {
+        return (myReads);
+    }
+
+    /*!
+     * @brief Number of bytes reported through @c update().
+     */
+    unsigned long long bytes () const
+    {
+        return (myBytes);
+    }
+
+    /*!
+     * @brief Account for a read and adjust the size for the next one.
+     * @param used Number of bytes the read returned.
+     *
+     * @warning The buffer contents and @c data() are invalidated when the
+     *  size changes.  Finish processing the data before calling this.
+     */
+    void update ( std::size_t used )
+    {
+        if ( used == 0 ) {
+            return;
+        }
+        ++myReads, myBytes += used;
+        if ( used == size() ) {
+            myLight = 0;
+            if ((++myFull >= 2) && (size() < myUpper)) {
+                resize(std::min(2*size(), myUpper)), myFull = 0;
+            }
+        }
+        else if ( used < size()/4 ) {
+            myFull = 0;
+            if ((++myLight >= 8) && (size() > myLower)) {
+                resize(std::max(size()/2, myLower)), myLight = 0;
+            }
+        }
+        else {
+            myFull = myLight = 0;
+        }
+    }
+
+    /*!
+     * @brief Drop back to the minimum size, e.g. when no data has arrived
+     *  for a while.
+     */
+    void idle ()
+    {
+        myFull = myLight = 0;
+        if ( size() > myLower ) {
+            resize(myLower);
+        }
+    }
+
+private:
+    void resize ( std::size_t size )
+    {
+        // swap rather than resize: contents needn't be kept, and this
+        // releases memory when the buffer shrinks.
+        std::vector<char>(size).swap(myData);
+        myPeak = std::max(myPeak, size);
+    }
+};
+
+inline std::ostream& operator<<
+    ( std::ostream& stream, const ReceiveBuffer& buffer )
+{
+    return (stream
+        << buffer.bytes() << " bytes in " << buffer.reads() << " reads, "
+        << "buffer at " << buffer.size() << " bytes "
+        << "(peak " << buffer.peak() << ")");
+}
+
+#endif /* _buffer_hpp__ */
@@ -33,11 +33,9 @@
 #include "Client.hpp"
 
 #include "b64.hpp"
-#include "Digest.hpp"
-#include "http.hpp"
+#include "Error.hpp"
 
-#include <iostream>
-#include <sstream>
+#include <algorithm>
 
 namespace nix {
 
@@ -55,63 +53,54 @@ namespace nix {
             handshake(host, data, sizeof(data)));
     }
 
+    std::string Client::nonce ()
+    {
+        char random[16];
+        nix::File stream("/dev/random");
+        stream.getall(random, sizeof(random));
+        return (b64::encode(std::string(random, sizeof(random))));
+    }
+
     std::size_t Client::handshake
         ( const std::string& host, char * data, std::size_t size )
     {
-        // Generate a nonce.
-        std::string nonce(16, '\0');
-        { 
-            nix::File stream("/dev/random");
-            char random[16];
-            stream.get(random, 16);
-            nonce.assign(random, 16);
-        }
-        nonce = b64::encode(nonce);
-        
+        return (handshake(host, nonce(), data, size));
+    }
+
+    std::size_t Client::handshake ( const std::string& host,
+        const std::string& nonce, char * data, std::size_t size )
+    {
         // Send HTTP upgrade request.
-        std::ostringstream request;
-        request
-            << "GET / HTTP/1.1"               << "\r\n"
-            << "Host: " << host               << "\r\n"
-            << "Upgrade: websocket"           << "\r\n"
-            << "Connection: upgrade"          << "\r\n"
-            << "Sec-WebSocket-Key: " << nonce << "\r\n"
-            << "Sec-WebSocket-Version: 13"    << "\r\n"
-            << "\r\n";
-        myPeer.putall(request.str());
-        
+        ::ws_handshake handshake;
+        ::ws_handshake_init(&handshake);
+        char request[512];
+        myPeer.putall(request, ::ws_handshake_request(&handshake,
+            host.c_str(), "/", nonce.c_str(), 0, request, sizeof(request)));
+
         // Wait for upgrade approval.
-        http::Response response;
         ::size_t used = 0;
         ::size_t pass = 0;
         do {
             pass = myPeer.get(data, size);
             if ( pass == 0 ) {
-                std::cerr << "Peer has finished." << std::endl;
-                break;
+                // Peer has finished before completing the response.
+                throw (Error(ECONNRESET));
             }
-            used = response.feed(data, pass);
+            used = ::ws_handshake_feed(&handshake, data, pass);
         }
-        while ( !response.complete() );
+        while ( !::ws_handshake_done(&handshake) );
 
         // Move leftover data at the beginning of the buffer.
         std::copy(data+used, data+pass, data);
-        
-        // Make sure we succeeded.
-        if (!response.complete()) {
-            std::cerr << "Did not finish HTTP response." << std::endl;
-        }
-        
+
         // Confirm handshake.
-        if (!http::ieq(response.header("Connection"),"Upgrade"  )||
-            !http::ieq(response.header("Upgrade"   ),"WebSocket"))
-        {
-            std::cerr << "Upgrade request denied." << std::endl;
+        if (handshake.status != ws_handshake_ok) {
+            // Upgrade request denied.
+            throw (Error(EPROTO));
         }
-        const std::string version = response.header("Sec-WebSocket-Version");
-        const std::string key = response.header("Sec-WebSocket-Accept");
-        if (key != approve_nonce(nonce)) {
-            std::cerr << "Invalid nonce reply." << std::endl;
+        if (::ws_handshake_key(&handshake) != approve_nonce(nonce)) {
+            // Invalid nonce reply.
+            throw (Error(EPROTO));
         }
 
         // Keep any leftovers for the wire protocol.
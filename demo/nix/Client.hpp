@@ -45,11 +45,32 @@ namespace nix {
     public:
         Client ( nix::File& host, nix::net::Stream& peer );
 
+        /* class methods. */
+    public:
+        /*!
+         * @brief Draw a fresh, base64-encoded nonce from @c /dev/random.
+         */
+        static std::string nonce ();
+
         /* methods. */
-    private:
+    public:
+        /*!
+         * @brief Send the upgrade request and wait for the server's answer.
+         * @param data Receive buffer, also used for the response.
+         * @return Number of bytes that followed the response, moved to the
+         *  start of @a data.
+         * @throw Error The peer closed the connection early, denied the
+         *  upgrade or replied with the wrong key.
+         */
         std::size_t handshake
             ( const std::string& host, char * data, std::size_t size );
 
+        /*!
+         * @brief Same, with a nonce obtained from @c nonce() ahead of time.
+         */
+        std::size_t handshake ( const std::string& host,
+            const std::string& nonce, char * data, std::size_t size );
+
         /* overrides. */
     protected:
         virtual void handshake ( const std::string& host );
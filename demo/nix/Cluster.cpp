@@ -0,0 +1,193 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file demo/nix/Cluster.cpp
+ */
+
+#include "Cluster.hpp"
+#include "Reactor.hpp"
+#include "Ring.hpp"
+#include "Thread.hpp"
+
+#include <sched.h>
+#include <iostream>
+
+namespace nix {
+
+    class Cluster::Worker
+    {
+        /* data. */
+    private:
+        Cluster& myCluster;
+        net::Listener myListener;
+        Loop * myLoop;
+        Thread * myThread;
+
+        /* construction. */
+    public:
+        Worker ( Cluster& cluster, bool uring )
+            : myCluster(cluster),
+              myListener(cluster.myEndpoint, false, true),
+              myLoop(0),
+              myThread(0)
+        {
+            if ( uring ) {
+                myLoop = new Ring();
+            }
+            else {
+                myLoop = new Reactor();
+            }
+        }
+
+    private:
+        Worker ( const Worker& );
+
+    public:
+        ~Worker ()
+        {
+            delete myThread;
+            delete myLoop;
+        }
+
+        /* methods. */
+    public:
+        void start ( int core )
+        {
+            myThread = new Thread(&Worker::entry, this, core);
+        }
+
+        void stop ()
+        {
+            myLoop->stop();
+        }
+
+        void join ()
+        {
+            if ( myThread != 0 ) {
+                myThread->join();
+                delete myThread, myThread = 0;
+            }
+        }
+
+    private:
+        void run ()
+        {
+            // connection state is allocated and used on this thread only.
+            Engine *const engine =
+                myCluster.myFactory(*myLoop, myListener, myCluster.myContext);
+            try {
+                myLoop->run();
+            }
+            catch ( ... ) {
+                delete engine; throw;
+            }
+            delete engine;
+        }
+
+        static void entry ( void * context )
+        try
+        {
+            static_cast<Worker*>(context)->run();
+        }
+        catch ( const std::exception& error )
+        {
+            std::cerr
+                << "Worker failed: '" << error.what() << "'."
+                << std::endl;
+        }
+
+        /* operators. */
+    private:
+        Worker& operator= ( const Worker& );
+    };
+
+    Cluster::Cluster ( net::Endpoint endpoint,
+                       Factory factory, void * context )
+        : myEndpoint(endpoint), myFactory(factory), myContext(context)
+    {
+    }
+
+    Cluster::~Cluster ()
+    {
+        stop();
+        for ( std::size_t i = 0; i < myWorkers.size(); ++i ) {
+            delete myWorkers[i];
+        }
+    }
+
+    std::size_t Cluster::cores ()
+    {
+        ::cpu_set_t cores;
+        CPU_ZERO(&cores);
+        if ( ::sched_getaffinity(0, sizeof(cores), &cores) < 0 ) {
+            return (1);
+        }
+        return (CPU_COUNT(&cores));
+    }
+
+    void Cluster::start ( std::size_t count, bool uring )
+    {
+        // fall back to epoll on older kernels.
+        uring = uring && Ring::supported();
+
+        // bind all listeners first so errors surface on this thread.
+        for ( std::size_t i = 0; i < count; ++i ) {
+            myWorkers.push_back(new Worker(*this, uring));
+        }
+
+        // assign workers to the processors we're allowed to use.
+        ::cpu_set_t cores;
+        CPU_ZERO(&cores);
+        if ( ::sched_getaffinity(0, sizeof(cores), &cores) < 0 ) {
+            throw (Error(errno));
+        }
+        std::vector<int> available;
+        for ( int core = 0; core < CPU_SETSIZE; ++core ) {
+            if ( CPU_ISSET(core, &cores) ) {
+                available.push_back(core);
+            }
+        }
+        for ( std::size_t i = 0; i < myWorkers.size(); ++i ) {
+            myWorkers[i]->start(available[i % available.size()]);
+        }
+    }
+
+    void Cluster::stop ()
+    {
+        for ( std::size_t i = 0; i < myWorkers.size(); ++i ) {
+            myWorkers[i]->stop();
+        }
+    }
+
+    void Cluster::join ()
+    {
+        for ( std::size_t i = 0; i < myWorkers.size(); ++i ) {
+            myWorkers[i]->join();
+        }
+    }
+
+}
@@ -0,0 +1,143 @@
+#ifndef _nix_Cluster_hpp__
+#define _nix_Cluster_hpp__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file demo/nix/Cluster.hpp
+ * @brief Thread-per-core WebSocket server.
+ */
+
+#include "nix/Endpoint.hpp"
+#include "nix/Engine.hpp"
+#include "nix/Listener.hpp"
+#include "nix/Loop.hpp"
+
+#include <vector>
+
+namespace nix {
+
+    /*!
+     * @brief Runs one @c Engine per worker thread on the same end point.
+     *
+     * Each worker binds its own @c SO_REUSEPORT listening socket, so the
+     * kernel spreads incoming connections between workers.  Workers are
+     * pinned to distinct processors and own their loop, engine and all
+     * of their connections' parser and writer state: nothing is shared
+     * between threads once the workers have started, so the hot path takes
+     * no locks.  Engines that need to talk to each other must arrange it
+     * themselves.
+     */
+    class Cluster
+    {
+        /* nested types. */
+    public:
+        /*!
+         * @brief Creates the engine for one worker, on that worker's thread.
+         */
+        typedef Engine*(*Factory)
+            (Loop& loop, net::Listener& listener, void * context);
+
+        /*!
+         * @brief Factory for engines constructible from a loop and a
+         *  listener.
+         */
+        template<typename T>
+        static Engine * create
+            ( Loop& loop, net::Listener& listener, void * context )
+        {
+            return (new T(loop, listener));
+        }
+
+    private:
+        class Worker;
+
+        /* data. */
+    private:
+        net::Endpoint myEndpoint;
+        Factory myFactory;
+        void * myContext;
+        std::vector<Worker*> myWorkers;
+
+        /* construction. */
+    public:
+        Cluster ( net::Endpoint endpoint, Factory factory, void * context=0 );
+
+    private:
+        Cluster ( const Cluster& );
+
+    public:
+        /*!
+         * @brief Stops and joins all workers.
+         */
+        ~Cluster ();
+
+        /* class methods. */
+    public:
+        /*!
+         * @brief Number of processors this process may run on.
+         */
+        static std::size_t cores ();
+
+        /* methods. */
+    public:
+        std::size_t workers () const
+        {
+            return (myWorkers.size());
+        }
+
+        /*!
+         * @brief Bind @a count listeners and start one worker for each.
+         *
+         * Listeners are bound before any thread starts, so configuration
+         * errors are reported here.  Worker @e i is pinned to the @e i-th
+         * available processor, wrapping around if there are more workers
+         * than processors.
+         *
+         * @param uring Drive workers with @c io_uring instead of @c epoll,
+         *  when the kernel supports it.
+         */
+        void start ( std::size_t count, bool uring=false );
+
+        /*!
+         * @brief Ask all workers to finish their current batch and exit.
+         *
+         * This is safe to call from any thread or from a signal handler.
+         *
+         * @see Loop::stop()
+         */
+        void stop ();
+
+        /*!
+         * @brief Wait until all workers have exited.
+         */
+        void join ();
+    };
+
+}
+
+#endif /* _nix_Cluster_hpp__ */
@@ -0,0 +1,311 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file demo/nix/Engine.cpp
+ */
+
+#include "Engine.hpp"
+#include "Reactor.hpp"
+#include "Ring.hpp"
+
+namespace {
+
+    // size of the largest HTTP upgrade request we're willing to buffer.
+    const std::size_t MAX_REQUEST_SIZE = 8*1024;
+
+}
+
+namespace nix {
+
+    Engine::Engine ( Loop& loop, net::Listener& listener, std::size_t memory )
+        : myTransport(0),
+          myFirst(0),
+          myConnections(0),
+          myLimit(16*1024*1024),
+          myBudget(0),
+          myMemory(new char[memory])
+    {
+        ::ws_arena_init(&myArena, myMemory, memory);
+        ::ws_pool_init(&myPool, &myArena);
+        if ( Ring *const ring = dynamic_cast<Ring*>(&loop) ) {
+            myTransport = Transport::create(*this, *ring, listener);
+        }
+        else {
+            myTransport = Transport::create(
+                *this, dynamic_cast<Reactor&>(loop), listener);
+        }
+    }
+
+    Engine::~Engine ()
+    {
+        delete myTransport, myTransport = 0;
+        while ( myFirst != 0 )
+        {
+            Connection *const connection = myFirst;
+            myFirst = connection->myNext;
+            delete connection;
+        }
+        delete [] myMemory;
+    }
+
+    void Engine::opened ( Connection& connection )
+    {
+    }
+
+    void Engine::message ( Connection& connection, ::ws_type type,
+                           const char * data, std::size_t size )
+    {
+    }
+
+    void Engine::closed ( Connection& connection )
+    {
+    }
+
+    void Engine::Transport::adopt ( Connection * connection )
+    {
+        connection->myNext = myEngine.myFirst;
+        if ( myEngine.myFirst != 0 ) {
+            myEngine.myFirst->myPrev = connection;
+        }
+        myEngine.myFirst = connection, ++myEngine.myConnections;
+    }
+
+    Engine::Connection::Connection ( Engine& engine, int handle )
+        : myEngine(engine),
+          myHandle(handle),
+          myState(Handshake),
+          myOffset(0),
+          myPrev(0),
+          myNext(0)
+    {
+        ::ws_handshake_init(&myHandshake);
+        myHandshake.limit        = MAX_REQUEST_SIZE;
+
+        ::ws_iwire_init(&myIWire);
+        // client *must* mask all frames.
+        myIWire.masking_required = 1;
+        myIWire.validate_text    = 1;
+
+        ::ws_imessage_init(&myIMessage, &myIWire, &myEngine.myPool);
+        myIMessage.baton          = this;
+        myIMessage.accept_message = &Connection::accept_message;
+
+        ::ws_owire_init(&myOWire);
+        myOWire.baton            = this;
+        myOWire.accept_content   = &Connection::accept_output;
+    }
+
+    Engine::Connection::~Connection ()
+    {
+        ::ws_imessage_clear(&myIMessage);
+        ::close(myHandle);
+        if ( myEngine.myTransport != 0 ) {
+            myEngine.myTransport->released();
+        }
+    }
+
+    void Engine::Connection::send
+        ( ::ws_type type, const void * data, std::size_t size )
+    {
+        if ( myState != Open ) {
+            return;
+        }
+        switch ( type )
+        {
+        case ws_text:
+            ::ws_owire_put_text(&myOWire, data, size, 0); break;
+        case ws_data:
+            ::ws_owire_put_data(&myOWire, data, size, 0); break;
+        case ws_ping:
+            ::ws_owire_put_ping(&myOWire, data, size, 0); break;
+        case ws_pong:
+            ::ws_owire_put_pong(&myOWire, data, size, 0); break;
+        default:
+            return;
+        }
+        flush();
+    }
+
+    void Engine::Connection::close ( unsigned short code )
+    {
+        if ( myState != Open ) {
+            return;
+        }
+        const uint8 payload[] = {
+            uint8(code >> 8), uint8(code & 0xff),
+        };
+        ::ws_owire_put_kill(&myOWire, payload, sizeof(payload), 0);
+        myState = Closing;
+        flush();
+    }
+
+    void Engine::Connection::consume ( const char * data, std::size_t size )
+    {
+        if ( myState == Handshake ) {
+            handshake(data, size); return;
+        }
+        if ( myState != Open ) {
+            return;
+        }
+        myIMessage.max_message = myEngine.myLimit;
+        myIMessage.max_memory  = myEngine.myBudget;
+        ::ws_iwire_feed(&myIWire, data, size);
+        if ( myIWire.status == ws_iwire_invalid_utf8 ) {
+            close(1007);
+        }
+        else if ( myIWire.status != ws_iwire_ok ) {
+            close(1002);
+        }
+        else if ( myIMessage.status == ws_imessage_too_large ) {
+            close(1009);
+        }
+        else if ( myIMessage.status != ws_imessage_ok ) {
+            close(1011);
+        }
+    }
+
+    void Engine::Connection::handshake ( const char * data, std::size_t size )
+    {
+        const std::size_t used = ::ws_handshake_feed(&myHandshake, data, size);
+        if ( !::ws_handshake_done(&myHandshake) ) {
+            return;
+        }
+
+        // refuse anything but a valid upgrade request.
+        char response[256];
+        if ( myHandshake.status != ws_handshake_ok )
+        {
+            myOutput.append(response, ::ws_handshake_reject
+                (&myHandshake, response, sizeof(response)));
+            myState = Closing;
+            return;
+        }
+
+        // send HTTP upgrade approval.
+        char accept[WS_ACCEPT_SIZE+1];
+        ::ws_accept_key(::ws_handshake_key(&myHandshake), accept);
+        accept[WS_ACCEPT_SIZE] = '\0';
+        myOutput.append(response, ::ws_handshake_accept
+            (&myHandshake, accept, 0, response, sizeof(response)));
+        myState = Open;
+        myEngine.opened(*this);
+
+        // keep any leftovers for the wire protocol.
+        if ( used < size ) {
+            consume(data+used, size-used);
+        }
+    }
+
+    void Engine::Connection::flushed ()
+    {
+        myOutput.clear(), myOffset = 0;
+        // close the connection once the peer has our last word.
+        if ( myState == Closing ) {
+            dispose();
+        }
+    }
+
+    void Engine::Connection::finish ()
+    {
+        if ( myState == Closed ) {
+            return;
+        }
+        // the peer may still read our answer, e.g. the echo of its close
+        // frame, before it is gone for good.
+        myState = Closing;
+        if ( pending() == 0 ) {
+            dispose(); return;
+        }
+        flush();
+    }
+
+    void Engine::Connection::dispose ()
+    {
+        if ( myState == Closed ) {
+            return;
+        }
+        myState = Closed;
+        myEngine.closed(*this);
+        if ( myPrev != 0 ) {
+            myPrev->myNext = myNext;
+        }
+        else {
+            myEngine.myFirst = myNext;
+        }
+        if ( myNext != 0 ) {
+            myNext->myPrev = myPrev;
+        }
+        --myEngine.myConnections;
+        release();
+    }
+
+    void Engine::Connection::accept_message
+        ( ::ws_imessage * stream, ::ws_type type,
+          ::ws_imessage_chunk * chain, uint64 size )
+    {
+        Connection& connection = *static_cast<Connection*>(stream->baton);
+        if ( connection.myState != Open ) {
+            ::ws_imessage_release(stream, chain); return;
+        }
+
+        // hand out messages in place, unless they span several buffers.
+        const char * data = "";
+        if ((chain != 0) && (chain->next == 0)) {
+            data = chain->data;
+        }
+        else if ( chain != 0 )
+        {
+            std::string& scratch = connection.myEngine.myScratch;
+            scratch.resize(size);
+            ::ws_imessage_copy(chain, &scratch[0], size);
+            data = scratch.data();
+        }
+
+        if ( type == ws_ping ) {
+            ::ws_owire_put_pong(&connection.myOWire, data, size, 0);
+        }
+        else if ( type == ws_kill )
+        {
+            // echo the peer's status code to complete the closing handshake.
+            ::ws_owire_put_kill(&connection.myOWire,
+                data, (size < 2)? 0 : 2, 0);
+            connection.myState = Closing;
+        }
+        else if ((type == ws_text) || (type == ws_data)) {
+            connection.myEngine.message(connection, type, data, size);
+        }
+        ::ws_imessage_release(stream, chain);
+    }
+
+    void Engine::Connection::accept_output
+        ( ::ws_owire * stream, const void * data, uint64 size )
+    {
+        Connection& connection = *static_cast<Connection*>(stream->baton);
+        connection.myOutput.append(static_cast<const char*>(data), size);
+    }
+
+}
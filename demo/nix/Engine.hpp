@@ -0,0 +1,360 @@
+#ifndef _nix_Engine_hpp__
+#define _nix_Engine_hpp__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file demo/nix/Engine.hpp
+ * @brief WebSocket server for many concurrent connections.
+ */
+
+#include "webs.h"
+#include "nix/Listener.hpp"
+#include "nix/Loop.hpp"
+
+#include <string>
+
+namespace nix {
+
+    class Reactor;
+    class Ring;
+
+    /*!
+     * @brief Accepts connections and serves the WebSocket protocol on each.
+     *
+     * All connections are driven by the same @c Loop.  Each connection owns
+     * its own @c ws_iwire and @c ws_owire, performs the HTTP upgrade
+     * handshake incrementally and buffers output that the peer is not ready
+     * to receive.  Derived classes override the @c opened(), @c message()
+     * and @c closed() hooks to implement the application.
+     *
+     * The protocol logic is independent of how bytes reach the sockets: a
+     * @c Reactor selects a readiness-based transport (@c epoll with
+     * non-blocking @c recv() and @c send()) and a @c Ring selects a
+     * completion-based transport (@c io_uring with multishot accept and
+     * receive).
+     */
+    class Engine
+    {
+        /* nested types. */
+    public:
+        class Connection;
+        class Transport;
+
+        /* data. */
+    private:
+        Transport * myTransport;
+        Connection * myFirst;
+        std::size_t myConnections;
+        std::size_t myLimit;
+        std::size_t myBudget;
+
+        // memory for messages being received, shared by all connections.
+        char * myMemory;
+        ::ws_arena myArena;
+        ::ws_pool myPool;
+
+        // copy of the last message that didn't fit in a single buffer.
+        std::string myScratch;
+
+        /* construction. */
+    public:
+        /*!
+         * @param loop Either a @c Reactor or a @c Ring.
+         * @param listener Non-blocking listening socket.
+         * @param memory Size of the block that holds messages being
+         *  received, for all connections, in bytes.  Pages are committed by
+         *  the system only once they are used.
+         *
+         * Connections that find this memory exhausted are closed with status
+         * 1011.  Use @c budget() to keep a few peers from taking all of it.
+         */
+        Engine ( Loop& loop, net::Listener& listener,
+                 std::size_t memory=64*1024*1024 );
+
+    private:
+        Engine ( const Engine& );
+
+    public:
+        /*!
+         * @brief Stop accepting and drop all connections.
+         *
+         * Call this only once the loop has stopped running.  A @c Ring must
+         * then be destroyed without being polled again.
+         */
+        virtual ~Engine ();
+
+        /* methods. */
+    public:
+        /*!
+         * @brief Number of connections currently open.
+         */
+        std::size_t connections () const
+        {
+            return (myConnections);
+        }
+
+        /*!
+         * @brief Largest message accepted from a peer, in bytes.
+         *
+         * Connections that exceed this limit are closed with status 1009.
+         */
+        std::size_t limit () const
+        {
+            return (myLimit);
+        }
+
+        void limit ( std::size_t limit )
+        {
+            myLimit = limit;
+        }
+
+        /*!
+         * @brief Largest amount of buffer memory held by a connection, in
+         *  bytes, or 0 for no limit (the default).
+         *
+         * Connections that exceed this limit, or that find the engine's
+         * buffer pool exhausted, are closed with status 1011.
+         */
+        std::size_t budget () const
+        {
+            return (myBudget);
+        }
+
+        void budget ( std::size_t budget )
+        {
+            myBudget = budget;
+        }
+
+    protected:
+        /*!
+         * @brief Called once the upgrade handshake has completed.
+         */
+        virtual void opened ( Connection& connection );
+
+        /*!
+         * @brief Called for each complete text or binary message.
+         * @param type Either @c ws_text or @c ws_data.
+         */
+        virtual void message ( Connection& connection, ::ws_type type,
+                               const char * data, std::size_t size );
+
+        /*!
+         * @brief Called right before the connection is destroyed.
+         */
+        virtual void closed ( Connection& connection );
+
+        /* operators. */
+    private:
+        Engine& operator= ( const Engine& );
+
+        friend class Connection;
+        friend class Transport;
+    };
+
+    /*!
+     * @internal
+     * @brief Accepts connections on behalf of an @c Engine.
+     */
+    class Engine::Transport
+    {
+        /* data. */
+    protected:
+        Engine& myEngine;
+
+        /* construction. */
+    protected:
+        explicit Transport ( Engine& engine )
+            : myEngine(engine)
+        {}
+
+    private:
+        Transport ( const Transport& );
+
+    public:
+        virtual ~Transport () {}
+
+        /* class methods. */
+    public:
+        static Transport * create
+            ( Engine& engine, Reactor& reactor, net::Listener& listener );
+
+        static Transport * create
+            ( Engine& engine, Ring& ring, net::Listener& listener );
+
+        /* methods. */
+    public:
+        /*!
+         * @brief Called once a connection has closed its socket.
+         *
+         * Transports that stopped accepting for lack of file descriptors
+         * resume here.
+         */
+        virtual void released () {}
+
+        /* methods. */
+    protected:
+        /*!
+         * @brief Start tracking a newly accepted connection.
+         */
+        void adopt ( Connection * connection );
+
+        /* operators. */
+    private:
+        Transport& operator= ( const Transport& );
+    };
+
+    /*!
+     * @brief One peer served by an @c Engine.
+     *
+     * Transports derive from this class to move bytes between the socket and
+     * the protocol state.
+     */
+    class Engine::Connection
+    {
+        /* nested types. */
+    protected:
+        enum State {
+            Handshake,
+            Open,
+            Closing,
+            Closed
+        };
+
+        /* data. */
+    protected:
+        Engine& myEngine;
+        int myHandle;
+        State myState;
+
+        // output not yet handed to the transport.
+        std::string myOutput;
+        std::size_t myOffset;
+
+    private:
+        ::ws_handshake myHandshake;
+
+        ::ws_iwire myIWire;
+        ::ws_owire myOWire;
+        ::ws_imessage myIMessage;
+
+        Connection * myPrev;
+        Connection * myNext;
+
+        /* construction. */
+    protected:
+        Connection ( Engine& engine, int handle );
+
+    private:
+        Connection ( const Connection& );
+
+    public:
+        virtual ~Connection ();
+
+        /* methods. */
+    public:
+        int handle () const
+        {
+            return (myHandle);
+        }
+
+        Engine& engine ()
+        {
+            return (myEngine);
+        }
+
+        /*!
+         * @brief Number of bytes queued for the peer.
+         */
+        std::size_t pending () const
+        {
+            return (myOutput.size() - myOffset);
+        }
+
+        /*!
+         * @brief Queue a message and send as much of it as possible.
+         */
+        void send ( ::ws_type type, const void * data, std::size_t size );
+
+        /*!
+         * @brief Start the closing handshake.
+         * @param code Status code sent to the peer.
+         */
+        void close ( unsigned short code=1000 );
+
+    protected:
+        /*!
+         * @brief Process bytes received from the peer.
+         */
+        void consume ( const char * data, std::size_t size );
+
+        /*!
+         * @brief Called by the transport once all output was sent.
+         */
+        void flushed ();
+
+        /*!
+         * @brief Called by the transport once the peer has sent all its
+         *  input: send what is still queued, then @c dispose().
+         */
+        void finish ();
+
+        /*!
+         * @brief Tear down the connection, then @c release() it.
+         */
+        void dispose ();
+
+        /*!
+         * @brief Start sending pending output.
+         */
+        virtual void flush () = 0;
+
+        /*!
+         * @brief Delete the connection once no I/O refers to it.
+         */
+        virtual void release () = 0;
+
+    private:
+        void handshake ( const char * data, std::size_t size );
+
+        static void accept_message
+            ( ::ws_imessage * stream, ::ws_type type,
+              ::ws_imessage_chunk * chain, uint64 size );
+        static void accept_output
+            ( ::ws_owire * stream, const void * data, uint64 size );
+
+        /* operators. */
+    private:
+        Connection& operator= ( const Connection& );
+
+        friend class Engine;
+        friend class Transport;
+    };
+
+}
+
+#endif /* _nix_Engine_hpp__ */
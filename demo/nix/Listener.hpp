@@ -32,6 +32,12 @@
  * @file demo/nix/Listener.hpp
  */
 
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "Endpoint.hpp"
+#include "Error.hpp"
+
 namespace nix { namespace net {
 
     class Listener
@@ -42,15 +48,45 @@ namespace nix { namespace net {
 
         /* construction. */
     public:
-        Listener ( Endpoint endpoint )
+        /*!
+         * @param blocking When @c false, @c accept() never waits.
+         * @param shared When @c true, several listeners (typically one per
+         *  thread) may bind the same end point and the kernel balances
+         *  incoming connections between them (@c SO_REUSEPORT).
+         */
+        Listener ( Endpoint endpoint, bool blocking=true, bool shared=false )
             : myHandle(::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP))
         {
             if ( myHandle < 0 ) {
                 throw (Error(errno));
             }
+            // allow restarting a server while old connections linger.
+            const int enable = 1;
+            int status = ::setsockopt(myHandle, SOL_SOCKET,
+                SO_REUSEADDR, &enable, sizeof(enable));
+            if ( status < 0 ) {
+                close(myHandle);
+                throw (Error(errno));
+            }
+            if ( shared ) {
+                status = ::setsockopt(myHandle, SOL_SOCKET,
+                    SO_REUSEPORT, &enable, sizeof(enable));
+                if ( status < 0 ) {
+                    close(myHandle);
+                    throw (Error(errno));
+                }
+            }
+            if ( !blocking ) {
+                status = ::fcntl(myHandle, F_SETFL,
+                    ::fcntl(myHandle, F_GETFL, 0)|O_NONBLOCK);
+                if ( status < 0 ) {
+                    close(myHandle);
+                    throw (Error(errno));
+                }
+            }
             ::sockaddr *const address =
                  reinterpret_cast< ::sockaddr* >(&endpoint.data());
-            int status = ::bind(
+            status = ::bind(
                 myHandle, address, sizeof(endpoint.data()));
             if ( status < 0 ) {
                 close(myHandle);
@@ -78,6 +114,28 @@ namespace nix { namespace net {
         {
             return (myHandle);
         }
+
+        /*!
+         * @brief Accept a pending connection without blocking.
+         * @return The new socket, in non-blocking mode, or -1 when the
+         *  backlog is empty.
+         */
+        int accept ()
+        {
+            int handle = -1;
+            do {
+                handle = ::accept4(
+                    myHandle, 0, 0, SOCK_NONBLOCK|SOCK_CLOEXEC);
+            }
+            // peer may have given up while waiting in the backlog.
+            while ((handle < 0) &&
+                   ((errno == ECONNABORTED) || (errno == EINTR)));
+            if ((handle < 0) &&
+                (errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+                throw (Error(errno));
+            }
+            return (handle);
+        }
     };
 
 } }
@@ -0,0 +1,136 @@
+#ifndef _nix_Loop_hpp__
+#define _nix_Loop_hpp__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file demo/nix/Loop.hpp
+ * @brief Common interface for event loops.
+ */
+
+#include <sys/eventfd.h>
+#include <stdint.h>
+#include <cstddef>
+#include <unistd.h>
+#include "Error.hpp"
+
+namespace nix {
+
+    /*!
+     * @brief Event loop driven by a single thread.
+     *
+     * @c stop() only writes to an event descriptor watched by the loop, so
+     * it can be called from any thread or from a signal handler.
+     *
+     * @see Reactor
+     * @see Ring
+     */
+    class Loop
+    {
+        /* data. */
+    private:
+        int myWakeup;
+        bool myRunning;
+
+        /* construction. */
+    protected:
+        Loop ()
+            : myWakeup(::eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC)),
+              myRunning(false)
+        {
+            if ( myWakeup < 0 ) {
+                throw (Error(errno));
+            }
+        }
+
+    private:
+        Loop ( const Loop& );
+
+    public:
+        virtual ~Loop ()
+        {
+            ::close(myWakeup);
+        }
+
+        /* methods. */
+    public:
+        /*!
+         * @brief Wait for, then dispatch, one batch of events.
+         * @param timeout Milliseconds to wait, -1 to wait forever.
+         * @return The number of events dispatched.
+         */
+        virtual std::size_t poll ( int timeout=-1 ) = 0;
+
+        /*!
+         * @brief Dispatch events until @c stop() is called.
+         */
+        void run ()
+        {
+            myRunning = true;
+            while ( myRunning ) {
+                poll();
+            }
+        }
+
+        /*!
+         * @brief Make @c run() return after the current batch.
+         */
+        void stop ()
+        {
+            const uint64_t signal = 1;
+            const ::ssize_t status = ::write(myWakeup, &signal, sizeof(signal));
+            (void)status;
+        }
+
+    protected:
+        /*!
+         * @brief Descriptor that becomes readable when @c stop() is called.
+         */
+        int wakeup () const
+        {
+            return (myWakeup);
+        }
+
+        /*!
+         * @brief Called by derived classes when @c wakeup() is readable.
+         */
+        void woken ()
+        {
+            uint64_t signal = 0;
+            const ::ssize_t status = ::read(myWakeup, &signal, sizeof(signal));
+            (void)status;
+            myRunning = false;
+        }
+
+        /* operators. */
+    private:
+        Loop& operator= ( const Loop& );
+    };
+
+}
+
+#endif /* _nix_Loop_hpp__ */
@@ -0,0 +1,133 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file demo/nix/Reactor.cpp
+ */
+
+#include "Reactor.hpp"
+
+#include <unistd.h>
+
+namespace nix {
+
+    Reactor::Reactor ( std::size_t batch )
+        : myHandle(::epoll_create1(EPOLL_CLOEXEC)),
+          myEvents(batch)
+    {
+        if ( myHandle < 0 ) {
+            throw (Error(errno));
+        }
+        try {
+            add(wakeup(), myWakeup, EPOLLIN);
+        }
+        catch ( ... ) {
+            ::close(myHandle); throw;
+        }
+    }
+
+    Reactor::~Reactor ()
+    {
+        collect();
+        ::close(myHandle);
+    }
+
+    void Reactor::add ( int handle, Handler& handler, ::uint32_t events )
+    {
+        ::epoll_event event;
+        event.events   = events|EPOLLET;
+        event.data.ptr = &handler;
+        const int status = ::epoll_ctl(
+            myHandle, EPOLL_CTL_ADD, handle, &event);
+        if ( status < 0 ) {
+            throw (Error(errno));
+        }
+    }
+
+    void Reactor::modify ( int handle, Handler& handler, ::uint32_t events )
+    {
+        ::epoll_event event;
+        event.events   = events|EPOLLET;
+        event.data.ptr = &handler;
+        const int status = ::epoll_ctl(
+            myHandle, EPOLL_CTL_MOD, handle, &event);
+        if ( status < 0 ) {
+            throw (Error(errno));
+        }
+    }
+
+    void Reactor::remove ( int handle )
+    {
+        ::epoll_event event;
+        const int status = ::epoll_ctl(
+            myHandle, EPOLL_CTL_DEL, handle, &event);
+        if ( status < 0 ) {
+            throw (Error(errno));
+        }
+    }
+
+    void Reactor::dispose ( Handler * handler )
+    {
+        myGarbage.push_back(handler);
+    }
+
+    std::size_t Reactor::poll ( int timeout )
+    {
+        const int count = ::epoll_wait(
+            myHandle, &myEvents[0], int(myEvents.size()), timeout);
+        if ( count < 0 )
+        {
+            if ( errno == EINTR ) {
+                return (0);
+            }
+            throw (Error(errno));
+        }
+        for ( int i = 0; i < count; ++i )
+        {
+            Handler *const handler =
+                static_cast<Handler*>(myEvents[i].data.ptr);
+            // skip handlers disposed of earlier in this batch.
+            bool alive = true;
+            for ( std::size_t j = 0; alive && (j < myGarbage.size()); ++j ) {
+                alive = (myGarbage[j] != handler);
+            }
+            if ( alive ) {
+                handler->ready(*this, myEvents[i].events);
+            }
+        }
+        collect();
+        return (std::size_t(count));
+    }
+
+    void Reactor::collect ()
+    {
+        for ( std::size_t i = 0; i < myGarbage.size(); ++i ) {
+            delete myGarbage[i];
+        }
+        myGarbage.clear();
+    }
+
+}
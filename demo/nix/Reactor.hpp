@@ -0,0 +1,142 @@
+#ifndef _nix_Reactor_hpp__
+#define _nix_Reactor_hpp__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file demo/nix/Reactor.hpp
+ * @brief Edge-triggered readiness notification for many handles.
+ */
+
+#include <sys/epoll.h>
+#include <cstddef>
+#include <vector>
+#include "Error.hpp"
+#include "Loop.hpp"
+
+namespace nix {
+
+    /*!
+     * @brief Dispatches readiness events from an `epoll` instance.
+     *
+     * Handles are registered in edge-triggered mode: a handler is only
+     * notified when a handle @e becomes readable or writable, so it must
+     * consume input (and produce output) until the system call reports
+     * `EAGAIN`.  Unlike @c WaitSet, the cost of a wake-up is proportional
+     * to the number of ready handles rather than to the number of handles
+     * being watched, and there is no `FD_SETSIZE` limit.
+     */
+    class Reactor :
+        public Loop
+    {
+        /* nested types. */
+    public:
+        /*!
+         * @brief Receives readiness notifications for one handle.
+         */
+        class Handler
+        {
+        public:
+            virtual ~Handler () {}
+
+            /*!
+             * @brief Called when the handle is ready.
+             * @param events `EPOLLIN`, `EPOLLOUT`, `EPOLLERR`, etc.
+             */
+            virtual void ready ( Reactor& reactor, ::uint32_t events ) = 0;
+        };
+
+    private:
+        class Wakeup :
+            public Handler
+        {
+        public:
+            virtual void ready ( Reactor& reactor, ::uint32_t events )
+            {
+                reactor.woken();
+            }
+        };
+
+        /* data. */
+    private:
+        int myHandle;
+        std::vector< ::epoll_event > myEvents;
+        std::vector<Handler*> myGarbage;
+        Wakeup myWakeup;
+
+        /* construction. */
+    public:
+        explicit Reactor ( std::size_t batch=256 );
+
+    private:
+        Reactor ( const Reactor& );
+
+    public:
+        ~Reactor ();
+
+        /* methods. */
+    public:
+        int handle () const
+        {
+            return (myHandle);
+        }
+
+        /*!
+         * @brief Start watching @a handle on behalf of @a handler.
+         *
+         * Events are always edge-triggered.
+         */
+        void add ( int handle, Handler& handler,
+                   ::uint32_t events=EPOLLIN|EPOLLOUT|EPOLLRDHUP );
+
+        /*!
+         * @brief Change the events watched on @a handle.
+         */
+        void modify ( int handle, Handler& handler, ::uint32_t events );
+
+        /*!
+         * @brief Stop watching @a handle.
+         */
+        void remove ( int handle );
+
+        /*!
+         * @brief Delete @a handler once the current batch is dispatched.
+         *
+         * Handlers may dispose of themselves (or of each other) from their
+         * @c ready() callback without invalidating pending events.
+         */
+        void dispose ( Handler * handler );
+
+        virtual std::size_t poll ( int timeout=-1 );
+
+    private:
+        void collect ();
+    };
+
+}
+
+#endif /* _nix_Reactor_hpp__ */
@@ -0,0 +1,239 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file demo/nix/ReactorTransport.cpp
+ * @brief Readiness-based transport for @c nix::Engine.
+ */
+
+#include "Engine.hpp"
+#include "Reactor.hpp"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+    // number of reads per wake-up before yielding to other connections.
+    const int READ_BUDGET = 16;
+
+    class ReactorConnection :
+        public nix::Engine::Connection,
+        public nix::Reactor::Handler
+    {
+        /* data. */
+    private:
+        nix::Reactor& myReactor;
+        std::vector<char>& myBuffer;
+
+        /* construction. */
+    public:
+        ReactorConnection ( nix::Engine& engine, int handle,
+                            nix::Reactor& reactor, std::vector<char>& buffer )
+            : nix::Engine::Connection(engine, handle),
+              myReactor(reactor),
+              myBuffer(buffer)
+        {
+            myReactor.add(myHandle, *this);
+        }
+
+        /* overrides. */
+    public:
+        virtual void ready ( nix::Reactor& reactor, ::uint32_t events )
+        {
+            if ((events & EPOLLOUT) != 0) {
+                flush();
+            }
+            // on hang-up or error, input may still be queued: read it first.
+            if ((events & (EPOLLIN|EPOLLRDHUP|EPOLLERR|EPOLLHUP)) == 0) {
+                return;
+            }
+            for ( int budget = READ_BUDGET; (myState != Closed); --budget )
+            {
+                if ( budget == 0 )
+                {
+                    // re-arming reports the pending input again, later.
+                    reactor.modify(myHandle, *this,
+                        EPOLLIN|EPOLLOUT|EPOLLRDHUP);
+                    flush(); return;
+                }
+                const ::ssize_t size =
+                    ::recv(myHandle, &myBuffer[0], myBuffer.size(), 0);
+                if ( size > 0 ) {
+                    consume(&myBuffer[0], size); continue;
+                }
+                if ( size == 0 ) {
+                    finish(); return;
+                }
+                if ( errno == EINTR ) {
+                    continue;
+                }
+                if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+                    dispose();
+                }
+                break;
+            }
+            if ((events & (EPOLLERR|EPOLLHUP)) != 0) {
+                finish(); return;
+            }
+            flush();
+        }
+
+    protected:
+        virtual void flush ()
+        {
+            if ( myState == Closed ) {
+                return;
+            }
+            while ( myOffset < myOutput.size() )
+            {
+                const ::ssize_t size = ::send(myHandle,
+                    myOutput.data()+myOffset, myOutput.size()-myOffset,
+                    MSG_NOSIGNAL);
+                if ( size > 0 ) {
+                    myOffset += size; continue;
+                }
+                if ((size < 0) && (errno == EINTR)) {
+                    continue;
+                }
+                if ((size < 0) &&
+                    ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+                    // resume on next `EPOLLOUT` edge.
+                    return;
+                }
+                dispose(); return;
+            }
+            flushed();
+        }
+
+        virtual void release ()
+        {
+            myReactor.remove(myHandle);
+            myReactor.dispose(this);
+        }
+    };
+
+    class ReactorTransport :
+        public nix::Engine::Transport,
+        public nix::Reactor::Handler
+    {
+        /* data. */
+    private:
+        nix::Reactor& myReactor;
+        nix::net::Listener& myListener;
+        // shared by all connections, they are never read concurrently.
+        std::vector<char> myBuffer;
+        // out of file descriptors, waiting for a connection to close.
+        bool myStalled;
+
+        /* construction. */
+    public:
+        ReactorTransport ( nix::Engine& engine, nix::Reactor& reactor,
+                           nix::net::Listener& listener )
+            : nix::Engine::Transport(engine),
+              myReactor(reactor),
+              myListener(listener),
+              myBuffer(64*1024),
+              myStalled(false)
+        {
+            myReactor.add(myListener.handle(), *this, EPOLLIN);
+        }
+
+        virtual ~ReactorTransport ()
+        {
+            myReactor.remove(myListener.handle());
+        }
+
+        /* overrides. */
+    public:
+        virtual void ready ( nix::Reactor& reactor, ::uint32_t events )
+        {
+            // drain the backlog, edge-triggered events won't repeat.
+            for ( int handle = -1; true; )
+            {
+                try {
+                    handle = myListener.accept();
+                }
+                catch ( const nix::Error& error )
+                {
+                    // the next edge may never come while the backlog stays
+                    // full, so retry once a connection gives its socket up.
+                    if ((error.code() == EMFILE) || (error.code() == ENFILE))
+                    {
+                        if ( !myStalled ) {
+                            std::cerr
+                                << "Could not accept: '" << error.what()
+                                << "', waiting for a connection to close."
+                                << std::endl;
+                        }
+                        myStalled = true;
+                        break;
+                    }
+                    std::cerr
+                        << "Could not accept: '" << error.what() << "'."
+                        << std::endl;
+                    break;
+                }
+                if ( handle < 0 ) {
+                    break;
+                }
+                const int enable = 1;
+                ::setsockopt(handle, IPPROTO_TCP,
+                    TCP_NODELAY, &enable, sizeof(enable));
+                try {
+                    adopt(new ReactorConnection(
+                        myEngine, handle, myReactor, myBuffer));
+                }
+                catch ( const nix::Error& error )
+                {
+                    std::cerr
+                        << "Could not register: '" << error.what() << "'."
+                        << std::endl;
+                }
+            }
+        }
+
+        virtual void released ()
+        {
+            if ( myStalled ) {
+                myStalled = false, ready(myReactor, EPOLLIN);
+            }
+        }
+    };
+
+}
+
+namespace nix {
+
+    Engine::Transport * Engine::Transport::create
+        ( Engine& engine, Reactor& reactor, net::Listener& listener )
+    {
+        return (new ReactorTransport(engine, reactor, listener));
+    }
+
+}
@@ -0,0 +1,383 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file demo/nix/Ring.cpp
+ */
+
+#include "Ring.hpp"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    int io_uring_setup ( unsigned entries, ::io_uring_params * params )
+    {
+        return (int(::syscall(__NR_io_uring_setup, entries, params)));
+    }
+
+    int io_uring_enter ( int ring, unsigned submit, unsigned wait,
+                         unsigned flags, void * argument, std::size_t size )
+    {
+        return (int(::syscall(__NR_io_uring_enter,
+            ring, submit, wait, flags, argument, size)));
+    }
+
+    int io_uring_register ( int ring, unsigned opcode,
+                            void * argument, unsigned count )
+    {
+        return (int(::syscall(__NR_io_uring_register,
+            ring, opcode, argument, count)));
+    }
+
+    void * map ( int ring, std::size_t size, ::off_t offset )
+    {
+        void *const data = ::mmap(0, size, PROT_READ|PROT_WRITE,
+            MAP_SHARED|MAP_POPULATE, ring, offset);
+        if ( data == MAP_FAILED ) {
+            throw (nix::Error(errno));
+        }
+        return (data);
+    }
+
+    // records the first completion of the operation used to probe the
+    // kernel.
+    class Probe :
+        public nix::Ring::Handler
+    {
+    public:
+        bool done;
+        int result;
+        unsigned flags;
+
+        Probe ()
+            : done(false), result(0), flags(0)
+        {}
+
+        virtual void complete ( nix::Ring& ring, const ::io_uring_cqe& event )
+        {
+            if ( !done ) {
+                done = true, result = event.res, flags = event.flags;
+            }
+        }
+    };
+
+    // the kernel updates these concurrently with us.
+    unsigned acquire ( const unsigned * value )
+    {
+        return (__atomic_load_n(value, __ATOMIC_ACQUIRE));
+    }
+
+    template<typename T>
+    void release ( T * value, T update )
+    {
+        __atomic_store_n(value, update, __ATOMIC_RELEASE);
+    }
+
+}
+
+namespace nix {
+
+    Ring::Ring ( unsigned entries )
+        : myHandle(-1),
+          mySQRing(0), mySQSize(0),
+          myCQRing(0), myCQSize(0),
+          mySQEs(0), mySQEsSize(0),
+          myQueued(0)
+    {
+        // multishot operations complete more often than we submit.
+        ::io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE|IORING_SETUP_SUBMIT_ALL;
+        params.cq_entries = 4*entries;
+        myHandle = io_uring_setup(entries, &params);
+        if ( myHandle < 0 ) {
+            throw (Error(errno));
+        }
+        try {
+            if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0) {
+                throw (Error(ENOSYS));
+            }
+            mySQSize = params.sq_off.array + params.sq_entries*sizeof(unsigned);
+            myCQSize = params.cq_off.cqes
+                + params.cq_entries*sizeof(::io_uring_cqe);
+            mySQSize = myCQSize = std::max(mySQSize, myCQSize);
+            mySQRing = myCQRing = map(myHandle, mySQSize, IORING_OFF_SQ_RING);
+            mySQEsSize = params.sq_entries*sizeof(::io_uring_sqe);
+            mySQEs = static_cast< ::io_uring_sqe* >(
+                map(myHandle, mySQEsSize, IORING_OFF_SQES));
+        }
+        catch ( ... )
+        {
+            if ( mySQRing != 0 ) {
+                ::munmap(mySQRing, mySQSize);
+            }
+            ::close(myHandle); throw;
+        }
+
+        char *const sq = static_cast<char*>(mySQRing);
+        mySQHead    = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        mySQTail    = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        mySQMask    = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        mySQEntries = params.sq_entries;
+        char *const cq = static_cast<char*>(myCQRing);
+        myCQHead    = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        myCQTail    = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        myCQMask    = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        myCQEs      = reinterpret_cast< ::io_uring_cqe* >(
+            cq + params.cq_off.cqes);
+
+        // submission slots map 1:1 to entries, set the indirection once.
+        unsigned *const array =
+            reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        for ( unsigned i = 0; i < mySQEntries; ++i ) {
+            array[i] = i;
+        }
+        arm();
+    }
+
+    Ring::~Ring ()
+    {
+        ::munmap(mySQEs, mySQEsSize);
+        ::munmap(mySQRing, mySQSize);
+        ::close(myHandle);
+    }
+
+    bool Ring::supported ()
+    {
+        // set up a ring and buffers the way the transport does, then check
+        // that a multishot receive isn't rejected (Linux 6.0): older kernels
+        // may know all the flags and opcodes, but still fail it.
+        int pair[2] = { -1, -1 };
+        if ( ::socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, pair) < 0 ) {
+            return (false);
+        }
+        Probe probe;
+        bool supported = false;
+        try {
+            Ring ring(4);
+            Buffers buffers(ring, 0, 1, 64);
+            const std::size_t size =
+                sizeof(::io_uring_probe) + 256*sizeof(::io_uring_probe_op);
+            std::vector<char> buffer(size, 0);
+            ::io_uring_probe *const ops =
+                reinterpret_cast< ::io_uring_probe* >(&buffer[0]);
+            const uint8_t opcodes[] = {
+                IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND,
+                IORING_OP_POLL_ADD, IORING_OP_ASYNC_CANCEL,
+                IORING_OP_SHUTDOWN,
+            };
+            supported = (io_uring_register(
+                ring.handle(), IORING_REGISTER_PROBE, ops, 256) == 0);
+            for ( std::size_t i = 0;
+                  supported && (i < sizeof(opcodes)); ++i )
+            {
+                supported = (opcodes[i] <= ops->last_op) &&
+                    (ops->ops[opcodes[i]].flags & IO_URING_OP_SUPPORTED);
+            }
+            if ( supported )
+            {
+                ::io_uring_sqe& entry =
+                    ring.prepare(probe, IORING_OP_RECV, pair[0]);
+                entry.ioprio    = IORING_RECV_MULTISHOT;
+                entry.flags     = IOSQE_BUFFER_SELECT;
+                entry.buf_group = buffers.group();
+                supported = (::send(pair[1], "?", 1, MSG_NOSIGNAL) == 1);
+                for ( int i = 0; supported && !probe.done && (i < 10); ++i ) {
+                    ring.poll(100);
+                }
+                supported = supported && (probe.result == 1) &&
+                    ((probe.flags & IORING_CQE_F_MORE) != 0);
+            }
+        }
+        catch ( const Error& ) {
+            supported = false;
+        }
+        // the ring is gone, along with the pending receive.
+        ::close(pair[0]), ::close(pair[1]);
+        return (supported);
+    }
+
+    ::io_uring_sqe& Ring::prepare ( Handler& handler, uint8_t opcode, int fd )
+    {
+        // make room when the submission queue is full.
+        const unsigned tail = *mySQTail;
+        if ((tail - acquire(mySQHead)) == mySQEntries) {
+            submit();
+        }
+        ::io_uring_sqe& entry = mySQEs[tail & mySQMask];
+        std::memset(&entry, 0, sizeof(entry));
+        entry.opcode    = opcode;
+        entry.fd        = fd;
+        entry.user_data = reinterpret_cast<uintptr_t>(&handler);
+        release(mySQTail, tail+1), ++myQueued;
+        return (entry);
+    }
+
+    void Ring::submit ()
+    {
+        enter(0, 0);
+    }
+
+    std::size_t Ring::poll ( int timeout )
+    {
+        // submit and wait with a single system call.
+        if ( acquire(myCQTail) == *myCQHead ) {
+            enter((timeout == 0)? 0 : 1, timeout);
+        }
+        else if ( myQueued > 0 ) {
+            submit();
+        }
+        std::size_t count = 0;
+        for ( unsigned head = *myCQHead; head != acquire(myCQTail); ++count )
+        {
+            // copy, so the slot can be reused while the handler runs.
+            const ::io_uring_cqe event = myCQEs[head & myCQMask];
+            release(myCQHead, ++head);
+            reinterpret_cast<Handler*>(event.user_data)->complete(*this, event);
+        }
+        return (count);
+    }
+
+    void Ring::enter ( unsigned wait, int timeout )
+    {
+        unsigned flags = (wait > 0)? IORING_ENTER_GETEVENTS : 0;
+        ::__kernel_timespec delay;
+        ::io_uring_getevents_arg argument;
+        std::memset(&argument, 0, sizeof(argument));
+        if ( timeout > 0 )
+        {
+            delay.tv_sec  = timeout / 1000;
+            delay.tv_nsec = (timeout % 1000) * 1000000;
+            argument.sigmask_sz = _NSIG / 8;
+            argument.ts = reinterpret_cast<uintptr_t>(&delay);
+            flags |= IORING_ENTER_EXT_ARG;
+        }
+        const int status = io_uring_enter(myHandle, myQueued, wait, flags,
+            (timeout > 0)? &argument : 0, (timeout > 0)? sizeof(argument) : 0);
+        if ((status < 0) &&
+            (errno != EINTR) && (errno != ETIME) && (errno != EBUSY)) {
+            throw (Error(errno));
+        }
+        myQueued = *mySQTail - acquire(mySQHead);
+    }
+
+    void Ring::arm ()
+    {
+        ::io_uring_sqe& entry = prepare(myWakeup, IORING_OP_POLL_ADD, wakeup());
+        entry.len = IORING_POLL_ADD_MULTI;
+        entry.poll32_events = POLLIN;
+    }
+
+    void Ring::Wakeup::complete ( Ring& ring, const ::io_uring_cqe& event )
+    {
+        ring.woken();
+        if ((event.flags & IORING_CQE_F_MORE) == 0) {
+            ring.arm();
+        }
+    }
+
+    Ring::Buffers::Buffers ( Ring& ring, uint16_t group,
+                             uint16_t count, std::size_t size )
+        : myRing(ring),
+          myEntries(0),
+          myEntriesSize(count*sizeof(::io_uring_buf)),
+          myData(new char[count*size]),
+          myGroup(group),
+          myCount(count),
+          mySize(size)
+    {
+        // the kernel requires a page-aligned ring.
+        void *const entries = ::mmap(0, myEntriesSize,
+            PROT_READ|PROT_WRITE, MAP_ANONYMOUS|MAP_PRIVATE, -1, 0);
+        if ( entries == MAP_FAILED ) {
+            delete [] myData;
+            throw (Error(errno));
+        }
+        myEntries = static_cast< ::io_uring_buf_ring* >(entries);
+        ::io_uring_buf_reg registration;
+        std::memset(&registration, 0, sizeof(registration));
+        registration.ring_addr    = reinterpret_cast<uintptr_t>(myEntries);
+        registration.ring_entries = myCount;
+        registration.bgid         = myGroup;
+        const int status = io_uring_register(myRing.handle(),
+            IORING_REGISTER_PBUF_RING, &registration, 1);
+        if ( status < 0 )
+        {
+            const int error = errno;
+            ::munmap(myEntries, myEntriesSize);
+            delete [] myData;
+            throw (Error(error));
+        }
+        for ( uint16_t i = 0; i < myCount; ++i ) {
+            provide(i, i);
+        }
+        publish(myCount);
+    }
+
+    Ring::Buffers::~Buffers ()
+    {
+        ::io_uring_buf_reg registration;
+        std::memset(&registration, 0, sizeof(registration));
+        registration.bgid = myGroup;
+        io_uring_register(myRing.handle(),
+            IORING_UNREGISTER_PBUF_RING, &registration, 1);
+        ::munmap(myEntries, myEntriesSize);
+        delete [] myData;
+    }
+
+    void Ring::Buffers::recycle ( const ::io_uring_cqe& event )
+    {
+        provide(uint16_t(event.flags >> IORING_CQE_BUFFER_SHIFT), 0);
+        publish(1);
+    }
+
+    void Ring::Buffers::provide ( uint16_t id, uint16_t offset )
+    {
+        // the header's flexible array member is misplaced in C++, so
+        // index the ring directly (the tail overlays the first entry).
+        const uint16_t slot = (myEntries->tail + offset) & (myCount - 1);
+        ::io_uring_buf& entry =
+            reinterpret_cast< ::io_uring_buf* >(myEntries)[slot];
+        entry.addr = reinterpret_cast<uintptr_t>(myData + id*mySize);
+        entry.len  = unsigned(mySize);
+        entry.bid  = id;
+    }
+
+    void Ring::Buffers::publish ( uint16_t count )
+    {
+        release(&myEntries->tail, uint16_t(myEntries->tail + count));
+    }
+
+}
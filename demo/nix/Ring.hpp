@@ -0,0 +1,223 @@
+#ifndef _nix_Ring_hpp__
+#define _nix_Ring_hpp__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file demo/nix/Ring.hpp
+ * @brief Completion-based I/O with Linux `io_uring`.
+ */
+
+#include <linux/io_uring.h>
+#include <cstddef>
+#include "Error.hpp"
+#include "Loop.hpp"
+
+namespace nix {
+
+    /*!
+     * @brief Submits operations to, and dispatches completions from, an
+     *  `io_uring` instance.
+     *
+     * This talks to the kernel with raw system calls, so it has no library
+     * dependency.  Each submission is tagged with the @c Handler to notify
+     * on completion.  Multishot operations notify the same handler several
+     * times and flag all but the last completion with @c IORING_CQE_F_MORE.
+     *
+     * Handlers must stay alive until all of their operations complete,
+     * including cancelled ones.
+     */
+    class Ring :
+        public Loop
+    {
+        /* nested types. */
+    public:
+        /*!
+         * @brief Receives completions for submitted operations.
+         */
+        class Handler
+        {
+        public:
+            virtual ~Handler () {}
+
+            virtual void complete
+                ( Ring& ring, const ::io_uring_cqe& event ) = 0;
+        };
+
+        class Buffers;
+
+    private:
+        class Wakeup :
+            public Handler
+        {
+        public:
+            uint64_t signal;
+
+            virtual void complete ( Ring& ring, const ::io_uring_cqe& event );
+        };
+
+        /* data. */
+    private:
+        int myHandle;
+
+        void * mySQRing;
+        std::size_t mySQSize;
+        void * myCQRing;
+        std::size_t myCQSize;
+        ::io_uring_sqe * mySQEs;
+        std::size_t mySQEsSize;
+
+        unsigned * mySQHead;
+        unsigned * mySQTail;
+        unsigned mySQMask;
+        unsigned mySQEntries;
+        unsigned * myCQHead;
+        unsigned * myCQTail;
+        unsigned myCQMask;
+        ::io_uring_cqe * myCQEs;
+
+        unsigned myQueued;
+        Wakeup myWakeup;
+
+        /* construction. */
+    public:
+        explicit Ring ( unsigned entries=1024 );
+
+    private:
+        Ring ( const Ring& );
+
+    public:
+        virtual ~Ring ();
+
+        /* class methods. */
+    public:
+        /*!
+         * @brief Check that the kernel supports everything we rely on.
+         *
+         * This sets up a ring and provided buffers like the transport does
+         * and runs a multishot receive with them (Linux 6.0).  When this
+         * returns @c false, use a @c Reactor.
+         */
+        static bool supported ();
+
+        /* methods. */
+    public:
+        int handle () const
+        {
+            return (myHandle);
+        }
+
+        /*!
+         * @brief Queue an operation, submitting earlier ones if needed.
+         * @return A submission entry, only @c opcode, @c fd and
+         *  @c user_data are set.  Fill in the rest before the next call
+         *  to @c prepare() or @c poll().
+         */
+        ::io_uring_sqe& prepare ( Handler& handler, uint8_t opcode, int fd );
+
+        /*!
+         * @brief Hand all queued operations to the kernel.
+         */
+        void submit ();
+
+        virtual std::size_t poll ( int timeout=-1 );
+
+    private:
+        void enter ( unsigned wait, int timeout );
+        void arm ();
+
+        /* operators. */
+    private:
+        Ring& operator= ( const Ring& );
+    };
+
+    /*!
+     * @brief Fixed-size buffers the kernel picks from for receive operations.
+     *
+     * Operations submitted with @c IOSQE_BUFFER_SELECT and this group's id
+     * report the chosen buffer in their completion.  The application must
+     * @c recycle() each buffer when it's done with the data.
+     */
+    class Ring::Buffers
+    {
+        /* data. */
+    private:
+        Ring& myRing;
+        ::io_uring_buf_ring * myEntries;
+        std::size_t myEntriesSize;
+        char * myData;
+        uint16_t myGroup;
+        uint16_t myCount;
+        std::size_t mySize;
+
+        /* construction. */
+    public:
+        /*!
+         * @param group Identifier for submissions using these buffers.
+         * @param count Number of buffers, must be a power of two.
+         * @param size Size of each buffer, in bytes.
+         */
+        Buffers ( Ring& ring, uint16_t group, uint16_t count, std::size_t size );
+
+    private:
+        Buffers ( const Buffers& );
+
+    public:
+        ~Buffers ();
+
+        /* methods. */
+    public:
+        uint16_t group () const
+        {
+            return (myGroup);
+        }
+
+        /*!
+         * @brief Find the data for the buffer reported in @a event.
+         */
+        const char * data ( const ::io_uring_cqe& event ) const
+        {
+            return (myData + mySize*(event.flags >> IORING_CQE_BUFFER_SHIFT));
+        }
+
+        /*!
+         * @brief Give the buffer reported in @a event back to the kernel.
+         */
+        void recycle ( const ::io_uring_cqe& event );
+
+    private:
+        void provide ( uint16_t id, uint16_t offset );
+        void publish ( uint16_t count );
+
+        /* operators. */
+    private:
+        Buffers& operator= ( const Buffers& );
+    };
+
+}
+
+#endif /* _nix_Ring_hpp__ */
@@ -0,0 +1,322 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file demo/nix/RingTransport.cpp
+ * @brief Completion-based transport for @c nix::Engine.
+ */
+
+#include "Engine.hpp"
+#include "Ring.hpp"
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <iostream>
+
+namespace {
+
+    // receive buffers shared by all connections of a transport.
+    const uint16_t BUFFER_COUNT = 1024;
+    const std::size_t BUFFER_SIZE = 4096;
+
+    class RingConnection :
+        public nix::Engine::Connection
+    {
+        /* nested types. */
+    private:
+        typedef void(RingConnection::*Callback)(const ::io_uring_cqe&);
+
+        // routes completions to a member function.
+        class Operation :
+            public nix::Ring::Handler
+        {
+        private:
+            RingConnection& myConnection;
+            Callback myCallback;
+
+        public:
+            Operation ( RingConnection& connection, Callback callback )
+                : myConnection(connection), myCallback(callback)
+            {}
+
+            virtual void complete
+                ( nix::Ring& ring, const ::io_uring_cqe& event )
+            {
+                (myConnection.*myCallback)(event);
+            }
+        };
+
+        /* data. */
+    private:
+        nix::Ring& myRing;
+        nix::Ring::Buffers& myBuffers;
+
+        Operation myReceive;
+        Operation mySend;
+        Operation myOther;
+        // operations the kernel may still complete.
+        unsigned myInFlight;
+
+        // output owned by the kernel until the send completes.
+        std::string mySending;
+        std::size_t mySent;
+
+        /* construction. */
+    public:
+        RingConnection ( nix::Engine& engine, int handle,
+                         nix::Ring& ring, nix::Ring::Buffers& buffers )
+            : nix::Engine::Connection(engine, handle),
+              myRing(ring),
+              myBuffers(buffers),
+              myReceive(*this, &RingConnection::received),
+              mySend(*this, &RingConnection::sent),
+              myOther(*this, &RingConnection::completed),
+              myInFlight(0),
+              mySent(0)
+        {
+        }
+
+        /* methods. */
+    public:
+        /*!
+         * @brief Receive until the peer hangs up, one completion per read.
+         */
+        void receive ()
+        {
+            ::io_uring_sqe& entry =
+                myRing.prepare(myReceive, IORING_OP_RECV, myHandle);
+            entry.ioprio    = IORING_RECV_MULTISHOT;
+            entry.flags     = IOSQE_BUFFER_SELECT;
+            entry.buf_group = myBuffers.group();
+            ++myInFlight;
+        }
+
+    protected:
+        virtual void flush ()
+        {
+            if ((myState == Closed) || !mySending.empty()) {
+                return;
+            }
+            if ( myOffset == myOutput.size() ) {
+                if ( myState == Closing ) {
+                    flushed();
+                }
+                return;
+            }
+            // keep appending to a fresh buffer while this one is in flight.
+            mySending.swap(myOutput), mySent = myOffset;
+            myOutput.clear(), myOffset = 0;
+            send();
+        }
+
+        virtual void release ()
+        {
+            // wait for the kernel to let go before deleting ourself.
+            ::io_uring_sqe& entry =
+                myRing.prepare(myOther, IORING_OP_ASYNC_CANCEL, myHandle);
+            entry.cancel_flags = IORING_ASYNC_CANCEL_FD|IORING_ASYNC_CANCEL_ALL;
+            ++myInFlight;
+        }
+
+    private:
+        void send ()
+        {
+            ::io_uring_sqe& entry =
+                myRing.prepare(mySend, IORING_OP_SEND, myHandle);
+            entry.addr      = reinterpret_cast<uintptr_t>(mySending.data()+mySent);
+            entry.len       = unsigned(mySending.size()-mySent);
+            entry.msg_flags = MSG_NOSIGNAL|MSG_WAITALL;
+            ++myInFlight;
+            if ((myState == Closing) && myOutput.empty())
+            {
+                // send our last word and the FIN in the same submission.
+                entry.flags |= IOSQE_IO_LINK;
+                ::io_uring_sqe& shutdown =
+                    myRing.prepare(myOther, IORING_OP_SHUTDOWN, myHandle);
+                shutdown.len = SHUT_WR;
+                ++myInFlight;
+            }
+        }
+
+        void received ( const ::io_uring_cqe& event )
+        {
+            if ((event.flags & IORING_CQE_F_MORE) == 0) {
+                --myInFlight;
+            }
+            if ( event.res > 0 )
+            {
+                if ( myState != Closed ) {
+                    consume(myBuffers.data(event), event.res);
+                }
+                myBuffers.recycle(event);
+            }
+            if ( myState == Closed ) {
+                collect(); return;
+            }
+            if ( event.res == 0 ) {
+                finish(); return;
+            }
+            if ((event.res < 0) && (event.res != -ENOBUFS)) {
+                dispose(); return;
+            }
+            // multishot stops when buffers run out, try again.
+            if ((event.flags & IORING_CQE_F_MORE) == 0) {
+                receive();
+            }
+            flush();
+        }
+
+        void sent ( const ::io_uring_cqe& event )
+        {
+            --myInFlight;
+            if ( myState == Closed ) {
+                collect(); return;
+            }
+            if ( event.res < 0 ) {
+                dispose(); return;
+            }
+            mySent += event.res;
+            if ( mySent < mySending.size() ) {
+                send(); return;
+            }
+            mySending.clear(), mySent = 0;
+            if ((myOffset == myOutput.size()) && (myState != Closing)) {
+                flushed(); return;
+            }
+            flush();
+        }
+
+        void completed ( const ::io_uring_cqe& event )
+        {
+            --myInFlight;
+            if ( myState == Closed ) {
+                collect();
+            }
+        }
+
+        void collect ()
+        {
+            if ( myInFlight == 0 ) {
+                delete this;
+            }
+        }
+    };
+
+    class RingTransport :
+        public nix::Engine::Transport,
+        public nix::Ring::Handler
+    {
+        /* data. */
+    private:
+        nix::Ring& myRing;
+        nix::net::Listener& myListener;
+        nix::Ring::Buffers myBuffers;
+        // out of file descriptors, waiting for a connection to close.
+        bool myStalled;
+
+        /* construction. */
+    public:
+        RingTransport ( nix::Engine& engine, nix::Ring& ring,
+                        nix::net::Listener& listener )
+            : nix::Engine::Transport(engine),
+              myRing(ring),
+              myListener(listener),
+              // listening sockets are unique, use one to name the group.
+              myBuffers(ring, uint16_t(listener.handle()),
+                        BUFFER_COUNT, BUFFER_SIZE),
+              myStalled(false)
+        {
+            // io_uring fails accepts on non-blocking sockets with `EAGAIN`
+            // instead of waiting for the next connection.
+            const int flags = ::fcntl(myListener.handle(), F_GETFL, 0);
+            if ( ::fcntl(myListener.handle(), F_SETFL, flags & ~O_NONBLOCK) < 0 ) {
+                throw (nix::Error(errno));
+            }
+            accept();
+        }
+
+        /* overrides. */
+    public:
+        virtual void complete ( nix::Ring& ring, const ::io_uring_cqe& event )
+        {
+            if ( event.res >= 0 )
+            {
+                const int enable = 1;
+                ::setsockopt(event.res, IPPROTO_TCP,
+                    TCP_NODELAY, &enable, sizeof(enable));
+                RingConnection *const connection =
+                    new RingConnection(myEngine, event.res, myRing, myBuffers);
+                adopt(connection);
+                connection->receive();
+            }
+            else if ((event.res != -EAGAIN) && (event.res != -ECANCELED))
+            {
+                // typically out of file descriptors.
+                std::cerr
+                    << "Could not accept: '" << nix::Error(-event.res).what()
+                    << "'." << std::endl;
+            }
+            if ((event.flags & IORING_CQE_F_MORE) != 0) {
+                return;
+            }
+            // rather than failing the same accept over and over, retry once
+            // a connection gives its socket up.
+            if ((event.res == -EMFILE) || (event.res == -ENFILE)) {
+                myStalled = true; return;
+            }
+            accept();
+        }
+
+        virtual void released ()
+        {
+            if ( myStalled ) {
+                myStalled = false, accept();
+            }
+        }
+
+    private:
+        void accept ()
+        {
+            ::io_uring_sqe& entry =
+                myRing.prepare(*this, IORING_OP_ACCEPT, myListener.handle());
+            entry.ioprio       = IORING_ACCEPT_MULTISHOT;
+            entry.accept_flags = SOCK_CLOEXEC;
+        }
+    };
+
+}
+
+namespace nix {
+
+    Engine::Transport * Engine::Transport::create
+        ( Engine& engine, Ring& ring, net::Listener& listener )
+    {
+        return (new RingTransport(engine, ring, listener));
+    }
+
+}
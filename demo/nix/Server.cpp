@@ -31,12 +31,9 @@
 
 #include "Server.hpp"
 
-#include "b64.hpp"
-#include "Digest.hpp"
-#include "http.hpp"
+#include "Error.hpp"
 
-#include <iostream>
-#include <sstream>
+#include <algorithm>
 
 namespace nix {
 
@@ -47,6 +44,11 @@ namespace nix {
         myIWire.masking_required = 1;
     }
 
+    void Server::trust_peer ()
+    {
+        myIWire.masking_required = 0;
+    }
+
     void Server::handshake ( const std::string& host )
     {
         char data[1024];
@@ -57,52 +59,41 @@ namespace nix {
     std::size_t Server::handshake
         ( const std::string& host, char * data, std::size_t size )
     {
-        http::Request request;
+        ::ws_handshake handshake;
+        ::ws_handshake_init(&handshake);
         ::size_t used = 0;
+        ::size_t pass = 0;
         do {
-            used = myPeer.get(data, size);
-            if ( used == 0 ) {
-                std::cerr << "Peer has finished." << std::endl;
-                break;
+            pass = myPeer.get(data, size);
+            if ( pass == 0 ) {
+                // Peer has finished before completing the request.
+                throw (Error(ECONNRESET));
             }
-            used -= request.feed(data, used);
+            used = ::ws_handshake_feed(&handshake, data, pass);
         }
-        while ( !request.complete() );
-        
+        while ( !::ws_handshake_done(&handshake) );
+
+        // Move leftover data at the beginning of the buffer.
+        std::copy(data+used, data+pass, data);
+
         // Make sure we succeeded.
-        if (!request.complete()) {
-            std::cerr << "Did not finish HTTP request." << std::endl;
+        char response[256];
+        if (handshake.status != ws_handshake_ok) {
+            // Invalid upgrade request.
+            myPeer.putall(response,
+                ::ws_handshake_reject(&handshake, response, sizeof(response)));
+            throw (Error(EPROTO));
         }
-        
-        // Confirm handshake.
-        if (!http::ieq(request.header("Connection"),"Upgrade"  )||
-            !http::ieq(request.header("Upgrade"   ),"WebSocket"))
-        {
-            std::cerr << "Invalid upgrade request." << std::endl;
-        }
-        const std::string version = request.header("Sec-WebSocket-Version");
-        if (version != "13") {
-            std::cerr << "Incompatible versions." << std::endl;
-        }
-        std::string nonce = request.header("Sec-WebSocket-Key");
-        if (nonce.empty()) {
-            std::cerr << "Empty nonce." << std::endl;
-        }
-        std::string key = Tunnel::approve_nonce(nonce);
-        
+        char key[WS_ACCEPT_SIZE+1];
+        ::ws_accept_key(::ws_handshake_key(&handshake), key);
+        key[WS_ACCEPT_SIZE] = '\0';
+
         // Send HTTP upgrade approval.
-        std::ostringstream response;
-        response
-            << "HTTP/1.1 101 Switching Protocols" << "\r\n"
-            << "Upgrade: websocket"               << "\r\n"
-            << "Connection: upgrade"              << "\r\n"
-            << "Sec-WebSocket-Accept: " << key    << "\r\n"
-            << "Sec-WebSocket-Version: 13"        << "\r\n"
-            << "\r\n";
-        myPeer.putall(response.str());
-        
+        myPeer.putall(response, ::ws_handshake_accept(&handshake,
+            key, 0, response, sizeof(response)));
+
         // Keep any leftovers for the wire protocol.
-        return (used);
+        return (pass-used);
     }
 
 }
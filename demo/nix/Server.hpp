@@ -44,6 +44,13 @@ namespace nix {
         Server ( nix::File& host, nix::net::Stream& peer );
 
         /* methods. */
+    public:
+        /*!
+         * @brief Accept unmasked frames from a peer trusted not to need
+         *  masking, e.g. to forward them with @c zero_copy().
+         */
+        void trust_peer ();
+
     private:
         std::size_t handshake
             ( const std::string& host, char * data, std::size_t size );
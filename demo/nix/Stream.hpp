@@ -34,6 +34,8 @@
  */
 
 #include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include "Endpoint.hpp"
 #include "Error.hpp"
@@ -142,6 +144,35 @@ namespace nix { namespace net {
             while ((pass > 0) && ((used+=pass) < size));
         }
 
+        ssize_t put ( const ::iovec * data, int size )
+        {
+            ::msghdr message; ::memset(&message, 0, sizeof(message));
+            message.msg_iov = const_cast< ::iovec* >(data);
+            message.msg_iovlen = size;
+            const ssize_t status = ::sendmsg(myHandle, &message, 0);
+            if ( status < 0 ) {
+                throw (Error(errno));
+            }
+            return (status);
+        }
+
+        void putall ( ::iovec * data, int size )
+        {
+            ssize_t pass = 0;
+            while ( size > 0 )
+            {
+                pass = put(data, size);
+                // skip buffers sent completely, adjust partially sent buffer.
+                while ((size > 0) && (pass >= ssize_t(data->iov_len))) {
+                    pass -= data->iov_len, ++data, --size;
+                }
+                if ( size > 0 ) {
+                    data->iov_base = static_cast<char*>(data->iov_base) + pass;
+                    data->iov_len -= pass;
+                }
+            }
+        }
+
         void shutdowni ()
         {
             const int status = ::shutdown(myHandle, SHUT_RD);
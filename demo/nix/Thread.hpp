@@ -0,0 +1,142 @@
+#ifndef _nix_Thread_hpp__
+#define _nix_Thread_hpp__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file demo/nix/Thread.hpp
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include "Error.hpp"
+
+namespace nix {
+
+    /*!
+     * @brief Entity within a process that can be scheduled for execution.
+     */
+    class Thread
+    {
+        /* nested types. */
+    public:
+        typedef void(*Function)(void*);
+
+        /* data. */
+    private:
+        ::pthread_t myHandle;
+        bool myJoinable;
+
+        /* construction. */
+    public:
+        /*!
+         * @param core When non-negative, the thread only ever runs on this
+         *  processor, starting with its first instruction.
+         */
+        explicit Thread ( Function function, void * context = 0,
+                          int core = -1 )
+            : myJoinable(false)
+        {
+            ::pthread_attr_t attributes;
+            ::pthread_attr_init(&attributes);
+            if ( core >= 0 )
+            {
+                ::cpu_set_t cores;
+                CPU_ZERO(&cores);
+                CPU_SET(core, &cores);
+                ::pthread_attr_setaffinity_np(
+                    &attributes, sizeof(cores), &cores);
+            }
+            // POSIX requires a `void*(void*)` entry point.
+            Start *const start = new Start(function, context);
+            const int status = ::pthread_create(
+                &myHandle, &attributes, &Thread::entry, start);
+            ::pthread_attr_destroy(&attributes);
+            if ( status != 0 ) {
+                delete start;
+                throw (Error(status));
+            }
+            myJoinable = true;
+        }
+
+    private:
+        Thread ( const Thread& );
+
+    public:
+        ~Thread ()
+        {
+            if ( myJoinable ) {
+                ::pthread_join(myHandle, 0);
+            }
+        }
+
+        /* methods. */
+    public:
+        ::pthread_t handle () const
+        {
+            return (myHandle);
+        }
+
+        /*!
+         * @brief Wait for the thread to complete execution.
+         */
+        void join ()
+        {
+            const int status = ::pthread_join(myHandle, 0);
+            if ( status != 0 ) {
+                throw (Error(status));
+            }
+            myJoinable = false;
+        }
+
+    private:
+        struct Start
+        {
+            Function function;
+            void * context;
+
+            Start ( Function function, void * context )
+                : function(function), context(context)
+            {}
+        };
+
+        static void * entry ( void * context )
+        {
+            const Start start = *static_cast<Start*>(context);
+            delete static_cast<Start*>(context);
+            start.function(start.context);
+            return (0);
+        }
+
+        /* operators. */
+    private:
+        Thread& operator= ( const Thread& );
+    };
+
+}
+
+#endif /* _nix_Thread_hpp__ */
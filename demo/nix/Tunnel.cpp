@@ -33,18 +33,35 @@
 
 #include "nix/WaitSet.hpp"
 
-#include "Digest.hpp"
+#include <fcntl.h>
+#include <algorithm>
 
 namespace {
 
     void tohost ( ::ws_iwire * stream, const void * data, uint64 size )
     {
-        std::cout.write(static_cast<const char*>(data), size).flush();
+        // control messages may be injected in the data stream.
+        if ( !::ws_iwire_text(stream) && !::ws_iwire_data(stream) ) {
+            return;
+        }
+        static_cast<nix::Writer*>(stream->baton)->put(data, size);
+    }
+
+    void endhost ( ::ws_iwire * stream )
+    {
+        static_cast<nix::Writer*>(stream->baton)->flush();
     }
 
-    void topeer ( ::ws_owire * stream, const void * data, uint64 size )
+    void topeer ( ::ws_owire * stream,
+                  const ::ws_owire_slice * slices, int count )
     {
-        static_cast<nix::net::Stream*>(stream->baton)->putall(data, size);
+        // send header and payload with a single system call.
+        ::iovec data[2*WS_OWIRE_FRAMES];
+        for (int i = 0; i < count; ++i) {
+            data[i].iov_base = const_cast<void*>(slices[i].data);
+            data[i].iov_len = slices[i].size;
+        }
+        static_cast<nix::net::Stream*>(stream->baton)->putall(data, count);
     }
 
 }
@@ -52,32 +69,64 @@ namespace {
 namespace nix {
 
     Tunnel::Tunnel ( nix::File& host, nix::net::Stream& peer )
-        : myHost(host), myPeer(peer)
+        : myHost(host), myPeer(peer), myOutput(STDOUT_FILENO),
+          myHostInput(1024, 16*1024), myPeerInput(1024, 256*1024)
     {
         ::ws_iwire_init(&myIWire);
-        myIWire.baton          = &myHost;
+        myIWire.baton          = &myOutput;
         myIWire.accept_content = &tohost;
+        myIWire.end_message    = &endhost;
 
         ::ws_owire_init(&myOWire);
         myOWire.baton          = &myPeer;
-        myOWire.accept_content = &topeer;
+        myOWire.accept_slices  = &topeer;
+
+        myPipe[0] = myPipe[1] = -1;
+    }
+
+    Tunnel::~Tunnel ()
+    {
+        if ( myPipe[0] >= 0 ) {
+            ::close(myPipe[0]), ::close(myPipe[1]);
+        }
+    }
+
+    void Tunnel::zero_copy ()
+    {
+        if ( (myPipe[0] < 0) && (::pipe2(myPipe, O_CLOEXEC) != 0) ) {
+            throw (Error(errno));
+        }
+    }
+
+    void Tunnel::buffer_output ( std::size_t size )
+    {
+        myOutput.resize(size);
+    }
+
+    const ::ReceiveBuffer& Tunnel::host_input () const
+    {
+        return (myHostInput);
+    }
+
+    const ::ReceiveBuffer& Tunnel::peer_input () const
+    {
+        return (myPeerInput);
     }
 
     std::string Tunnel::approve_nonce ( const std::string& skey )
     {
-        static const std::string guid
-            ("258EAFA5-E914-47DA-95CA-C5AB0DC85B11");
-        sha1::Digest digest;
-        digest.update(skey.data(), skey.size());
-        digest.update(guid.data(), guid.size());
-        return (digest.result());
+        if ( skey.size() != WS_ACCEPT_KEY_SIZE ) {
+            return (std::string());
+        }
+        char accept[WS_ACCEPT_SIZE];
+        ::ws_accept_key(skey.data(), accept);
+        return (std::string(accept, WS_ACCEPT_SIZE));
     }
 
     void Tunnel::exchange ( const std::string& host )
     {
         handshake(host);
 
-        char data[1024];
         bool halive = true;
         bool palive = true;
         while (halive || palive)
@@ -90,33 +139,101 @@ namespace nix {
             if (palive) {
                 streams.add(myPeer.handle());
             }
-            nix::waitfori(streams);
+            // Release large read buffers when both ends are quiet.
+            if ( myHostInput.grown() || myPeerInput.grown() )
+            {
+                if ( nix::waitfori(streams, 1000) == 0 ) {
+                    myHostInput.idle(), myPeerInput.idle();
+                    continue;
+                }
+            }
+            else {
+                nix::waitfori(streams);
+            }
 
             // Process host input.
             if (streams.contains(myHost.handle()))
             {
-                const ssize_t size = myHost.get(data, sizeof(data));
+                const ssize_t size =
+                    myHost.get(myHostInput.data(), myHostInput.size());
                 if ( size == 0 ) {
                     ::ws_owire_put_kill(&myOWire, 0, 0, 0);
                     myPeer.shutdowno();
                     halive = false;
                 }
                 else {
-                    ::ws_owire_put_data(&myOWire, data, size, 0);
+                    ::ws_owire_put_data(&myOWire,
+                                        myHostInput.data(), size, 0);
+                    myHostInput.update(size);
                 }
             }
 
             // Process peer input.
             if (streams.contains(myPeer.handle()))
             {
-                const ssize_t size = myPeer.get(data, sizeof(data));
+                ssize_t size = forward();
+                if ( size < 0 )
+                {
+                    size = myPeer.get(myPeerInput.data(), myPeerInput.size());
+                    if ( size > 0 ) {
+                        ::ws_iwire_feed(&myIWire, myPeerInput.data(), size);
+                        myPeerInput.update(size);
+                    }
+                }
                 if ( size == 0 ) {
                     palive = false;
                 }
-                else {
-                    ::ws_iwire_feed(&myIWire, data, size);
+            }
+        }
+        myOutput.flush();
+    }
+
+    ssize_t Tunnel::forward ()
+    {
+        // only payloads the host receives as is can bypass the parser.  the
+        // tunnel never validates text, so the parser can skip all of them.
+        // short payloads are cheaper to copy than to splice.
+        const uint64 size = ::ws_iwire_payload(&myIWire);
+        if ((myPipe[0] < 0) || (size < 4096) || ::ws_iwire_masked(&myIWire) ||
+            (!::ws_iwire_text(&myIWire) && !::ws_iwire_data(&myIWire)))
+        {
+            return (-1);
+        }
+        const ssize_t used = ::splice(myPeer.handle(), 0, myPipe[1], 0,
+            std::min<uint64>(size, 64*1024), SPLICE_F_MOVE);
+        if ( used < 0 ) {
+            throw (Error(errno));
+        }
+        if ( used == 0 ) {
+            return (0);
+        }
+
+        // payload the parser already passed on must reach the host first.
+        myOutput.flush();
+        for ( ssize_t left = used; left > 0; )
+        {
+            ssize_t pass = ::splice(myPipe[0], 0, myOutput.handle(), 0,
+                                    left, SPLICE_F_MOVE);
+            if ((pass < 0) && (errno == EINVAL))
+            {
+                // standard output doesn't support splice(), copy instead.
+                char data[4096];
+                pass = ::read(myPipe[0], data, std::min<ssize_t>(
+                                  left, sizeof(data)));
+                if ( pass > 0 ) {
+                    myOutput.put(data, pass), myOutput.flush();
                 }
+                if ( pass == left ) {
+                    ::close(myPipe[0]), ::close(myPipe[1]);
+                    myPipe[0] = myPipe[1] = -1;
+                }
+            }
+            if ( pass < 0 ) {
+                throw (Error(errno));
             }
+            left -= pass;
         }
+        ::ws_iwire_skip(&myIWire, used);
+        return (used);
     }
 }
@@ -33,8 +33,10 @@
  */
 
 #include "webs.h"
+#include "buffer.hpp"
 #include "nix/File.hpp"
 #include "nix/Stream.hpp"
+#include "nix/Writer.hpp"
 
 #include <string>
 
@@ -50,23 +52,79 @@ namespace nix {
         ::ws_iwire myIWire;
         ::ws_owire myOWire;
 
+    private:
+        // buffered standard output, for payloads sent to the host.
+        nix::Writer myOutput;
+
+        // read buffers for host and peer input.  writes to the peer block, so
+        // the tunnel must drain the peer faster than it sends to it, or both
+        // ends of a busy tunnel may wait on each other forever.
+        ::ReceiveBuffer myHostInput;
+        ::ReceiveBuffer myPeerInput;
+
+        // pipe that carries spliced payloads, or -1 when disabled.
+        int myPipe[2];
+
     protected:
         Tunnel ( nix::File& host, nix::net::Stream& peer );
 
+    private:
+        Tunnel ( const Tunnel& );
+
+    public:
+        virtual ~Tunnel ();
+
         /* methods. */
-    protected:
+    public:
         static std::string approve_nonce ( const std::string& key );
 
+        /*!
+         * @brief Move unmasked payloads to standard output with @c splice().
+         *
+         * Frame headers are still parsed in user space, but the payload of
+         * unmasked text and data frames moves from the socket to standard
+         * output through a pipe, without being copied to user space.  Masked
+         * payloads must be unmasked, so they are still copied.  Falls back to
+         * copying if standard output doesn't support @c splice().
+         */
+        void zero_copy ();
+
+        /*!
+         * @brief Change the size of the buffer that coalesces host output.
+         *
+         * Output is flushed at the end of each message and whenever the
+         * buffer is full.  A size of 0 writes each payload chunk as soon as
+         * it is parsed.
+         */
+        void buffer_output ( std::size_t size );
+
+        /*!
+         * @brief Read buffer for data sent by the host, and its statistics.
+         */
+        const ::ReceiveBuffer& host_input () const;
+
+        /*!
+         * @brief Read buffer for data sent by the peer, and its statistics.
+         */
+        const ::ReceiveBuffer& peer_input () const;
+
+    protected:
         virtual void handshake ( const std::string& host ) = 0;
 
     public:
         void exchange ( const std::string& host );
 
     private:
+        ssize_t forward ();
+
         void foreground ();
         void background ();
 
         static void background ( void * context );
+
+        /* operators. */
+    private:
+        Tunnel& operator= ( const Tunnel& );
     };
 
 }
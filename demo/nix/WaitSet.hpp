@@ -120,6 +120,19 @@ namespace nix {
         return (status);
     }
 
+    // returns 0 if nothing is ready within the timeout.
+    inline int waitfori ( WaitSet& pull, long milliseconds )
+    {
+        ::timeval timeout;
+        timeout.tv_sec = milliseconds / 1000;
+        timeout.tv_usec = (milliseconds % 1000) * 1000;
+        const int status = ::select(pull.size(), &pull.data(), 0, 0, &timeout);
+        if ( status == -1 ) {
+            std::cerr << "Select!" << std::endl;
+        }
+        return (status);
+    }
+
     inline void waitforo ( WaitSet& push )
     {
         const int status = ::select(push.size(), 0, &push.data(), 0, 0);
@@ -0,0 +1,156 @@
+#ifndef _nix_Writer_hpp__
+#define _nix_Writer_hpp__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file demo/nix/Writer.hpp
+ * @brief Buffered output to a raw file descriptor.
+ */
+
+#include <sys/uio.h>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include "Error.hpp"
+
+namespace nix {
+
+    /*!
+     * @brief Coalesces small writes to a file descriptor.
+     *
+     * Data accumulates in a fixed-size buffer until it is flushed or until it
+     * doesn't fit.  In that case, the buffer and the new data are written
+     * together with a single @c writev() call, so large chunks are never
+     * copied to the buffer.
+     */
+    class Writer
+    {
+        /* data. */
+    private:
+        int myHandle;
+        std::vector<char> myData;
+        std::size_t myUsed;
+
+        /* construction. */
+    public:
+        explicit Writer ( int handle, std::size_t size=64*1024 )
+            : myHandle(handle), myData(size), myUsed(0)
+        {
+        }
+
+    private:
+        Writer ( const Writer& );
+
+    public:
+        ~Writer ()
+        {
+            try {
+                flush();
+            }
+            catch ( ... ) {}
+        }
+
+        /* methods. */
+    public:
+        int handle () const
+        {
+            return (myHandle);
+        }
+
+        std::size_t size () const
+        {
+            return (myData.size());
+        }
+
+        /*!
+         * @brief Flushes pending data and changes the buffer size.
+         *
+         * A size of 0 disables buffering.
+         */
+        void resize ( std::size_t size )
+        {
+            flush();
+            std::vector<char>(size).swap(myData);
+        }
+
+        void put ( const void * data, std::size_t size )
+        {
+            if ( size == 0 ) {
+                return;
+            }
+            if ( myUsed+size <= myData.size() ) {
+                std::memcpy(&myData[0]+myUsed, data, size);
+                myUsed += size;
+                return;
+            }
+            ::iovec chunks[2];
+            chunks[0].iov_base = (myUsed > 0)? &myData[0] : 0;
+            chunks[0].iov_len = myUsed;
+            chunks[1].iov_base = const_cast<void*>(data);
+            chunks[1].iov_len = size;
+            putall(chunks, 2), myUsed = 0;
+        }
+
+        void flush ()
+        {
+            if ( myUsed > 0 ) {
+                ::iovec chunk;
+                chunk.iov_base = &myData[0];
+                chunk.iov_len = myUsed;
+                putall(&chunk, 1), myUsed = 0;
+            }
+        }
+
+    private:
+        void putall ( ::iovec * data, int size )
+        {
+            while ( size > 0 )
+            {
+                ssize_t pass = ::writev(myHandle, data, size);
+                if ( pass < 0 ) {
+                    throw (Error(errno));
+                }
+                // skip buffers written completely, adjust partial buffer.
+                while ((size > 0) && (pass >= ssize_t(data->iov_len))) {
+                    pass -= data->iov_len, ++data, --size;
+                }
+                if ( size > 0 ) {
+                    data->iov_base = static_cast<char*>(data->iov_base) + pass;
+                    data->iov_len -= pass;
+                }
+            }
+        }
+
+        /* operators. */
+    private:
+        Writer& operator= ( const Writer& );
+    };
+
+}
+
+#endif /* _nix_Writer_hpp__ */
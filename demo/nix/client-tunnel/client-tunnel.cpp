@@ -56,6 +56,16 @@ try
     // Get the port number.
     const uint16_t port = ::getarg<uint16_t>(argc-1, argv+1, "-p", 80);
 
+    // Splice payloads from the server to standard output?
+    const bool zero_copy = ::hasarg(argc-1, argv+1, "-z");
+
+    // Coalesce output to standard output in a buffer this large.
+    const std::size_t buffer =
+        ::getarg<std::size_t>(argc-1, argv+1, "-b", 64*1024);
+
+    // Print read statistics on exit?
+    const bool stats = ::hasarg(argc-1, argv+1, "-s");
+
     // Assemble the IP end point.
     const nix::net::Endpoint endpoint =
         nix::net::Endpoint::resolve(name.c_str(), port);
@@ -68,7 +78,17 @@ try
     nix::net::Stream peer(endpoint);
 
     // Perform tunnelled data exchange.
-    nix::Client(host, peer).exchange(name);
+    nix::Client client(host, peer);
+    client.buffer_output(buffer);
+    if (zero_copy) {
+        client.zero_copy();
+    }
+    client.exchange(name);
+    if (stats) {
+        std::cerr
+            << "Host: " << client.host_input() << "." << std::endl
+            << "Peer: " << client.peer_input() << "." << std::endl;
+    }
 }
 catch ( const std::exception& error )
 {
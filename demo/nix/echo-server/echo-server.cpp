@@ -0,0 +1,140 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @file demo/nix/echo-server/echo-server.cpp
+ * @brief Serves many websocket connections, echoing every message.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <sys/resource.h>
+
+#include "options.hpp"
+
+#include "nix/Cluster.hpp"
+#include "nix/Endpoint.hpp"
+#include "nix/Engine.hpp"
+
+namespace {
+
+    class EchoServer :
+        public nix::Engine
+    {
+        /* construction. */
+    public:
+        EchoServer ( nix::Loop& loop, nix::net::Listener& listener,
+                     std::size_t memory )
+            : nix::Engine(loop, listener, memory)
+        {
+        }
+
+        /* class methods. */
+    public:
+        static nix::Engine * create
+            ( nix::Loop& loop, nix::net::Listener& listener, void * context )
+        {
+            return (new EchoServer(loop, listener,
+                *static_cast<const std::size_t*>(context)));
+        }
+
+        /* overrides. */
+    protected:
+        virtual void message ( Connection& connection, ::ws_type type,
+                               const char * data, std::size_t size )
+        {
+            connection.send(type, data, size);
+        }
+    };
+
+    // each connection needs a file descriptor.
+    void raise_file_limit ()
+    {
+        ::rlimit limit;
+        if ( ::getrlimit(RLIMIT_NOFILE, &limit) == 0 )
+        {
+            limit.rlim_cur = limit.rlim_max;
+            ::setrlimit(RLIMIT_NOFILE, &limit);
+        }
+    }
+
+}
+
+int main ( int argc, char ** argv )
+try
+{
+    // Get the host name.
+    if (argc < 2)
+    {
+        std::cerr
+            << "Host name or IP address required."
+            << std::endl;
+        return (EXIT_FAILURE);
+    }
+    const std::string name(argv[1]);
+
+    // Get the port number.
+    const uint16_t port = ::getarg<uint16_t>(argc-1, argv+1, "-p", 80);
+
+    // Get the number of worker threads.
+    const std::size_t threads = ::getarg<std::size_t>(
+        argc-1, argv+1, "-t", nix::Cluster::cores());
+
+    // Use io_uring, when available?
+    const bool uring = ::hasarg(argc-1, argv+1, "-u");
+
+    // Get the memory for incoming messages, per thread, in MB.
+    std::size_t memory = ::getarg<std::size_t>(
+        argc-1, argv+1, "-m", 64) * 1024*1024;
+
+    // Assemble the IP end point.
+    const nix::net::Endpoint endpoint =
+        nix::net::Endpoint::resolve(name.c_str(), port);
+    std::cerr
+        << "Listening on '" << endpoint << "'"
+        << " with " << threads << " thread(s)."
+        << std::endl;
+
+    // Serve all connections from one event loop per thread.
+    raise_file_limit();
+    nix::Cluster cluster(endpoint, &EchoServer::create, &memory);
+    cluster.start(threads, uring);
+    cluster.join();
+}
+catch ( const std::exception& error )
+{
+    std::cerr
+      << "Uncaught exception: '" << error.what() << "'."
+      << std::endl;
+    return (EXIT_FAILURE);
+}
+catch ( ... )
+{
+    std::cerr
+        << "Uncaught exception of unknown type."
+        << std::endl;
+    return (EXIT_FAILURE);
+}
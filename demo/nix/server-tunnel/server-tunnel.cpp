@@ -57,6 +57,16 @@ try
     // Get the port number.
     const uint16_t port = ::getarg<uint16_t>(argc-1, argv+1, "-p", 80);
 
+    // Splice unmasked payloads from a trusted peer to standard output?
+    const bool zero_copy = ::hasarg(argc-1, argv+1, "-z");
+
+    // Coalesce output to standard output in a buffer this large.
+    const std::size_t buffer =
+        ::getarg<std::size_t>(argc-1, argv+1, "-b", 64*1024);
+
+    // Print read statistics on exit?
+    const bool stats = ::hasarg(argc-1, argv+1, "-s");
+
     // Assemble the IP end point.
     const nix::net::Endpoint endpoint =
         nix::net::Endpoint::resolve(name.c_str(), port);
@@ -70,7 +80,18 @@ try
     nix::net::Stream peer(listener);
 
     // Perform tunnelled data exchange.
-    nix::Server(host, peer).exchange(name);
+    nix::Server server(host, peer);
+    server.buffer_output(buffer);
+    if (zero_copy) {
+        server.trust_peer();
+        server.zero_copy();
+    }
+    server.exchange(name);
+    if (stats) {
+        std::cerr
+            << "Host: " << server.host_input() << "." << std::endl
+            << "Peer: " << server.peer_input() << "." << std::endl;
+    }
 }
 catch ( const std::exception& error )
 {
@@ -30,7 +30,6 @@
 
 #include "Tunnel.hpp"
 #include "win/Thread.hpp"
-#include "Digest.hpp"
 
 #include <ctime>
 #include <iostream>
@@ -55,12 +54,12 @@ namespace win {
 
     std::string Tunnel::approve_nonce ( const std::string& skey )
     {
-        static const std::string guid
-            ("258EAFA5-E914-47DA-95CA-C5AB0DC85B11");
-        sha1::Digest digest;
-        digest.update(skey.data(), skey.size());
-        digest.update(guid.data(), guid.size());
-        return (digest.result());
+        if ( skey.size() != WS_ACCEPT_KEY_SIZE ) {
+            return (std::string());
+        }
+        char accept[WS_ACCEPT_SIZE];
+        ::ws_accept_key(skey.data(), accept);
+        return (std::string(accept, WS_ACCEPT_SIZE));
     }
 
     void Tunnel::generate_nonce ( void * data, size_t size )
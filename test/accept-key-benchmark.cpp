@@ -0,0 +1,100 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/accept-key-benchmark.cpp
+ * @brief Compares @c ws_accept_key() with the generic SHA-1 and base64 path.
+ *
+ * Pass the number of keys to approve as the only argument.
+ */
+
+#include "unit-test.hpp"
+#include "b64.hpp"
+
+#include <ctime>
+#include <sstream>
+
+namespace {
+
+    const char guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+    // generic path, as used by the demos before 'ws_accept_key()'.
+    std::string approve ( const std::string& key )
+    {
+        sha1::Digest digest;
+        digest.update(key.data(), key.size());
+        digest.update(guid, sizeof(guid)-1);
+        return (b64::encode(digest.result()));
+    }
+
+    void report ( const char * name, std::clock_t time, long count )
+    {
+        const double seconds = double(time) / CLOCKS_PER_SEC;
+        std::cout
+            << name << ": " << count << " keys in " << seconds << " s, "
+            << (seconds > 0.0? long(count/seconds) : 0) << " keys/s, "
+            << (seconds * 1e9 / count) << " ns/key"
+            << std::endl;
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        long count = 1000000;
+        if (argc > 0) {
+            std::istringstream(argv[0]) >> count;
+        }
+        char key[] = "dGhlIHNhbXBsZSBub25jZQ==";
+
+        // vary the key so nothing gets hoisted out of the loop.
+        std::size_t check = 0;
+        std::clock_t start = std::clock();
+        for (long i = 0; i < count; ++i)
+        {
+            key[i&15] ^= char(i);
+            char accept[WS_ACCEPT_SIZE];
+            ::ws_accept_key(key, accept);
+            check += accept[i%WS_ACCEPT_SIZE];
+        }
+        std::string name = std::string("ws_accept_key/") + ::ws_accept_engine();
+        report(name.c_str(), std::clock()-start, count);
+
+        start = std::clock();
+        for (long i = 0; i < count; ++i)
+        {
+            key[i&15] ^= char(i);
+            const std::string accept = approve(key);
+            check += accept[i%accept.size()];
+        }
+        report("sha1::Digest+b64::encode", std::clock()-start, count);
+
+        std::cerr << "(checksum: " << check << ")" << std::endl;
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
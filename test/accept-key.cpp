@@ -0,0 +1,89 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/accept-key.cpp
+ * @brief Checks the server's approval of client nonces.
+ */
+
+#include "unit-test.hpp"
+
+#include <cstring>
+
+namespace {
+
+    // pairs of Sec-WebSocket-Key and Sec-WebSocket-Accept values.
+    const char *const samples[][2] = {
+        // sample from RFC 6455, section 1.3.
+        { "dGhlIHNhbXBsZSBub25jZQ==", "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=" },
+        { "ESIzRFVmd4iZqrvM3e7/EA==", "DKEBK1z7nPr9cpYA4sijztsrMr8=" },
+        { "UmN0hZanuMna6/wNHi9AUQ==", "V/hXVjkjDCYgKY+X7IZCaIPLAs4=" },
+        { "SFlqe4ydrr/Q4fIDFCU2Rw==", "nVvM+v6RWo2asR2OtBzN2kM+tJg=" },
+    };
+
+    int test ( int argc, char ** argv )
+    {
+        // every implementation available here must give the same values.
+        const char *const engines[] = { "scalar", "sha-ni" };
+        for (std::size_t engine = 0; engine < 2; ++engine)
+        {
+            if (!::ws_accept_override(engines[engine]))
+            {
+                if (engine == 0) {
+                    fail("scalar SHA-1 unavailable");
+                }
+                std::cerr << "skipping: " << engines[engine] << std::endl;
+                continue;
+            }
+            std::cerr << "engine: " << ::ws_accept_engine() << std::endl;
+            for (std::size_t i = 0; i < sizeof(samples)/sizeof(*samples); ++i)
+            {
+                char accept[WS_ACCEPT_SIZE+1];
+                std::memset(accept, '!', sizeof(accept));
+                ::ws_accept_key(samples[i][0], accept);
+                if (accept[WS_ACCEPT_SIZE] != '!') {
+                    fail("wrote past the end of the buffer");
+                }
+                if (std::memcmp(accept, samples[i][1], WS_ACCEPT_SIZE) != 0)
+                {
+                    std::cerr
+                        << "key: '" << samples[i][0] << "'" << std::endl
+                        << "got: '" << std::string(accept, WS_ACCEPT_SIZE)
+                        << "'" << std::endl;
+                    fail("wrong accept value");
+                }
+            }
+        }
+        if (::ws_accept_override("none") || !::ws_accept_override(0)) {
+            fail("overrides not checked");
+        }
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
@@ -0,0 +1,177 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/*!
+ * @internal
+ * @file test/arena-allocator.cpp
+ * @brief Checks slabs and buffer pools carved from an arena.
+ */
+
+#include "unit-test.hpp"
+
+#include <cstddef>
+#include <cstring>
+
+namespace {
+
+    // arena memory: 3 pages however it is aligned, with some slack.
+    char memory[3*WS_ARENA_PAGE+WS_ARENA_PAGE/2];
+
+    bool aligned ( const void * data )
+    {
+        return ((std::size_t(data) % WS_ARENA_ALIGN) == 0);
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        // misaligned blocks lose their head and their incomplete last page.
+        ::ws_arena arena;
+        ::ws_arena_init(&arena, memory+1, sizeof(memory)-1);
+        if (::ws_arena_left(&arena) != 3) {
+            fail("wrong number of pages");
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            const char *const page =
+                static_cast<const char*>(::ws_arena_page(&arena));
+            if ((page == 0) || !aligned(page) || (page <= memory) ||
+                (page+WS_ARENA_PAGE > memory+sizeof(memory)))
+            {
+                fail("bad page");
+            }
+        }
+        if ((::ws_arena_page(&arena) != 0) || (arena.pages != 3)) {
+            fail("arena not exhausted");
+        }
+
+        // slabs recycle released objects before taking new pages.
+        ::ws_arena_init(&arena, memory, sizeof(memory));
+        ::ws_slab slab;
+        ::ws_slab_init(&slab, &arena, 1000);
+        if (slab.size != 1008) {
+            fail("object size not rounded");
+        }
+        void * objects[64];
+        for (int cycle = 0; cycle < 1000; ++cycle)
+        {
+            for (int i = 0; i < 64; ++i)
+            {
+                objects[i] = ::ws_slab_get(&slab);
+                if ((objects[i] == 0) || !aligned(objects[i])) {
+                    fail("bad object");
+                }
+                std::memset(objects[i], i, 1000);
+            }
+            for (int i = 0; i < 64; ++i) {
+                if (static_cast<unsigned char*>(objects[i])[999] != i) {
+                    fail("objects overlap");
+                }
+            }
+            if (arena.pages != 1) {
+                fail("churn consumed pages");
+            }
+            for (int i = 0; i < 64; ++i) {
+                ::ws_slab_put(&slab, objects[(i*7)%64]);
+            }
+        }
+        if ((slab.used != 0) || (arena.pages != 0) ||
+            (::ws_arena_left(&arena) != 3))
+        {
+            fail("empty page not returned");
+        }
+        ::ws_slab huge;
+        ::ws_slab_init(&huge, &arena, WS_ARENA_PAGE+1);
+        if (::ws_slab_get(&huge) != 0) {
+            fail("object larger than a page");
+        }
+
+        // pools round requests up to the next size class.
+        if ((::ws_pool_fit(0) != 64) || (::ws_pool_fit(64) != 64) ||
+            (::ws_pool_fit(65) != 128) || (::ws_pool_fit(5000) != 8192) ||
+            (::ws_pool_fit(WS_ARENA_PAGE) != WS_ARENA_PAGE) ||
+            (::ws_pool_fit(WS_ARENA_PAGE+1) != 0))
+        {
+            fail("wrong size classes");
+        }
+        ::ws_pool pool;
+        ::ws_pool_init(&pool, &arena);
+        void *const small = ::ws_pool_get(&pool, 100);
+        void *const large = ::ws_pool_get(&pool, WS_ARENA_PAGE);
+        void *const other = ::ws_pool_get(&pool, WS_ARENA_PAGE);
+        if ((small == 0) || (large == 0) || (other == 0) ||
+            (::ws_pool_used(&pool) != 3))
+        {
+            fail("pool allocation failed");
+        }
+        if (::ws_pool_get(&pool, WS_ARENA_PAGE) != 0) {
+            fail("arena should be exhausted");
+        }
+        ::ws_pool_put(&pool, other, WS_ARENA_PAGE);
+        ::ws_pool_put(&pool, large, WS_ARENA_PAGE);
+        if (::ws_pool_get(&pool, 40000) != large) {
+            fail("buffer not recycled");
+        }
+        ::ws_pool_put(&pool, small, 128);
+        if (::ws_pool_get(&pool, 65) != small) {
+            fail("buffer not recycled by capacity");
+        }
+        if (::ws_pool_get(&pool, WS_ARENA_PAGE+1) != 0) {
+            fail("buffer larger than a page");
+        }
+
+        // empty pages go back to the arena and serve other sizes.
+        ::ws_arena_init(&arena, memory, sizeof(memory));
+        ::ws_pool_init(&pool, &arena);
+        void * buffers[3];
+        for (int i = 0; i < 3; ++i) {
+            buffers[i] = ::ws_pool_get(&pool, 64 << i);
+        }
+        if (::ws_arena_left(&arena) != 0) {
+            fail("small buffers should hold all pages");
+        }
+        for (int i = 0; i < 3; ++i) {
+            ::ws_pool_put(&pool, buffers[i], 64 << i);
+        }
+        if ((::ws_pool_used(&pool) != 0) || (::ws_arena_left(&arena) != 3)) {
+            fail("empty pages not returned");
+        }
+        void * larges[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            larges[i] = ::ws_pool_get(&pool, WS_ARENA_PAGE);
+            if (larges[i] == 0) {
+                fail("large buffer not served from a returned page");
+            }
+        }
+        for (int i = 0; i < 3; ++i) {
+            ::ws_pool_put(&pool, larges[i], WS_ARENA_PAGE);
+        }
+
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
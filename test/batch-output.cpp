@@ -0,0 +1,101 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/batch-output.cpp
+ * @brief Tests encoding of many messages into a contiguous buffer.
+ */
+
+#include "unit-test.hpp"
+
+#include <vector>
+
+namespace {
+
+    void accept_content ( ::ws_owire * wire, const void * data, uint64 size )
+    {
+        static_cast<std::string*>(wire->baton)
+            ->append(static_cast<const char*>(data), size);
+    }
+
+    void fixed_mask ( ::ws_owire * wire, uint8 mask[4] )
+    {
+        mask[0] = 0x37, mask[1] = 0xfa, mask[2] = 0x21, mask[3] = 0x3d;
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        const std::string small("hello");
+        const std::string medium(300, 'm');
+        const std::string large(70000, 'l');
+
+        ::ws_owire_message messages[] = {
+            { ::ws_text, small.data(), small.size(), 0 },
+            { ::ws_ping, 0, 0, 0 },
+            { ::ws_data, medium.data(), medium.size(), 0 },
+            { ::ws_data, large.data(), large.size(), 0 },
+            { ::ws_text, small.data(), small.size(), 0 },
+        };
+        const uint64 count = sizeof(messages)/sizeof(messages[0]);
+
+        for (int masked = 0; masked < 2; ++masked)
+        {
+            // reference output, one message at a time.
+            std::string answer;
+            ::ws_owire wire;
+            ::ws_owire_init(&wire);
+            wire.baton = &answer;
+            wire.accept_content = &accept_content;
+            wire.rand = &fixed_mask;
+            wire.mask_payload = masked;
+            for (uint64 i = 0; i < count; ++i)
+            {
+                ::ws_owire_new_frame(&wire, messages[i].type,
+                                     messages[i].size, 1, 0);
+                ::ws_owire_feed(&wire, messages[i].data, messages[i].size);
+                ::ws_owire_end_frame(&wire);
+            }
+
+            // batched output.
+            const uint64 size = ::ws_owire_batch_size(&wire, messages, count);
+            std::vector<char> result(size+1, '\0');
+            const uint64 used =
+                ::ws_owire_put_batch(&wire, messages, count, &result[0]);
+            if (used != size) {
+                fail("encoded size does not match precomputed size");
+            }
+            if (std::string(&result[0], used) != answer) {
+                fail("batched output mismatch");
+            }
+        }
+
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
@@ -0,0 +1,129 @@
+#ifndef _capture_hpp__
+#define _capture_hpp__
+
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/capture.hpp
+ * @brief Recorded wire traffic, as the sequence of segments received.
+ *
+ * A capture file starts with the 8-byte signature "WSCAP001", followed by one
+ * record per segment: its size as a 32-bit big-endian integer, then its
+ * bytes.  Each segment is what one read from the socket returned, so that
+ * replaying them reproduces the original TCP segmentation.
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace capture {
+
+    const char signature[] = "WSCAP001";
+
+    /*!
+     * @brief Whole capture, in memory.
+     */
+    struct Capture
+    {
+        // all segments, back to back.
+        std::string data;
+
+        // end offset of each segment in @c data.
+        std::vector<std::size_t> segments;
+    };
+
+    /*!
+     * @brief Appends segments to a capture file.
+     */
+    class Writer
+    {
+        /* data. */
+    private:
+        std::ofstream myFile;
+
+        /* construction. */
+    public:
+        Writer ( const char * path )
+            : myFile(path, std::ios::binary)
+        {
+            myFile.write(signature, 8);
+        }
+
+        /* methods. */
+    public:
+        bool ok () const
+        {
+            return (myFile.good());
+        }
+
+        void put ( const void * data, std::size_t size )
+        {
+            const char header[] = {
+                char(size >> 24), char(size >> 16), char(size >> 8), char(size),
+            };
+            myFile.write(header, sizeof(header));
+            myFile.write(static_cast<const char*>(data), size);
+        }
+    };
+
+    /*!
+     * @brief Read a whole capture file.
+     * @return @c false if the file cannot be read or is not a capture.
+     */
+    inline bool load ( const char * path, Capture& capture )
+    {
+        std::ifstream file(path, std::ios::binary);
+        char header[8];
+        if (!file.read(header, 8) || (std::memcmp(header, signature, 8) != 0)) {
+            return (false);
+        }
+        capture.data.clear();
+        capture.segments.clear();
+        while (file.read(header, 4))
+        {
+            const std::size_t size =
+                (std::size_t(static_cast<unsigned char>(header[0])) << 24) |
+                (std::size_t(static_cast<unsigned char>(header[1])) << 16) |
+                (std::size_t(static_cast<unsigned char>(header[2])) <<  8) |
+                (std::size_t(static_cast<unsigned char>(header[3])) <<  0);
+            const std::size_t used = capture.data.size();
+            capture.data.resize(used + size);
+            if ((size > 0) && !file.read(&capture.data[used], size)) {
+                return (false);
+            }
+            capture.segments.push_back(used + size);
+        }
+        return (file.eof());
+    }
+
+}
+
+#endif /* _capture_hpp__ */
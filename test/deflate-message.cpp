@@ -0,0 +1,399 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/deflate-message.cpp
+ * @brief Tests the per-message compression extension.
+ */
+
+#include "unit-test.hpp"
+
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#include <zlib.h>
+
+namespace {
+
+    struct Peer
+    {
+        ::ws_iwire iwire;
+        ::ws_deflate deflate;
+        bool first;
+        std::string message;
+        std::string payload;
+        std::size_t messages;
+    };
+
+    void new_message ( ::ws_iwire * wire )
+    {
+        static_cast<Peer*>(wire->baton)->first = true;
+    }
+
+    void new_fragment ( ::ws_iwire * wire, uint64 size )
+    {
+        Peer& peer = *static_cast<Peer*>(wire->baton);
+        if (peer.first) {
+            ::ws_deflate_new_message(&peer.deflate,
+                (::ws_iwire_extension(wire) & WS_DEFLATE_EXTENSION) != 0);
+            peer.first = false;
+        }
+    }
+
+    void accept_content ( ::ws_iwire * wire, const void * data, uint64 size )
+    {
+        Peer& peer = *static_cast<Peer*>(wire->baton);
+        ::ws_deflate_inflate(&peer.deflate, data, size);
+    }
+
+    void end_message ( ::ws_iwire * wire )
+    {
+        Peer& peer = *static_cast<Peer*>(wire->baton);
+        ::ws_deflate_end_message(&peer.deflate);
+        peer.messages++;
+    }
+
+    void inflated ( ::ws_deflate * deflate, const void * data, uint64 size )
+    {
+        static_cast<Peer*>(deflate->baton)
+            ->message.append(static_cast<const char*>(data), size);
+    }
+
+    void accept_output ( ::ws_owire * wire, const void * data, uint64 size )
+    {
+        static_cast<std::string*>(wire->baton)
+            ->append(static_cast<const char*>(data), size);
+    }
+
+    void setup ( Peer& peer, const ::ws_deflate_params& params, int server )
+    {
+        ::ws_iwire_init(&peer.iwire);
+        peer.iwire.baton = &peer;
+        peer.iwire.extension_mask = WS_DEFLATE_EXTENSION;
+        peer.iwire.new_message = &new_message;
+        peer.iwire.new_fragment = &new_fragment;
+        peer.iwire.accept_content = &accept_content;
+        peer.iwire.end_message = &end_message;
+        ::ws_deflate_init(&peer.deflate);
+        peer.deflate.baton = &peer;
+        peer.deflate.accept_content = &inflated;
+        peer.deflate.params = params;
+        peer.deflate.server = server;
+        peer.first = false;
+        peer.messages = 0;
+    }
+
+    std::string sample ( int seed )
+    {
+        std::ostringstream json;
+        json << '[';
+        for (int i = 0; i < 200; ++i) {
+            json << "{\"id\":" << (seed*1000+i)
+                 << ",\"name\":\"item\",\"active\":true},";
+        }
+        json << ']';
+        return (json.str());
+    }
+
+    // client sends messages to the server.
+    void exchange ( const ::ws_deflate_params& params,
+                    uint64 buffer_size, int masked )
+    {
+        Peer client;
+        Peer server;
+        setup(client, params, 0);
+        setup(server, params, 1);
+
+        std::string wire_data;
+        ::ws_owire owire;
+        ::ws_owire_init(&owire);
+        owire.baton = &wire_data;
+        owire.accept_content = &accept_output;
+        owire.mask_payload = masked;
+
+        std::vector<char> buffer(buffer_size+1);
+        if (buffer_size > 0) {
+            client.deflate.buffer = &buffer[0];
+            client.deflate.buffer_size = buffer_size;
+        }
+
+        uint64 total = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            const std::string message = sample(i);
+            total += message.size();
+            wire_data.clear();
+            server.message.clear();
+            ::ws_deflate_put(&client.deflate, &owire,
+                             ::ws_text, message.data(), message.size());
+            if (client.deflate.status != ::ws_deflate_ok) {
+                fail("could not compress message");
+            }
+            if (wire_data.size() >= message.size()/4) {
+                fail("message not compressed");
+            }
+            if ((static_cast<uint8>(wire_data[0]) & 0x40) == 0) {
+                fail("RSV1 not set on compressed message");
+            }
+            ::ws_iwire_feed(&server.iwire, wire_data.data(), wire_data.size());
+            if (server.iwire.status != ::ws_iwire_ok) {
+                fail("could not parse compressed message");
+            }
+            if (server.deflate.status != ::ws_deflate_ok) {
+                fail("could not decompress message");
+            }
+            if (server.message != message) {
+                fail("decompressed message mismatch");
+            }
+        }
+        if (server.messages != 4) {
+            fail("wrong number of messages");
+        }
+
+        // uncompressed messages are forwarded as is.
+        wire_data.clear();
+        server.message.clear();
+        ::ws_owire_put_text(&owire, "hello", 5, 0);
+        ::ws_iwire_feed(&server.iwire, wire_data.data(), wire_data.size());
+        if (server.message != "hello") {
+            fail("uncompressed message mismatch");
+        }
+
+        ::ws_deflate_clear(&client.deflate);
+        ::ws_deflate_clear(&server.deflate);
+        if ((client.deflate.memory != 0) || (server.deflate.memory != 0)) {
+            fail("zlib state leaked");
+        }
+    }
+
+    // compress like a peer that may end messages with a final block, as
+    // RFC 7692 (section 7.2.3.4) allows, instead of an empty stored block.
+    std::string compress ( const std::string& message,
+                           const std::string& window, bool final )
+    {
+        ::z_stream zstream;
+        std::memset(&zstream, 0, sizeof(zstream));
+        ::deflateInit2(&zstream, Z_DEFAULT_COMPRESSION,
+                       Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+        if (!window.empty()) {
+            ::deflateSetDictionary(&zstream,
+                reinterpret_cast<const Bytef*>(window.data()), window.size());
+        }
+        std::vector<char> output(::deflateBound(&zstream, message.size())+16);
+        zstream.next_in = reinterpret_cast<Bytef*>(
+            const_cast<char*>(message.data()));
+        zstream.avail_in = message.size();
+        zstream.next_out = reinterpret_cast<Bytef*>(&output[0]);
+        zstream.avail_out = output.size();
+        ::deflate(&zstream, final? Z_FINISH : Z_SYNC_FLUSH);
+        std::size_t size = output.size() - zstream.avail_out;
+        ::deflateEnd(&zstream);
+        if (!final) {
+            size -= 4;
+        }
+        return (std::string(&output[0], size));
+    }
+
+    // messages that end with a final block keep the context.
+    void finals ()
+    {
+        ::ws_deflate_params params;
+        std::memset(&params, 0, sizeof(params));
+        Peer server;
+        setup(server, params, 1);
+
+        std::string wire_data;
+        ::ws_owire owire;
+        ::ws_owire_init(&owire);
+        owire.baton = &wire_data;
+        owire.accept_content = &accept_output;
+
+        std::string window;
+        for (int i = 0; i < 4; ++i)
+        {
+            const std::string message = sample(i);
+            const std::string data = compress(message, window, i != 1);
+            window = message;
+            wire_data.clear();
+            server.message.clear();
+            ::ws_owire_new_frame(&owire, ::ws_text, data.size(), 1,
+                                 WS_DEFLATE_EXTENSION);
+            ::ws_owire_feed(&owire, data.data(), data.size());
+            ::ws_owire_end_frame(&owire);
+            ::ws_iwire_feed(&server.iwire, wire_data.data(), wire_data.size());
+            if ((server.iwire.status != ::ws_iwire_ok) ||
+                (server.deflate.status != ::ws_deflate_ok))
+            {
+                std::cerr << "message: " << i << std::endl;
+                fail("could not decompress message after a final block");
+            }
+            if (server.message != message) {
+                std::cerr << "message: " << i << std::endl;
+                fail("decompressed message mismatch after a final block");
+            }
+        }
+        ::ws_deflate_clear(&server.deflate);
+    }
+
+    void negotiate ()
+    {
+        const char offer[] =
+            "x-webkit-deflate-frame, "
+            "permessage-deflate; server_max_window_bits=16, "
+            "permessage-deflate; client_max_window_bits; "
+            "server_max_window_bits=\"12\"";
+        ::ws_deflate_params params;
+        if (!::ws_deflate_parse(offer, std::strlen(offer), &params)) {
+            fail("could not parse offer");
+        }
+        if ((params.server_max_window_bits != 12) ||
+            (params.client_max_window_bits != -1) ||
+             params.server_no_context_takeover ||
+             params.client_no_context_takeover)
+        {
+            fail("wrong offer parameters");
+        }
+
+        ::ws_deflate_params limits;
+        std::memset(&limits, 0, sizeof(limits));
+        limits.server_max_window_bits = 10;
+        limits.client_max_window_bits = 11;
+        limits.server_no_context_takeover = 1;
+        ::ws_deflate_params agreed;
+        if (!::ws_deflate_accept(&params, &limits, &agreed)) {
+            fail("offer declined");
+        }
+
+        char response[128];
+        const uint64 size =
+            ::ws_deflate_format(&agreed, response, sizeof(response));
+        const std::string expected =
+            "permessage-deflate; server_no_context_takeover; "
+            "server_max_window_bits=10; client_max_window_bits=11";
+        if (std::string(response, size) != expected) {
+            fail("wrong response");
+        }
+        if (::ws_deflate_format(&agreed, response, 20) != 0) {
+            fail("buffer overflow not detected");
+        }
+
+        // the client parses the response.
+        if (!::ws_deflate_parse(response, size, &params) ||
+            (params.server_max_window_bits != 10) ||
+            (params.client_max_window_bits != 11) ||
+            !params.server_no_context_takeover)
+        {
+            fail("could not parse response");
+        }
+        if (!::ws_deflate_confirm(&params)) {
+            fail("valid response refused");
+        }
+
+        // we can't compress with 256-byte windows.
+        const char tiny[] = "permessage-deflate; client_max_window_bits=8";
+        if (!::ws_deflate_parse(tiny, std::strlen(tiny), &params) ||
+            ::ws_deflate_confirm(&params))
+        {
+            fail("8-bit client window confirmed");
+        }
+
+        // invalid offers are skipped.
+        const char invalid[] = "permessage-deflate; unknown=1";
+        if (::ws_deflate_parse(invalid, std::strlen(invalid), &params)) {
+            fail("invalid offer accepted");
+        }
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        negotiate();
+
+        ::ws_deflate_params params;
+        std::memset(&params, 0, sizeof(params));
+
+        // context takeover, single frame messages.
+        exchange(params, 0, 1);
+        finals();
+
+        // many fragments per message, small windows.
+        params.client_max_window_bits = 9;
+        exchange(params, 64, 0);
+
+        // no context takeover.
+        params.client_no_context_takeover = 1;
+        params.server_no_context_takeover = 1;
+        params.client_max_window_bits = 0;
+        exchange(params, 100, 1);
+
+        // bounded zlib state.
+        ::ws_deflate deflate;
+        ::ws_deflate_init(&deflate);
+        deflate.memory_limit = 4096;
+        std::string output;
+        ::ws_owire owire;
+        ::ws_owire_init(&owire);
+        owire.baton = &output;
+        owire.accept_content = &accept_output;
+        ::ws_deflate_put(&deflate, &owire, ::ws_data, "data", 4);
+        if (deflate.status != ::ws_deflate_no_memory) {
+            fail("memory limit not enforced");
+        }
+        if (!output.empty() || (deflate.memory != 0)) {
+            fail("output written despite failure");
+        }
+        ::ws_deflate_clear(&deflate);
+
+        // control messages are sent as is.
+        ::ws_deflate_init(&deflate);
+        ::ws_deflate_put(&deflate, &owire, ::ws_ping, "ping", 4);
+        ::ws_deflate_put(&deflate, &owire, ::ws_same, "same", 4);
+        if ((output != std::string("\x89\x04ping", 6)) ||
+            (deflate.status != ::ws_deflate_ok) || (deflate.memory != 0))
+        {
+            fail("control message compressed");
+        }
+        ::ws_deflate_clear(&deflate);
+
+        // the client's window was limited to 256 bytes.
+        output.clear();
+        ::ws_deflate_init(&deflate);
+        deflate.params.client_max_window_bits = 8;
+        ::ws_deflate_put(&deflate, &owire, ::ws_data, "data", 4);
+        if ((deflate.status != ::ws_deflate_invalid_params) ||
+            !output.empty())
+        {
+            fail("compressed with a larger window than negotiated");
+        }
+        ::ws_deflate_clear(&deflate);
+
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
@@ -0,0 +1,215 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/deflate-pool.cpp
+ * @brief Tests lending of compression contexts to many connections.
+ */
+
+#include "unit-test.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    struct Peer
+    {
+        ::ws_iwire iwire;
+        ::ws_deflate deflate;
+        bool first;
+        std::string message;
+    };
+
+    void new_message ( ::ws_iwire * wire )
+    {
+        static_cast<Peer*>(wire->baton)->first = true;
+    }
+
+    void new_fragment ( ::ws_iwire * wire, uint64 size )
+    {
+        Peer& peer = *static_cast<Peer*>(wire->baton);
+        if (peer.first) {
+            ::ws_deflate_new_message(&peer.deflate,
+                (::ws_iwire_extension(wire) & WS_DEFLATE_EXTENSION) != 0);
+            peer.first = false;
+        }
+    }
+
+    void accept_content ( ::ws_iwire * wire, const void * data, uint64 size )
+    {
+        Peer& peer = *static_cast<Peer*>(wire->baton);
+        ::ws_deflate_inflate(&peer.deflate, data, size);
+    }
+
+    void end_message ( ::ws_iwire * wire )
+    {
+        Peer& peer = *static_cast<Peer*>(wire->baton);
+        ::ws_deflate_end_message(&peer.deflate);
+    }
+
+    void inflated ( ::ws_deflate * deflate, const void * data, uint64 size )
+    {
+        static_cast<Peer*>(deflate->baton)
+            ->message.append(static_cast<const char*>(data), size);
+    }
+
+    void accept_output ( ::ws_owire * wire, const void * data, uint64 size )
+    {
+        static_cast<std::string*>(wire->baton)
+            ->append(static_cast<const char*>(data), size);
+    }
+
+    void setup ( Peer& peer, const ::ws_deflate_params& params,
+                 ::ws_deflate_pool * pool )
+    {
+        ::ws_iwire_init(&peer.iwire);
+        peer.iwire.baton = &peer;
+        peer.iwire.extension_mask = WS_DEFLATE_EXTENSION;
+        peer.iwire.new_message = &new_message;
+        peer.iwire.new_fragment = &new_fragment;
+        peer.iwire.accept_content = &accept_content;
+        peer.iwire.end_message = &end_message;
+        ::ws_deflate_init(&peer.deflate);
+        peer.deflate.baton = &peer;
+        peer.deflate.accept_content = &inflated;
+        peer.deflate.params = params;
+        peer.deflate.server = 1;
+        peer.deflate.pool = pool;
+        peer.first = false;
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        const std::size_t connections = 50;
+        std::string message;
+        for (int i = 0; i < 100; ++i) {
+            message += "{\"event\":\"tick\",\"value\":12345},";
+        }
+
+        ::ws_deflate_params params;
+        std::memset(&params, 0, sizeof(params));
+        params.server_no_context_takeover = 1;
+        params.client_no_context_takeover = 1;
+        params.server_max_window_bits = 10;
+        params.client_max_window_bits = 10;
+
+        // compress the client's message once.
+        std::string frame;
+        ::ws_owire owire;
+        ::ws_owire_init(&owire);
+        owire.baton = &frame;
+        owire.accept_content = &accept_output;
+        owire.mask_payload = 1;
+        ::ws_deflate client;
+        ::ws_deflate_init(&client);
+        client.params = params;
+        ::ws_deflate_put(&client, &owire,
+                         ::ws_text, message.data(), message.size());
+        ::ws_deflate_clear(&client);
+
+        ::ws_deflate_pool pool;
+        ::ws_deflate_pool_init(&pool);
+        pool.window_bits = 10;
+        pool.capacity = 2;
+
+        // idle connections hold no zlib state.
+        std::vector<Peer> servers(connections);
+        for (std::size_t i = 0; i < connections; ++i) {
+            setup(servers[i], params, &pool);
+        }
+
+        // one message at a time: a single context per direction.
+        std::string reply;
+        owire.baton = &reply;
+        owire.mask_payload = 0;
+        for (std::size_t i = 0; i < connections; ++i)
+        {
+            ::ws_iwire_feed(&servers[i].iwire, frame.data(), frame.size());
+            if ((servers[i].deflate.status != ::ws_deflate_ok) ||
+                (servers[i].message != message))
+            {
+                fail("could not decompress message");
+            }
+            ::ws_deflate_put(&servers[i].deflate, &owire,
+                             ::ws_text, message.data(), message.size());
+            if (servers[i].deflate.status != ::ws_deflate_ok) {
+                fail("could not compress message");
+            }
+            if ((servers[i].deflate.memory != 0) || (pool.in_use != 0)) {
+                fail("context not returned to the pool");
+            }
+        }
+        if ((pool.contexts != 2) || (pool.peak != 1) ||
+            (pool.loans != 2*connections) || (pool.misses != 0))
+        {
+            fail("wrong pool statistics");
+        }
+
+        // a partial message holds its context.
+        const std::size_t half = frame.size() / 2;
+        servers[0].message.clear();
+        ::ws_iwire_feed(&servers[0].iwire, frame.data(), half);
+        if (pool.in_use != 1) {
+            fail("context not lent for the partial message");
+        }
+        ::ws_iwire_feed(&servers[1].iwire, frame.data(), frame.size());
+        if ((servers[1].deflate.status != ::ws_deflate_exhausted) ||
+            (pool.misses != 1))
+        {
+            fail("pool capacity not enforced");
+        }
+        ::ws_iwire_feed(&servers[0].iwire, frame.data()+half, frame.size()-half);
+        if ((servers[0].message != message) || (pool.in_use != 0)) {
+            fail("could not finish partial message");
+        }
+
+        // windows larger than the pool's are refused.
+        Peer large;
+        ::ws_deflate_params wide = params;
+        wide.client_max_window_bits = 0;
+        setup(large, wide, &pool);
+        ::ws_iwire_feed(&large.iwire, frame.data(), frame.size());
+        if (large.deflate.status != ::ws_deflate_invalid_params) {
+            fail("window size mismatch not detected");
+        }
+
+        for (std::size_t i = 0; i < connections; ++i) {
+            ::ws_deflate_clear(&servers[i].deflate);
+        }
+        ::ws_deflate_clear(&large.deflate);
+        ::ws_deflate_pool_clear(&pool);
+        if ((pool.contexts != 0) || (pool.memory != 0)) {
+            fail("pool leaked zlib state");
+        }
+
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
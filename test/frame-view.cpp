@@ -0,0 +1,120 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/frame-view.cpp
+ * @brief Tests decoding of frame views over the application's buffer.
+ */
+
+#include "unit-test.hpp"
+
+namespace {
+
+    const unsigned char data[] =
+    {
+        // frame 1: unmasked "hel", first fragment.
+        0x01, 3, 'h','e','l',
+
+        // frame 2: ping, interleaved.
+        0x89, 0x80|2, 0x37,0xfa,0x21,0x3d, 'p'^0x37,'i'^0xfa,
+
+        // frame 3: "lo!", last fragment, 16-bit size.
+        0x80, 126, 0x00, 0x03, 'l','o','!',
+
+        // frame 4: truncated binary message.
+        0x82, 10, '0','1','2',
+    };
+
+    int test ( int argc, char ** argv )
+    {
+        ::ws_frame frames[8];
+        uint64 count = 0;
+        uint64 used = 0;
+        uint64 need = 0;
+
+        // all complete frames, then the partial frame.
+        ::ws_frame_status status = ::ws_frame_scan
+            (data, sizeof(data), frames, 8, &count, &used, &need);
+        if ((status != ::ws_frame_partial) || (count != 3) ||
+            (used != 20) || (need != 7))
+        {
+            fail("unexpected scan result");
+        }
+        if ((frames[0].opcode != 0x1) || frames[0].last || frames[0].masked ||
+            (frames[0].start != 0) ||
+            (frames[0].offset != 2) || (frames[0].size != 3))
+        {
+            fail("frame 1 mismatch");
+        }
+        if ((frames[1].opcode != 0x9) || !frames[1].last ||
+            !frames[1].masked || (frames[1].mask[1] != 0xfa) ||
+            (frames[1].start != 5) ||
+            (frames[1].offset != 11) || (frames[1].size != 2))
+        {
+            fail("frame 2 mismatch");
+        }
+        if ((frames[2].opcode != 0x0) || !frames[2].last ||
+            (frames[2].start != 13) ||
+            (frames[2].offset != 17) || (frames[2].size != 3) ||
+            (std::string((const char*)data+frames[2].offset, 3) != "lo!"))
+        {
+            fail("frame 3 mismatch");
+        }
+
+        // capacity limits the number of frames.
+        status = ::ws_frame_scan
+            (data, sizeof(data), frames, 2, &count, &used, &need);
+        if ((status != ::ws_frame_ok) || (count != 2) || (used != 13)) {
+            fail("capacity not respected");
+        }
+
+        // partial header.
+        status = ::ws_frame_next(data+13, 3, &frames[0], &need);
+        if ((status != ::ws_frame_partial) || (need != 1)) {
+            fail("partial header not detected");
+        }
+
+        // invalid frames.
+        const unsigned char unknown[] = { 0x83, 0 };
+        const unsigned char control[] = { 0x09, 0 };
+        if (::ws_frame_next(unknown, 2, &frames[0], &need)
+            != ::ws_frame_unknown_message_type)
+        {
+            fail("unknown message type not detected");
+        }
+        if (::ws_frame_next(control, 2, &frames[0], &need)
+            != ::ws_frame_invalid_control)
+        {
+            fail("fragmented control frame not detected");
+        }
+
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
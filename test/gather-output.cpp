@@ -0,0 +1,165 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/gather-output.cpp
+ * @brief Tests scatter/gather output of frames.
+ */
+
+#include "unit-test.hpp"
+
+#include <vector>
+
+namespace {
+
+    struct Result
+    {
+        std::string output;
+        std::vector<int> calls;
+    };
+
+    void accept_content ( ::ws_owire * wire, const void * data, uint64 size )
+    {
+        static_cast<Result*>(wire->baton)
+            ->output.append(static_cast<const char*>(data), size);
+    }
+
+    void accept_slices ( ::ws_owire * wire,
+                         const ::ws_owire_slice * slices, int count )
+    {
+        Result& result = *static_cast<Result*>(wire->baton);
+        for (int i = 0; i < count; ++i)
+        {
+            result.output.append(
+                static_cast<const char*>(slices[i].data), slices[i].size);
+        }
+        result.calls.push_back(count);
+    }
+
+    void fixed_mask ( ::ws_owire * wire, uint8 mask[4] )
+    {
+        mask[0] = 0x37, mask[1] = 0xfa, mask[2] = 0x21, mask[3] = 0x3d;
+    }
+
+    // send the same messages through both output modes.
+    void send ( ::ws_owire& wire, const std::string& large )
+    {
+        ::ws_owire_put_text(&wire, "hello", 5, 0);
+        ::ws_owire_put_ping(&wire, 0, 0, 0);
+        ::ws_owire_begin_batch(&wire);
+        for (int i = 0; i < 10; ++i) {
+            ::ws_owire_put_text(&wire, "abc", 3, 0);
+        }
+        ::ws_owire_put_data(&wire, large.data(), large.size(), 0);
+        ::ws_owire_put_text(&wire, "xyz", 3, 0);
+        ::ws_owire_end_batch(&wire);
+        wire.auto_fragment = 4;
+        ::ws_owire_put_text(&wire, "0123456789", 10, 0);
+    }
+
+    std::string expected ( int masked, const std::string& large )
+    {
+        Result result;
+        ::ws_owire wire;
+        ::ws_owire_init(&wire);
+        wire.baton = &result;
+        wire.accept_content = &accept_content;
+        wire.rand = &fixed_mask;
+        wire.mask_payload = masked;
+        send(wire, large);
+        return (result.output);
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        const std::string large(10000, 'x');
+
+        // fragmentation: 3 frames, continuation type, last frame has FIN.
+        const std::string fragments(
+            "\x01\x04" "0123" "\x00\x04" "4567" "\x80\x02" "89", 16);
+
+        // unmasked output refers to the application's data.
+        {
+            Result result;
+            ::ws_owire wire;
+            ::ws_owire_init(&wire);
+            wire.baton = &result;
+            wire.accept_slices = &accept_slices;
+            send(wire, large);
+            if (result.output != expected(0, large)) {
+                fail("unmasked output mismatch");
+            }
+            if (result.output.compare(
+                    result.output.size()-16, 16, fragments) != 0) {
+                fail("auto-fragmented output mismatch");
+            }
+            // text, ping, 12 batched messages in groups of 8, 3 fragments.
+            const int calls[] = { 2, 1, 16, 8, 6 };
+            if (result.calls != std::vector<int>(calls, calls+5)) {
+                fail("unexpected grouping of unmasked frames");
+            }
+        }
+
+        // masked output is staged in the application's buffer.
+        {
+            Result result;
+            std::vector<uint8> buffer(4000);
+            ::ws_owire wire;
+            ::ws_owire_init(&wire);
+            wire.baton = &result;
+            wire.accept_slices = &accept_slices;
+            wire.rand = &fixed_mask;
+            wire.mask_payload = 1;
+            wire.buffer = &buffer[0];
+            wire.buffer_size = buffer.size();
+            send(wire, large);
+            if (result.output != expected(1, large)) {
+                fail("masked output mismatch");
+            }
+        }
+
+        // masked output without an application buffer.
+        {
+            Result result;
+            ::ws_owire wire;
+            ::ws_owire_init(&wire);
+            wire.baton = &result;
+            wire.accept_slices = &accept_slices;
+            wire.rand = &fixed_mask;
+            wire.mask_payload = 1;
+            send(wire, large);
+            if (result.output != expected(1, large)) {
+                fail("masked output mismatch (no buffer)");
+            }
+        }
+
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
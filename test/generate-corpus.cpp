@@ -0,0 +1,298 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/generate-corpus.cpp
+ * @brief Synthesizes client traffic captures for @c replay-capture.
+ *
+ * Usage: generate-corpus profile path [-n messages] [-s seed]
+ *
+ * Profiles:
+ *
+ *  chat        short text messages, some non-ASCII, and periodic pings;
+ *  telemetry   JSON-like text records, some fragmented;
+ *  blobs       large binary messages, sent in 64 KiB fragments;
+ *  mixed       all of the above, mostly chat by count, mostly blobs by size.
+ *
+ * All frames are masked, as a client sends them.  Each message is written to
+ * the socket in one call and split in 1448-byte segments (an Ethernet MSS).
+ * The receiver lags behind by up to 8 segments and reads up to 8 queued
+ * segments (at most 64 KiB) at a time, so small messages get coalesced and
+ * large ones get split at arbitrary offsets.  The output is deterministic for
+ * a given seed.
+ */
+
+#include "unit-test.hpp"
+#include "options.hpp"
+#include "capture.hpp"
+#include "mt19937.h"
+
+#include <cstring>
+#include <deque>
+
+namespace {
+
+    const std::size_t mss = 1448;
+    const std::size_t lag = 8;
+    const std::size_t window = 64*1024;
+
+    enum Profile { Chat, Telemetry, Blobs, Mixed };
+
+    class Generator
+    {
+        /* data. */
+    private:
+        capture::Writer& myCapture;
+        ::mt19937_prng myPrng;
+        ::ws_owire myWire;
+
+        // bytes sent by the current message.
+        std::string myOutput;
+
+        // segments in flight, not yet read by the receiver.
+        std::deque<std::string> mySegments;
+
+        std::size_t myMessages;
+        std::size_t myReads;
+        uint64 myBytes;
+
+        /* construction. */
+    public:
+        Generator ( capture::Writer& capture, uint32_t seed )
+            : myCapture(capture), myMessages(0), myReads(0), myBytes(0)
+        {
+            ::mt19937_prng_init(&myPrng, seed);
+            ::ws_owire_init(&myWire);
+            myWire.baton          = this;
+            myWire.accept_content = &Generator::accept_content;
+            myWire.rand           = &Generator::rand;
+            myWire.mask_payload   = 1;
+        }
+
+        /* methods. */
+    public:
+        std::size_t messages () const
+        {
+            return (myMessages);
+        }
+
+        std::size_t reads () const
+        {
+            return (myReads);
+        }
+
+        uint64 bytes () const
+        {
+            return (myBytes);
+        }
+
+        uint32_t next ( uint32_t limit )
+        {
+            return (::mt19937_prng_next(&myPrng) % limit);
+        }
+
+        void chat ()
+        {
+            static const char *const words[] = {
+                "hello", "ok", "lol", "see", "you", "soon", "on", "my", "way",
+                "d\xc3\xa9j\xc3\xa0", "vu", "\xe2\x9c\x93", "thanks", "\xf0\x9f\x98\x80",
+                "meeting", "at", "noon", "?", "!",
+            };
+            std::string text;
+            const uint32_t count = 2 + next(40);
+            for (uint32_t i = 0; i < count; ++i) {
+                text.append(words[next(sizeof(words)/sizeof(*words))]);
+                text.push_back(' ');
+            }
+            ::ws_owire_put_text(&myWire, text.data(), text.size(), 0);
+            if (next(50) == 0) {
+                ::ws_owire_put_ping(&myWire, "keepaliv", 8, 0);
+            }
+            send();
+        }
+
+        void telemetry ()
+        {
+            std::string text("{\"device\":");
+            append(text, next(100000));
+            text.append(",\"samples\":[");
+            const uint32_t count = 10 + next(150);
+            for (uint32_t i = 0; i < count; ++i) {
+                text.append(i? "," : "");
+                append(text, next(1000000));
+            }
+            text.append("]}");
+
+            // some producers flush records in pieces.
+            if (next(10) == 0) {
+                myWire.auto_fragment = text.size()/(2+next(3)) + 1;
+            }
+            ::ws_owire_put_text(&myWire, text.data(), text.size(), 0);
+            myWire.auto_fragment = 0;
+            send();
+        }
+
+        void blob ()
+        {
+            std::string data(16*1024 + next(2*1024*1024), '\0');
+            ::mt19937_prng_grab(&myPrng, &data[0], data.size());
+            myWire.auto_fragment = 64*1024;
+            ::ws_owire_put_data(&myWire, data.data(), data.size(), 0);
+            myWire.auto_fragment = 0;
+            send();
+        }
+
+        void close ()
+        {
+            const uint8 status[] = { 0x03, 0xe8 };
+            ::ws_owire_put_kill(&myWire, status, sizeof(status), 0);
+            send();
+            while (!mySegments.empty()) {
+                read();
+            }
+        }
+
+    private:
+        static void append ( std::string& text, uint32_t value )
+        {
+            char digits[16];
+            std::size_t size = 0;
+            do {
+                digits[size++] = char('0' + value%10);
+            }
+            while ((value /= 10) > 0);
+            while (size > 0) {
+                text.push_back(digits[--size]);
+            }
+        }
+
+        // one write to the socket.
+        void send ()
+        {
+            ++myMessages;
+            for (std::size_t used = 0; used < myOutput.size(); used += mss) {
+                mySegments.push_back(myOutput.substr(used, mss));
+            }
+            myOutput.clear();
+            while (mySegments.size() > next(lag)) {
+                read();
+            }
+        }
+
+        // one read from the socket.
+        void read ()
+        {
+            std::string data;
+            const uint32_t count = 1 + next(lag);
+            for (uint32_t i = 0; (i < count) && !mySegments.empty(); ++i)
+            {
+                if (data.size()+mySegments.front().size() > window) {
+                    break;
+                }
+                data.append(mySegments.front());
+                mySegments.pop_front();
+            }
+            myCapture.put(data.data(), data.size());
+            myBytes += data.size(), ++myReads;
+        }
+
+        /* class methods. */
+    private:
+        static void accept_content
+            ( ::ws_owire * wire, const void * data, uint64 size )
+        {
+            static_cast<Generator*>(wire->baton)->myOutput.append(
+                static_cast<const char*>(data), std::size_t(size));
+        }
+
+        static void rand ( ::ws_owire * wire, uint8 mask[4] )
+        {
+            ::mt19937_prng_grab(
+                &static_cast<Generator*>(wire->baton)->myPrng, mask, 4);
+        }
+    };
+
+    int test ( int argc, char ** argv )
+    {
+        // options follow the positional arguments.
+        if ((argc < 2) || ::hasarg(2, argv, "-n") || ::hasarg(2, argv, "-s"))
+        {
+            std::cerr
+                << "Usage: generate-corpus profile path [-n messages] [-s seed]"
+                << std::endl;
+            return (FAIL);
+        }
+        const std::string name(argv[0]);
+        Profile profile = Mixed;
+        std::size_t count = 20000;
+        if (name == "chat") {
+            profile = Chat, count = 100000;
+        }
+        else if (name == "telemetry") {
+            profile = Telemetry, count = 20000;
+        }
+        else if (name == "blobs") {
+            profile = Blobs, count = 200;
+        }
+        else if (name != "mixed") {
+            fail("unknown profile");
+        }
+        count = ::getarg<std::size_t>(argc, argv, "-n", count);
+        const uint32_t seed = ::getarg<uint32_t>(argc, argv, "-s", 1);
+
+        capture::Writer capture(argv[1]);
+        Generator generator(capture, seed);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Profile kind = profile;
+            if (profile == Mixed)
+            {
+                const uint32_t dice = generator.next(1000);
+                kind = (dice < 700)? Chat : (dice < 998)? Telemetry : Blobs;
+            }
+            switch (kind)
+            {
+            case Chat:      generator.chat();      break;
+            case Telemetry: generator.telemetry(); break;
+            default:        generator.blob();      break;
+            }
+        }
+        generator.close();
+        if (!capture.ok()) {
+            fail("could not write capture");
+        }
+        std::cerr
+            << generator.messages() << " messages, "
+            << generator.bytes() << " bytes in "
+            << generator.reads() << " segments."
+            << std::endl;
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
@@ -0,0 +1,205 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/handshake-benchmark.cpp
+ * @brief Measures how fast the demo server completes opening handshakes.
+ *
+ * Starts an echo engine cluster on the loop-back interface, then has several
+ * client threads connect, complete the handshake with @c nix::Client and
+ * disconnect, as fast as they can.  Options:
+ *
+ *  -n   number of handshakes, in total (default: 10000);
+ *  -c   number of client threads (default: 4);
+ *  -t   number of server threads (default: 1);
+ *  -p   port number (default: 9080);
+ *  -u   drive the server with io_uring.
+ */
+
+#include "unit-test.hpp"
+#include "options.hpp"
+
+#include "nix/Client.hpp"
+#include "nix/Cluster.hpp"
+#include "nix/Endpoint.hpp"
+#include "nix/File.hpp"
+#include "nix/Stream.hpp"
+#include "nix/Thread.hpp"
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+    double now ( ::clockid_t clock )
+    {
+        ::timespec time;
+        ::clock_gettime(clock, &time);
+        return (time.tv_sec + time.tv_nsec*1e-9);
+    }
+
+    double cpu_time ()
+    {
+        ::rusage usage;
+        ::getrusage(RUSAGE_SELF, &usage);
+        return (usage.ru_utime.tv_sec + usage.ru_utime.tv_usec*1e-6 +
+                usage.ru_stime.tv_sec + usage.ru_stime.tv_usec*1e-6);
+    }
+
+    // state of one client thread.
+    struct Storm
+    {
+        nix::net::Endpoint endpoint;
+        std::size_t count;
+        std::size_t failed;
+        std::vector<std::string> nonces;
+        std::vector<double> latency;
+        double cpu;
+
+        Storm ( nix::net::Endpoint endpoint, std::size_t count )
+            : endpoint(endpoint), count(count), failed(0), cpu(0.0)
+        {
+            // draw nonces up front: reading /dev/random is not part of
+            // what is measured.
+            nonces.reserve(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                nonces.push_back(nix::Client::nonce());
+            }
+            latency.reserve(count);
+        }
+    };
+
+    void storm ( void * context )
+    {
+        Storm& storm = *static_cast<Storm*>(context);
+        nix::File host("/dev/null");
+        char data[1024];
+        const double start = now(CLOCK_THREAD_CPUTIME_ID);
+        for (std::size_t i = 0; i < storm.count; ++i)
+        try
+        {
+            const double begin = now(CLOCK_MONOTONIC);
+            nix::net::Stream peer(storm.endpoint);
+            nix::Client(host, peer).handshake(
+                "localhost", storm.nonces[i], data, sizeof(data));
+            storm.latency.push_back(now(CLOCK_MONOTONIC) - begin);
+
+            // reset the connection so that the client side doesn't run out
+            // of ports in TIME_WAIT.
+            const ::linger reset = { 1, 0 };
+            ::setsockopt(peer.handle(),
+                         SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+        }
+        catch ( const std::exception& )
+        {
+            // connection failure, early close, denied upgrade or wrong key.
+            ++storm.failed;
+        }
+        storm.cpu = now(CLOCK_THREAD_CPUTIME_ID) - start;
+    }
+
+    double percentile ( const std::vector<double>& data, double rank )
+    {
+        return (data.empty()? 0.0 : data[std::size_t(rank*(data.size()-1))]);
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        const std::size_t total = ::getarg<std::size_t>(argc, argv, "-n", 10000);
+        const std::size_t clients = ::getarg<std::size_t>(argc, argv, "-c", 4);
+        const std::size_t threads = ::getarg<std::size_t>(argc, argv, "-t", 1);
+        const uint16_t port = ::getarg<uint16_t>(argc, argv, "-p", 9080);
+        const bool uring = ::hasarg(argc, argv, "-u");
+        if ((total == 0) || (clients == 0) || (threads == 0)) {
+            fail("counts must be positive");
+        }
+        const nix::net::Endpoint endpoint =
+            nix::net::Endpoint::resolve("127.0.0.1", port);
+
+        nix::Cluster cluster(endpoint, &nix::Cluster::create<nix::Engine>);
+        cluster.start(threads, uring);
+
+        // unleash all clients at once.
+        std::vector<Storm*> storms;
+        for (std::size_t i = 0; i < clients; ++i) {
+            storms.push_back(new Storm(endpoint,
+                total/clients + (i < total%clients? 1 : 0)));
+        }
+        const double cpu = cpu_time();
+        const double start = now(CLOCK_MONOTONIC);
+        {
+            std::vector<nix::Thread*> workers;
+            for (std::size_t i = 0; i < clients; ++i) {
+                workers.push_back(new nix::Thread(&storm, storms[i]));
+            }
+            for (std::size_t i = 0; i < clients; ++i) {
+                delete workers[i];
+            }
+        }
+        const double elapsed = now(CLOCK_MONOTONIC) - start;
+        const double used = cpu_time() - cpu;
+        cluster.stop();
+        cluster.join();
+
+        // merge results.
+        std::vector<double> latency;
+        std::size_t failed = 0;
+        double client = 0.0;
+        for (std::size_t i = 0; i < clients; ++i)
+        {
+            latency.insert(latency.end(),
+                storms[i]->latency.begin(), storms[i]->latency.end());
+            failed += storms[i]->failed;
+            client += storms[i]->cpu;
+            delete storms[i];
+        }
+        std::sort(latency.begin(), latency.end());
+        const double count = double(std::max<std::size_t>(latency.size(), 1));
+
+        std::cout
+            << "server: " << threads << " thread(s), "
+            << (uring? "io_uring" : "epoll") << ", "
+            << "accept: " << ::ws_accept_engine() << std::endl
+            << "handshakes: " << latency.size()
+            << " (" << failed << " failed) from "
+            << clients << " client(s) in " << elapsed << " s" << std::endl
+            << "upgrades/s: " << long(latency.size()/elapsed) << std::endl
+            << "latency p50: " << percentile(latency, 0.50)*1e6 << " us"
+            << ", p99: " << percentile(latency, 0.99)*1e6 << " us"
+            << ", max: " << percentile(latency, 1.00)*1e6 << " us"
+            << std::endl
+            << "cpu/handshake: " << (used-client)/count*1e6 << " us server"
+            << ", " << client/count*1e6 << " us client" << std::endl;
+        return ((failed == 0)? PASS : FAIL);
+    }
+
+}
+
+#include "unit-test.cpp"
@@ -0,0 +1,157 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/header-decode.cpp
+ * @brief Tests that frame headers parse identically regardless of buffering.
+ */
+
+#include "unit-test.hpp"
+
+#include <sstream>
+#include <vector>
+
+namespace {
+
+    // record all callbacks in a string.
+    void new_message ( ::ws_iwire * wire )
+    {
+        *static_cast<std::string*>(wire->baton) += "<";
+    }
+
+    void end_message ( ::ws_iwire * wire )
+    {
+        *static_cast<std::string*>(wire->baton) += ">";
+    }
+
+    void new_fragment ( ::ws_iwire * wire, uint64 size )
+    {
+        std::ostringstream trace;
+        trace << '(' << (::ws_iwire_masked(wire)?'m':'p')
+              << ',' << ::ws_iwire_last_fragment(wire)
+              << ',' << ::ws_iwire_text(wire)
+              << ',' << size << ':';
+        *static_cast<std::string*>(wire->baton) += trace.str();
+    }
+
+    void end_fragment ( ::ws_iwire * wire )
+    {
+        *static_cast<std::string*>(wire->baton) += ")";
+    }
+
+    void accept_content ( ::ws_iwire * wire, const void * data, uint64 size )
+    {
+        static_cast<std::string*>(wire->baton)
+            ->append(static_cast<const char*>(data), size);
+    }
+
+    void frame ( std::vector<uint8>& stream, uint8 head,
+                 uint64 size, bool masked )
+    {
+        const uint8 mask[4] = { 0x37, 0xfa, 0x21, 0x3d };
+        stream.push_back(head);
+        const uint8 flag = masked? 0x80 : 0x00;
+        if (size < 126) {
+            stream.push_back(flag|uint8(size));
+        }
+        else if (size < 65536) {
+            stream.push_back(flag|126);
+            for (int i = 1; i >= 0; --i) {
+                stream.push_back(uint8(size >> (8*i)));
+            }
+        }
+        else {
+            stream.push_back(flag|127);
+            for (int i = 7; i >= 0; --i) {
+                stream.push_back(uint8(size >> (8*i)));
+            }
+        }
+        if (masked) {
+            stream.insert(stream.end(), mask, mask+4);
+        }
+        for (uint64 i = 0; i < size; ++i) {
+            stream.push_back(uint8('a'+(i%26)) ^ (masked? mask[i%4] : 0));
+        }
+    }
+
+    std::string parse ( const std::vector<uint8>& stream, std::size_t chunk )
+    {
+        std::string trace;
+        ::ws_iwire wire;
+        ::ws_iwire_init(&wire);
+        wire.baton = &trace;
+        wire.new_message    = &new_message;
+        wire.end_message    = &end_message;
+        wire.new_fragment   = &new_fragment;
+        wire.end_fragment   = &end_fragment;
+        wire.accept_content = &accept_content;
+        for (std::size_t used = 0; used < stream.size(); used += chunk)
+        {
+            const std::size_t size = std::min(chunk, stream.size()-used);
+            if (::ws_iwire_feed(&wire, &stream[used], size) != size) {
+                fail("could not parse frames");
+            }
+        }
+        return (trace);
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        const uint64 sizes[] = {
+            0, 1, 5, 125, 126, 127, 300, 65535, 65536, 70000,
+        };
+        std::vector<uint8> stream;
+        for (int masked = 0; masked < 2; ++masked)
+        {
+            for (std::size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i)
+            {
+                frame(stream, 0x80|0x02, sizes[i], masked != 0);
+            }
+            // fragmented message.
+            frame(stream, 0x01, 3, masked != 0);
+            frame(stream, 0x00, 0, masked != 0);
+            frame(stream, 0x80, 2, masked != 0);
+        }
+
+        // byte-wise parsing is the reference.
+        const std::string answer = parse(stream, 1);
+        const std::size_t chunks[] = { 2, 3, 7, 13, 1024, stream.size() };
+        for (std::size_t i = 0; i < sizeof(chunks)/sizeof(chunks[0]); ++i)
+        {
+            if (parse(stream, chunks[i]) != answer)
+            {
+                std::cerr << "chunk: " << chunks[i] << std::endl;
+                fail("trace mismatch");
+            }
+        }
+
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
@@ -0,0 +1,185 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/interleaved-control.cpp
+ * @brief Tests control messages injected between message fragments.
+ */
+
+#include "unit-test.hpp"
+
+#include <sstream>
+
+namespace {
+
+    const unsigned char data[] =
+    {
+        // fragment 1: "hel"
+        0x01,
+        3,
+        'h','e','l',
+
+        // ping: "\xff" (not part of the text).
+        0x80|0x09,
+        1,
+        0xff,
+
+        // fragment 2: "lo"
+        0x00,
+        2,
+        'l','o',
+
+        // pong, masked: "ok"
+        0x80|0x0a,
+        0x80|2,
+        0x01,0x02,0x03,0x04,
+        'o'^0x01,'k'^0x02,
+
+        // fragment 3: "!"
+        0x80|0x00,
+        1,
+        '!',
+
+        // ping, not interleaved.
+        0x80|0x09,
+        0,
+    };
+
+    void new_message ( ::ws_iwire * wire )
+    {
+        *static_cast<std::ostringstream*>(wire->baton) << "[";
+    }
+
+    void new_fragment ( ::ws_iwire * wire, uint64 size )
+    {
+        std::ostringstream& events =
+            *static_cast<std::ostringstream*>(wire->baton);
+        events << (::ws_iwire_interleaved(wire)? "*" : "")
+               << (::ws_iwire_ping(wire)? "ping:" : "")
+               << (::ws_iwire_pong(wire)? "pong:" : "")
+               << (::ws_iwire_text(wire)? "text:" : "");
+    }
+
+    void accept_content ( ::ws_iwire * wire, const void * data, uint64 size )
+    {
+        const unsigned char * bytes = static_cast<const unsigned char*>(data);
+        std::ostringstream& events =
+            *static_cast<std::ostringstream*>(wire->baton);
+        for (uint64 i = 0; i < size; ++i) {
+            if (bytes[i] < 0x80) {
+                events << bytes[i];
+            }
+            else {
+                events << '?';
+            }
+        }
+    }
+
+    void end_message ( ::ws_iwire * wire )
+    {
+        *static_cast<std::ostringstream*>(wire->baton) << "]";
+    }
+
+    ::ws_iwire_status parse ( const unsigned char * data, std::size_t size,
+                              std::size_t chunk, std::string& result )
+    {
+        std::ostringstream events;
+        ::ws_iwire wire;
+        ::ws_iwire_init(&wire);
+        wire.baton = &events;
+        wire.validate_text = 1;
+        wire.new_message = &new_message;
+        wire.new_fragment = &new_fragment;
+        wire.accept_content = &accept_content;
+        wire.end_message = &end_message;
+        for (std::size_t i = 0; (i < size) &&
+                 (wire.status == ::ws_iwire_ok); i += chunk)
+        {
+            ::ws_iwire_feed(&wire, data+i, std::min(chunk, size-i));
+        }
+        result = events.str();
+        return (wire.status);
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        const std::string expected =
+            "[text:hel[*ping:?]text:lo[*pong:ok]text:!][ping:]";
+        for (std::size_t chunk = 1; chunk <= sizeof(data); ++chunk)
+        {
+            std::string result;
+            if (parse(data, sizeof(data), chunk, result) != ::ws_iwire_ok) {
+                fail("could not parse interleaved control messages");
+            }
+            if (result != expected)
+            {
+                std::cerr
+                    << "chunk: " << chunk << std::endl
+                    << "expect: " << expected << std::endl
+                    << "result: " << result << std::endl
+                    ;
+                return (FAIL);
+            }
+        }
+
+        // control messages can't be fragmented.
+        const unsigned char fragmented[] = {
+            0x09, 1, 'a', 0x80, 1, 'b',
+        };
+        std::string result;
+        if (parse(fragmented, sizeof(fragmented), 100, result)
+            != ::ws_iwire_invalid_control)
+        {
+            fail("fragmented control message accepted");
+        }
+
+        // control messages have small payloads.
+        const unsigned char large[] = {
+            0x01, 1, 'a', 0x80|0x09, 126, 0x00, 0x7e,
+        };
+        if (parse(large, sizeof(large), 100, result)
+            != ::ws_iwire_invalid_control)
+        {
+            fail("large control message accepted");
+        }
+
+        // data messages can't be injected.
+        const unsigned char injected[] = {
+            0x01, 1, 'a', 0x80|0x02, 1, 'b',
+        };
+        if (parse(injected, sizeof(injected), 100, result)
+            != ::ws_iwire_message_type_changed)
+        {
+            fail("data message injected between fragments");
+        }
+
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
@@ -0,0 +1,179 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/invalid-utf8.cpp
+ * @brief Tests validation of text messages by the parser.
+ */
+
+#include "unit-test.hpp"
+
+#include <vector>
+
+namespace {
+
+    struct Result
+    {
+        std::string payload;
+        std::size_t messages;
+    };
+
+    void accept_content ( ::ws_iwire * wire, const void * data, uint64 size )
+    {
+        static_cast<Result*>(wire->baton)
+            ->payload.append(static_cast<const char*>(data), size);
+    }
+
+    void end_message ( ::ws_iwire * wire )
+    {
+        static_cast<Result*>(wire->baton)->messages++;
+    }
+
+    // append a frame, masked or not.
+    void frame ( std::vector<uint8>& data, uint8 head,
+                 const std::string& payload, bool masked )
+    {
+        const uint8 mask[4] = { 0x37, 0xfa, 0x21, 0x3d };
+        data.push_back(head);
+        data.push_back((masked? 0x80 : 0x00) | uint8(payload.size()));
+        if (masked) {
+            data.insert(data.end(), mask, mask+4);
+        }
+        for (std::size_t i = 0; i < payload.size(); ++i) {
+            data.push_back(uint8(payload[i]) ^ (masked? mask[i%4] : 0));
+        }
+    }
+
+    // parse frames, one byte at a time (chunk=1) or all at once.
+    ::ws_iwire_status parse ( std::vector<uint8> data, Result& result,
+                              std::size_t chunk, bool inplace,
+                              int validate=1, uint8 extensions=0 )
+    {
+        ::ws_iwire wire;
+        ::ws_iwire_init(&wire);
+        wire.baton = &result;
+        wire.accept_content = &accept_content;
+        wire.end_message = &end_message;
+        wire.validate_text = validate;
+        wire.extension_mask = extensions;
+        result.payload.clear();
+        result.messages = 0;
+        for (std::size_t i = 0; (i < data.size()) &&
+                 (wire.status == ::ws_iwire_ok); i += chunk)
+        {
+            const std::size_t size = std::min(chunk, data.size()-i);
+            if (inplace) {
+                ::ws_iwire_feed_inplace(&wire, &data[i], size);
+            }
+            else {
+                ::ws_iwire_feed(&wire, &data[i], size);
+            }
+        }
+        return (wire.status);
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        const std::size_t chunks[] = { 1, 3, 1000 };
+        for (std::size_t i = 0; i < 6; ++i)
+        {
+            const std::size_t chunk = chunks[i%3];
+            const bool inplace = (i >= 3);
+            for (int masked = 0; masked < 2; ++masked)
+            {
+                Result result;
+
+                // character split across fragments.
+                std::vector<uint8> valid;
+                frame(valid, 0x01, "h\xc3", masked);
+                frame(valid, 0x00, "\xa9llo \xe2\x82", !masked);
+                frame(valid, 0x80, "\xac", masked);
+                if ((parse(valid, result, chunk, inplace) != ::ws_iwire_ok) ||
+                    (result.payload != "h\xc3\xa9llo \xe2\x82\xac") ||
+                    (result.messages != 1))
+                {
+                    fail("valid text rejected");
+                }
+
+                // surrogate in the second fragment.
+                std::vector<uint8> invalid;
+                frame(invalid, 0x01, "valid", masked);
+                frame(invalid, 0x80, "\xed\xa0\x80", masked);
+                if (parse(invalid, result, chunk, inplace)
+                    != ::ws_iwire_invalid_utf8)
+                {
+                    fail("invalid text accepted");
+                }
+                // only a character's leading bytes can be passed before
+                // the rest is checked.
+                if ((result.payload.compare(0, 5, "valid") != 0) ||
+                    (result.payload.find('\xa0') != std::string::npos))
+                {
+                    fail("invalid text passed to the application");
+                }
+
+                // message ends in the middle of a character.
+                std::vector<uint8> truncated;
+                frame(truncated, 0x81, "abc\xf0\x9f\x98", masked);
+                if ((parse(truncated, result, chunk, inplace)
+                     != ::ws_iwire_invalid_utf8) || (result.messages != 0))
+                {
+                    fail("truncated text accepted");
+                }
+
+                // binary messages are not checked.
+                std::vector<uint8> binary;
+                frame(binary, 0x82, "\xff\xfe", masked);
+                if (parse(binary, result, chunk, inplace) != ::ws_iwire_ok) {
+                    fail("binary message rejected");
+                }
+
+                // validation is optional.
+                if (parse(invalid, result, chunk, inplace, 0)
+                    != ::ws_iwire_ok)
+                {
+                    fail("text checked without validation");
+                }
+
+                // extension payloads are decoded (and checked) by the
+                // application.
+                std::vector<uint8> compressed;
+                frame(compressed, 0xc1, "\xff\x00\x01", masked);
+                if (parse(compressed, result, chunk, inplace, 1, 0x4)
+                    != ::ws_iwire_ok)
+                {
+                    fail("extension payload checked");
+                }
+            }
+        }
+
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
@@ -0,0 +1,127 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/mask-payload.cpp
+ * @brief Tests payload masking against a byte-wise reference implementation.
+ */
+
+#include "unit-test.hpp"
+
+#include <vector>
+
+namespace {
+
+    // byte-wise masking, as described in the specification.
+    void reference ( const uint8 mask[4], uint64 offset,
+                     const uint8 * idata, uint8 * odata, uint64 size )
+    {
+        for (uint64 i = 0; i < size; ++i) {
+            odata[i] = idata[i] ^ mask[(offset+i) % 4];
+        }
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        const uint8 mask[4] = { 0x37, 0xfa, 0x21, 0x3d };
+
+        // pseudo-random payload, with some slack to test misalignment.
+        std::vector<uint8> idata(1100);
+        for (std::size_t i = 0; i < idata.size(); ++i) {
+            idata[i] = static_cast<uint8>((i * 131) ^ (i >> 3));
+        }
+        std::vector<uint8> expect(idata.size());
+        std::vector<uint8> result(idata.size());
+
+        // every implementation available here must match the reference.
+        const char *const engines[] = { "scalar", "sse2", "avx2", "neon" };
+        for (std::size_t engine = 0; engine < 4; ++engine)
+        {
+            if (!::ws_mask_override(engines[engine]))
+            {
+                if (engine == 0) {
+                    fail("scalar masking unavailable");
+                }
+                std::cout << "skipping: " << engines[engine] << std::endl;
+                continue;
+            }
+            // try all offsets in the key, at various alignments and sizes.
+            for (uint64 offset = 0; offset < 8; ++offset)
+            {
+                for (std::size_t align = 0; align < 8; ++align)
+                {
+                    for (uint64 size = 0; size < 1090;
+                         size += (size < 300)? 1 : 37)
+                    {
+                        reference(mask, offset,
+                                  &idata[align], &expect[0], size);
+                        ::ws_mask_apply(mask, offset,
+                                        &idata[align], &result[align], size);
+                        if (!std::equal(expect.begin(), expect.begin()+size,
+                                        result.begin()+align))
+                        {
+                            std::cerr
+                                << "engine: " << ::ws_mask_engine()
+                                << std::endl
+                                << "offset: " << offset << std::endl
+                                << "align: " << align << std::endl
+                                << "size: " << size << std::endl
+                                ;
+                            return (FAIL);
+                        }
+
+                        // masking in place must give the same result.
+                        std::copy(idata.begin(), idata.end(),
+                                  result.begin());
+                        ::ws_mask_apply(mask, offset,
+                                        &result[align], &result[align], size);
+                        if (!std::equal(expect.begin(), expect.begin()+size,
+                                        result.begin()+align))
+                        {
+                            std::cerr
+                                << "engine: " << ::ws_mask_engine()
+                                << std::endl
+                                << "in place, offset: " << offset << std::endl
+                                << "align: " << align << std::endl
+                                << "size: " << size << std::endl
+                                ;
+                            return (FAIL);
+                        }
+                    }
+                }
+            }
+        }
+        if (::ws_mask_override("none") || !::ws_mask_override(0)) {
+            fail("overrides not checked");
+        }
+
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
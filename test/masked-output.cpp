@@ -0,0 +1,101 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/masked-output.cpp
+ * @brief Tests formatting of masked frames into an application buffer.
+ */
+
+#include "unit-test.hpp"
+
+#include <vector>
+
+namespace {
+
+    struct Result
+    {
+        std::string output;
+        std::size_t calls;
+    };
+
+    void accept_content ( ::ws_owire * wire, const void * data, uint64 size )
+    {
+        Result& result = *static_cast<Result*>(wire->baton);
+        result.output.append(static_cast<const char*>(data), size);
+        result.calls++;
+    }
+
+    void fixed_mask ( ::ws_owire * wire, uint8 mask[4] )
+    {
+        mask[0] = 0x37, mask[1] = 0xfa, mask[2] = 0x21, mask[3] = 0x3d;
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        const uint8 mask[4] = { 0x37, 0xfa, 0x21, 0x3d };
+
+        std::string payload;
+        for (std::size_t i = 0; i < 70000; ++i) {
+            payload.push_back(static_cast<char>(i*7));
+        }
+
+        // expected output: 8-byte extended size, then mask, then payload.
+        std::string answer("\x82\xff\x00\x00\x00\x00\x00\x01\x11\x70", 10);
+        answer.append(reinterpret_cast<const char*>(mask), 4);
+        for (std::size_t i = 0; i < payload.size(); ++i) {
+            answer.push_back(payload[i] ^ mask[i%4]);
+        }
+
+        Result result;
+        result.calls = 0;
+        std::vector<uint8> buffer(payload.size());
+
+        ::ws_owire wire;
+        ::ws_owire_init(&wire);
+        wire.baton = &result;
+        wire.accept_content = &accept_content;
+        wire.rand = &fixed_mask;
+        wire.mask_payload = 1;
+        wire.buffer = &buffer[0];
+        wire.buffer_size = buffer.size();
+
+        ::ws_owire_put_data(&wire, payload.data(), payload.size(), 0);
+
+        // one call for the header, one call for the payload.
+        if (result.calls != 2) {
+            fail("masked payload was not forwarded in a single call");
+        }
+        if (result.output != answer) {
+            fail("output mismatch");
+        }
+
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
@@ -0,0 +1,155 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/priority-output.cpp
+ * @brief Tests scheduling of out-bound messages by priority.
+ */
+
+#include "unit-test.hpp"
+
+#include <sstream>
+
+namespace {
+
+    void accept_output ( ::ws_owire * wire, const void * data, uint64 size )
+    {
+        static_cast<std::string*>(wire->baton)
+            ->append(static_cast<const char*>(data), size);
+    }
+
+    void sent ( ::ws_oqueue * queue, ::ws_oqueue_entry * entry )
+    {
+        *static_cast<std::ostringstream*>(queue->baton)
+            << static_cast<const char*>(entry->baton) << ' ';
+    }
+
+    // describe each frame: type (or '+' for continuations), size, fin.
+    void new_fragment ( ::ws_iwire * wire, uint64 size )
+    {
+        std::ostringstream& frames =
+            *static_cast<std::ostringstream*>(wire->baton);
+        frames << (::ws_iwire_ping(wire)? "ping" :
+                   ::ws_iwire_pong(wire)? "pong" :
+                   ::ws_iwire_text(wire)? "text" : "data")
+               << ':' << size
+               << (::ws_iwire_last_fragment(wire)? "." : "") << ' ';
+    }
+
+    void entry ( ::ws_oqueue_entry& entry, ::ws_type type,
+                 const std::string& data, int priority, const char * name )
+    {
+        entry.type = type;
+        entry.data = data.data();
+        entry.size = data.size();
+        entry.extension = 0;
+        entry.priority = priority;
+        entry.baton = const_cast<char*>(name);
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        const std::string bulk(10000, 'b');
+        const std::string small("urgent");
+        const std::string later("later");
+        const std::string hello("hi");
+
+        std::string output;
+        ::ws_owire wire;
+        ::ws_owire_init(&wire);
+        wire.baton = &output;
+        wire.accept_content = &accept_output;
+
+        std::ostringstream done;
+        ::ws_oqueue queue;
+        ::ws_oqueue_init(&queue);
+        queue.wire = &wire;
+        queue.fragment_size = 4096;
+        queue.sent = &sent;
+        queue.baton = &done;
+
+        ::ws_oqueue_entry entries[5];
+        entry(entries[0], ::ws_data, bulk, 2, "bulk");
+        entry(entries[1], ::ws_text, later, 3, "later");
+        ::ws_oqueue_push(&queue, &entries[0]);
+        ::ws_oqueue_push(&queue, &entries[1]);
+
+        // start the bulk message, then queue urgent messages.
+        if (!::ws_oqueue_pump(&queue)) {
+            fail("nothing sent");
+        }
+        entry(entries[2], ::ws_text, small, 0, "urgent");
+        entry(entries[3], ::ws_ping, hello, 3, "ping");
+        entry(entries[4], ::ws_pong, hello, 0, "pong");
+        ::ws_oqueue_push(&queue, &entries[2]);
+        ::ws_oqueue_push(&queue, &entries[3]);
+        ::ws_oqueue_push(&queue, &entries[4]);
+        if ((queue.messages != 5) ||
+            (queue.bytes != bulk.size()-4096+later.size()+small.size()+4))
+        {
+            fail("wrong queue statistics");
+        }
+        while (::ws_oqueue_pump(&queue)) {
+        }
+        if (!::ws_oqueue_empty(&queue) || (queue.bytes != 0)) {
+            fail("messages left in the queue");
+        }
+
+        // decode what was sent.
+        std::ostringstream frames;
+        ::ws_iwire iwire;
+        ::ws_iwire_init(&iwire);
+        iwire.baton = &frames;
+        iwire.new_fragment = &new_fragment;
+        ::ws_iwire_feed(&iwire, output.data(), output.size());
+        if (iwire.status != ::ws_iwire_ok) {
+            fail("invalid output");
+        }
+
+        // control messages wait for one fragment, data messages can't
+        // preempt the bulk message.
+        const std::string expected_frames =
+            "data:4096 ping:2. pong:2. data:4096 data:1808. "
+            "text:6. text:5. ";
+        const std::string expected_done =
+            "ping pong bulk urgent later ";
+        if ((frames.str() != expected_frames) ||
+            (done.str() != expected_done))
+        {
+            std::cerr
+                << "frames: " << frames.str() << std::endl
+                << "done: " << done.str() << std::endl
+                ;
+            return (FAIL);
+        }
+
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
@@ -0,0 +1,240 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/*!
+ * @internal
+ * @file test/reassemble-message.cpp
+ * @brief Checks message reassembly into pooled buffer chains.
+ */
+
+#include "unit-test.hpp"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    char memory[64*WS_ARENA_PAGE];
+
+    // append a frame, unmasked.
+    void frame ( std::string& wire, int type, bool last,
+                 const std::string& payload )
+    {
+        wire += char((last? 0x80 : 0x00)|type);
+        const uint64 size = payload.size();
+        if (size < 126) {
+            wire += char(size);
+        }
+        else if (size < 65536) {
+            wire += char(126);
+            wire += char(size >> 8), wire += char(size);
+        }
+        else {
+            wire += char(127);
+            for (int i = 7; i >= 0; --i) {
+                wire += char(size >> (8*i));
+            }
+        }
+        wire += payload;
+    }
+
+    struct Result
+    {
+        std::ostringstream events;
+        std::vector< ::ws_imessage_chunk* > kept;
+        std::size_t chunks;
+    };
+
+    void accept_message ( ::ws_imessage * message, ws_type type,
+                          ::ws_imessage_chunk * chain, uint64 size )
+    {
+        Result& result = *static_cast<Result*>(message->baton);
+        std::string payload;
+        for (::ws_imessage_chunk * chunk = chain; chunk; chunk = chunk->next) {
+            payload.append(chunk->data, chunk->size), ++result.chunks;
+        }
+        if (payload.size() != size) {
+            result.events << "(bad size)";
+        }
+        result.events << "[" << type << ":"
+                      << ((size < 16)? payload : "...") << "]";
+        // keep the chain past the callback, it stays valid.
+        result.kept.push_back(chain);
+    }
+
+    ::ws_imessage_status reassemble
+        ( ::ws_pool& pool, const std::string& data, std::size_t chunk,
+          Result& result, uint64 max_message=0, uint64 max_memory=0 )
+    {
+        ::ws_iwire wire;
+        ::ws_iwire_init(&wire);
+        ::ws_imessage message;
+        ::ws_imessage_init(&message, &wire, &pool);
+        message.max_message = max_message;
+        message.max_memory = max_memory;
+        message.accept_message = &accept_message;
+        message.baton = &result;
+        result.chunks = 0;
+        for (std::size_t i = 0; (i < data.size()) &&
+                 (message.status == ::ws_imessage_ok); i += chunk)
+        {
+            ::ws_iwire_feed(&wire, data.data()+i,
+                            std::min(chunk, data.size()-i));
+        }
+        for (std::size_t i = 0; i < result.kept.size(); ++i) {
+            ::ws_imessage_release(&message, result.kept[i]);
+        }
+        result.kept.clear();
+        ::ws_imessage_clear(&message);
+        if (message.memory != 0) {
+            fail("memory not returned to the pool");
+        }
+        return (message.status);
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        ::ws_arena arena;
+        ::ws_arena_init(&arena, memory, sizeof(memory));
+        ::ws_pool pool;
+        ::ws_pool_init(&pool, &arena);
+
+        // control messages interleaved with fragments.
+        std::string data;
+        frame(data, 0x1, false, "hel");
+        frame(data, 0x9, true, "?");
+        frame(data, 0x0, false, "lo");
+        frame(data, 0xa, true, "ok");
+        frame(data, 0x0, true, "!");
+        frame(data, 0x2, true, "");
+        const std::string expected = "[9:?][10:ok][1:hello!][2:]";
+        for (std::size_t chunk = 1; chunk <= data.size(); ++chunk)
+        {
+            Result result;
+            if (reassemble(pool, data, chunk, result) != ::ws_imessage_ok) {
+                fail("could not reassemble messages");
+            }
+            if (result.events.str() != expected)
+            {
+                std::cerr
+                    << "chunk: " << chunk << std::endl
+                    << "got: '" << result.events.str() << "'" << std::endl;
+                fail("wrong messages");
+            }
+        }
+
+        // many small fragments end up in few buffers.
+        std::string payload;
+        data.clear();
+        for (int i = 0; i < 2000; ++i)
+        {
+            const std::string part(100, char('a'+(i%26)));
+            frame(data, (i == 0)? 0x2 : 0x0, (i == 1999), part);
+            payload += part;
+        }
+        {
+            Result result;
+            if (reassemble(pool, data, 4096, result) != ::ws_imessage_ok) {
+                fail("could not reassemble fragments");
+            }
+            if (result.events.str() != "[2:...]") {
+                fail("wrong fragmented message");
+            }
+            if (result.chunks > 16) {
+                fail("too many buffers");
+            }
+        }
+
+        // frames larger than the limit are refused before their payload.
+        data.clear();
+        frame(data, 0x2, true, std::string(1000, 'x'));
+        {
+            Result result;
+            if (reassemble(pool, data.substr(0, 4), 1, result, 999)
+                != ::ws_imessage_too_large)
+            {
+                fail("frame larger than message limit");
+            }
+        }
+
+        // so are fragmented messages.
+        data.clear();
+        frame(data, 0x2, false, std::string(600, 'x'));
+        frame(data, 0x0, true, std::string(600, 'x'));
+        {
+            Result result;
+            if (reassemble(pool, data, 100, result, 1000)
+                != ::ws_imessage_too_large)
+            {
+                fail("message larger than message limit");
+            }
+            if (reassemble(pool, data, 100, result, 1200)
+                != ::ws_imessage_ok)
+            {
+                fail("message within message limit");
+            }
+        }
+
+        // connection memory limit.
+        {
+            Result result;
+            if (reassemble(pool, data, 100, result, 0, 1024)
+                != ::ws_imessage_out_of_memory)
+            {
+                fail("message larger than memory limit");
+            }
+            if (reassemble(pool, data, 100, result, 0, 2048)
+                != ::ws_imessage_ok)
+            {
+                fail("message within memory limit");
+            }
+        }
+
+        // exhausted pool.
+        {
+            ::ws_arena small;
+            ::ws_arena_init(&small, memory, 2*WS_ARENA_PAGE);
+            ::ws_pool tiny;
+            ::ws_pool_init(&tiny, &small);
+            data.clear();
+            frame(data, 0x2, true, std::string(3*WS_ARENA_PAGE, 'x'));
+            Result result;
+            if (reassemble(tiny, data, 65536, result)
+                != ::ws_imessage_out_of_memory)
+            {
+                fail("pool should be exhausted");
+            }
+        }
+
+        if (::ws_pool_used(&pool) != 0) {
+            fail("buffers leaked");
+        }
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
@@ -0,0 +1,164 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/replay-capture.cpp
+ * @brief Feeds captured client traffic through the parser.
+ *
+ * Usage: replay-capture [-r repeats] path...
+ *
+ * Each segment in the capture is passed to @c ws_iwire_feed() in a separate
+ * call, exactly as it was received.  Masking is required and text messages
+ * are validated, as a server would.  Prints one JSON object per capture with
+ * the callback counts of a single pass and the throughput over all passes.
+ * Fails if the parser reports an error.
+ */
+
+#include "unit-test.hpp"
+#include "options.hpp"
+#include "capture.hpp"
+
+#include <cstdio>
+#include <ctime>
+
+namespace {
+
+    struct Counts
+    {
+        uint64 messages;
+        uint64 fragments;
+        uint64 control;
+        uint64 chunks;
+        uint64 payload;
+    };
+
+    void new_message ( ::ws_iwire * wire )
+    {
+        ++static_cast<Counts*>(wire->baton)->messages;
+    }
+
+    void new_fragment ( ::ws_iwire * wire, uint64 size )
+    {
+        Counts& counts = *static_cast<Counts*>(wire->baton);
+        ++counts.fragments;
+        // control messages are never fragmented.
+        if (!::ws_iwire_text(wire) && !::ws_iwire_data(wire)) {
+            ++counts.control;
+        }
+    }
+
+    void accept_content ( ::ws_iwire * wire, const void * data, uint64 size )
+    {
+        Counts& counts = *static_cast<Counts*>(wire->baton);
+        ++counts.chunks, counts.payload += size;
+    }
+
+    bool replay ( const capture::Capture& capture, Counts& counts )
+    {
+        ::ws_iwire wire;
+        ::ws_iwire_init(&wire);
+        wire.baton            = &counts;
+        wire.new_message      = &new_message;
+        wire.new_fragment     = &new_fragment;
+        wire.accept_content   = &accept_content;
+        wire.masking_required = 1;
+        wire.validate_text    = 1;
+        std::size_t used = 0;
+        for (std::size_t i = 0; i < capture.segments.size(); ++i)
+        {
+            const std::size_t size = capture.segments[i] - used;
+            if (::ws_iwire_feed(&wire, capture.data.data()+used, size) != size) {
+                return (false);
+            }
+            used = capture.segments[i];
+        }
+        return (wire.status == ws_iwire_ok);
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        const int repeats = ::getarg<int>(argc, argv, "-r", 1);
+        if (repeats < 1) {
+            fail("repeats must be positive");
+        }
+        if (argc == (::hasarg(argc, argv, "-r")? 2 : 0))
+        {
+            std::cerr
+                << "Usage: replay-capture [-r repeats] path..."
+                << std::endl;
+            return (FAIL);
+        }
+        for (int i = 0; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], "-r") == 0) {
+                ++i; continue;
+            }
+            capture::Capture capture;
+            if (!capture::load(argv[i], capture))
+            {
+                std::cerr
+                    << "Could not load capture '" << argv[i] << "'."
+                    << std::endl;
+                return (FAIL);
+            }
+            Counts counts = { 0, 0, 0, 0, 0 };
+            const std::clock_t start = std::clock();
+            for (int pass = 0; pass < repeats; ++pass)
+            {
+                counts = Counts();
+                if (!replay(capture, counts))
+                {
+                    std::cerr
+                        << "Error parsing '" << argv[i] << "'."
+                        << std::endl;
+                    return (FAIL);
+                }
+            }
+            const double seconds = std::max(
+                double(std::clock()-start) / CLOCKS_PER_SEC, 1e-9);
+            std::printf(
+                "{\"capture\": \"%s\", \"repeats\": %d, \"segments\": %llu, "
+                "\"bytes\": %llu, \"messages\": %llu, \"control\": %llu, "
+                "\"fragments\": %llu, \"chunks\": %llu, \"payload\": %llu, "
+                "\"mask_engine\": \"%s\", \"seconds\": %.6f, "
+                "\"segments_per_s\": %.0f, \"messages_per_s\": %.0f, "
+                "\"gb_per_s\": %.4f}\n",
+                argv[i], repeats,
+                (unsigned long long)capture.segments.size(),
+                (unsigned long long)capture.data.size(),
+                counts.messages, counts.control, counts.fragments,
+                counts.chunks, counts.payload, ::ws_mask_engine(), seconds,
+                capture.segments.size()*repeats/seconds,
+                counts.messages*repeats/seconds,
+                double(capture.data.size())*repeats/seconds/1e9);
+        }
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
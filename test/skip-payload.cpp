@@ -0,0 +1,134 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/skip-payload.cpp
+ * @brief Tests payloads forwarded by the application instead of the parser.
+ */
+
+#include "unit-test.hpp"
+
+#include <sstream>
+
+namespace {
+
+    const unsigned char data[] =
+    {
+        // data: "0123456789", unmasked.
+        0x80|0x02,
+        10,
+        '0','1','2','3','4','5','6','7','8','9',
+
+        // text: "abc", masked.
+        0x80|0x01,
+        0x80|3,
+        0x01,0x02,0x03,0x04,
+        'a'^0x01,'b'^0x02,'c'^0x03,
+
+        // ping: "p", unmasked.
+        0x80|0x09,
+        1,
+        'p',
+    };
+
+    void accept_content ( ::ws_iwire * wire, const void * data, uint64 size )
+    {
+        static_cast<std::ostringstream*>(wire->baton)
+            ->write(static_cast<const char*>(data), size);
+    }
+
+    void end_message ( ::ws_iwire * wire )
+    {
+        *static_cast<std::ostringstream*>(wire->baton) << "|";
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        std::ostringstream events;
+        ::ws_iwire wire;
+        ::ws_iwire_init(&wire);
+        wire.baton          = &events;
+        wire.accept_content = &accept_content;
+        wire.end_message    = &end_message;
+
+        // header and a few payload bytes, the rest is forwarded elsewhere.
+        if (::ws_iwire_skip(&wire, 1) != 0) {
+            fail("skipped outside of a frame");
+        }
+        if (::ws_iwire_feed(&wire, data, 5) != 5) {
+            fail("could not parse header");
+        }
+        if (::ws_iwire_payload(&wire) != 7) {
+            fail("wrong payload left");
+        }
+        if (::ws_iwire_skip(&wire, 4) != 4) {
+            fail("could not skip payload");
+        }
+        if (::ws_iwire_feed(&wire, data+9, 1) != 1) {
+            fail("could not parse payload after skip");
+        }
+        if (::ws_iwire_skip(&wire, 1000) != 2) {
+            fail("skipped past the end of the frame");
+        }
+        if (events.str() != "0127|") {
+            fail("wrong events after skip");
+        }
+
+        // masked payloads must be seen by the parser.
+        ::ws_iwire_feed(&wire, data+12, 7);
+        if ((::ws_iwire_payload(&wire) != 2) ||
+            (::ws_iwire_skip(&wire, 2) != 0))
+        {
+            fail("skipped masked payload");
+        }
+        ::ws_iwire_feed(&wire, data+19, 2);
+
+        // also works for control frames, header only.
+        ::ws_iwire_feed(&wire, data+21, 2);
+        if (::ws_iwire_skip(&wire, 1) != 1) {
+            fail("could not skip control payload");
+        }
+        if ((events.str() != "0127|abc||") || (wire.status != ws_iwire_ok)) {
+            fail("wrong events");
+        }
+
+        // text being validated must be seen by the parser.
+        ::ws_iwire_init(&wire);
+        wire.validate_text = 1;
+        const unsigned char text[] = { 0x81, 3, 'a', 'b', 'c' };
+        ::ws_iwire_feed(&wire, text, 2);
+        if ((::ws_iwire_payload(&wire) != 3) ||
+            (::ws_iwire_skip(&wire, 3) != 0))
+        {
+            fail("skipped validated text");
+        }
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
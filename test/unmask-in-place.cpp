@@ -0,0 +1,108 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/unmask-in-place.cpp
+ * @brief Tests unmasking of frame payloads in the application's buffer.
+ */
+
+#include "unit-test.hpp"
+
+#include <vector>
+
+namespace {
+
+    struct Result
+    {
+        std::string payload;
+        std::size_t calls;
+    };
+
+    void accept_content ( ::ws_iwire * wire, const void * data, uint64 size )
+    {
+        Result& result = *static_cast<Result*>(wire->baton);
+        result.payload.append(static_cast<const char*>(data), size);
+        result.calls++;
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        const uint8 mask[4] = { 0x37, 0xfa, 0x21, 0x3d };
+
+        // 1000 byte binary message, masked.
+        std::string answer;
+        for (std::size_t i = 0; i < 1000; ++i) {
+            answer.push_back(static_cast<char>(i*7));
+        }
+        std::vector<uint8> frame;
+        frame.push_back(0x80|0x02);
+        frame.push_back(0x80|126);
+        frame.push_back(0x03);
+        frame.push_back(0xe8);
+        frame.insert(frame.end(), mask, mask+4);
+        for (std::size_t i = 0; i < answer.size(); ++i) {
+            frame.push_back(static_cast<uint8>(answer[i]) ^ mask[i%4]);
+        }
+
+        Result result;
+        result.calls = 0;
+
+        ::ws_iwire wire;
+        ::ws_iwire_init(&wire);
+        wire.baton = &result;
+        wire.accept_content = &accept_content;
+
+        // feed in two chunks, splitting the payload.
+        const std::size_t split = 501;
+        if ((::ws_iwire_feed_inplace(&wire, &frame[0], split) != split) ||
+            (::ws_iwire_feed_inplace(&wire, &frame[split],
+                                     frame.size()-split) != frame.size()-split))
+        {
+            fail("could not parse frame");
+        }
+
+        // expect one call per contiguous span.
+        if (result.calls != 2) {
+            fail("payload delivered in more than one call per chunk");
+        }
+        if (result.payload != answer) {
+            fail("payload mismatch");
+        }
+
+        // payload is now unmasked in the input buffer.
+        if (!std::equal(answer.begin(), answer.end(),
+                        reinterpret_cast<const char*>(&frame[8])))
+        {
+            fail("input buffer not unmasked in place");
+        }
+
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
@@ -0,0 +1,265 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/upgrade-handshake.cpp
+ * @brief Tests the incremental opening handshake, in both roles.
+ */
+
+#include "unit-test.hpp"
+
+#include <cstring>
+
+namespace {
+
+    const std::string request =
+        "GET /chat HTTP/1.1\r\n"
+        "Host: server.example.com\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: keep-alive, Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Protocol: chat\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "\r\n";
+
+    const std::string response =
+        "HTTP/1.1 101 Switching Protocols\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"
+        "\r\n";
+
+    // collects headers the handshake doesn't interpret.
+    void accept_header ( ::ws_handshake * handshake,
+                         const char * name, const char * value )
+    {
+        if (std::strcmp(name, "Sec-WebSocket-Protocol") == 0) {
+            *static_cast<std::string*>(handshake->baton) = value;
+        }
+    }
+
+    void accept_cookie ( ::ws_handshake * handshake,
+                         const char * name, const char * value )
+    {
+        if (std::strcmp(name, "Cookie") == 0) {
+            *static_cast<std::string*>(handshake->baton) = value;
+        }
+    }
+
+    // parse the message head, then return the leftovers.
+    std::string parse ( ::ws_handshake& handshake,
+                        const std::string& data, std::size_t chunk )
+    {
+        std::size_t i = 0;
+        while ((i < data.size()) && !::ws_handshake_done(&handshake))
+        {
+            const std::size_t size = std::min(chunk, data.size()-i);
+            i += ::ws_handshake_feed(&handshake, data.data()+i, size);
+        }
+        return (data.substr(i));
+    }
+
+    ::ws_handshake_status server ( const std::string& data )
+    {
+        ::ws_handshake handshake;
+        ::ws_handshake_init(&handshake);
+        parse(handshake, data, data.size());
+        return (handshake.status);
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        // frames sent right behind the request must be left alone.
+        const std::string frames("\x81\x80\x01\x02\x03\x04", 6);
+        const std::size_t chunks[] = { 1, 7, 1000 };
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            std::string protocol;
+            ::ws_handshake handshake;
+            ::ws_handshake_init(&handshake);
+            handshake.baton = &protocol;
+            handshake.accept_header = &accept_header;
+            if (parse(handshake, request+frames, chunks[i]) != frames) {
+                fail("frames consumed by the handshake");
+            }
+            if (!::ws_handshake_done(&handshake) ||
+                (handshake.status != ::ws_handshake_ok))
+            {
+                fail("valid request rejected");
+            }
+            if (std::strcmp(::ws_handshake_key(&handshake),
+                            "dGhlIHNhbXBsZSBub25jZQ==") != 0)
+            {
+                fail("wrong key");
+            }
+            if (protocol != "chat") {
+                fail("extra header not reported");
+            }
+
+            // response is formatted in place.
+            char data[256];
+            const uint64 size = ::ws_handshake_accept(&handshake,
+                "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=", 0, data, sizeof(data));
+            if (std::string(data, size) != response) {
+                fail("wrong response");
+            }
+            if (::ws_handshake_accept(&handshake,
+                    "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=", 0, data, 64) != 0)
+            {
+                fail("response overflows buffer");
+            }
+        }
+
+        // invalid requests.
+        std::string bad = request;
+        bad.replace(bad.find("websocket"), 9, "h2c");
+        if (server(bad) != ::ws_handshake_not_upgrade) {
+            fail("missing upgrade accepted");
+        }
+        bad = request;
+        bad.replace(bad.find("Version: 13"), 11, "Version: 8");
+        if (server(bad) != ::ws_handshake_bad_version) {
+            fail("wrong version accepted");
+        }
+        bad = request;
+        bad.replace(bad.find("dGhl"), 4, "dGh");
+        if (server(bad) != ::ws_handshake_bad_key) {
+            fail("short key accepted");
+        }
+        if (server("GET / HTTP/1.1\r\n" + request.substr(20))
+            != ::ws_handshake_ok)
+        {
+            fail("root path rejected");
+        }
+        bad = request;
+        bad.replace(0, 3, "POST");
+        if (server(bad) != ::ws_handshake_malformed) {
+            fail("wrong method accepted");
+        }
+        bad = request;
+        bad.insert(bad.find("Upgrade:"), "Folded:\r\n value\r\n");
+        if (server(bad) != ::ws_handshake_malformed) {
+            fail("folded header accepted");
+        }
+
+        // browsers send long cookies, user agents and query strings.
+        std::string big = request;
+        big.insert(big.find("Upgrade:"),
+            "Cookie: "+std::string(4096, 'x')+"\r\n"
+            "User-Agent: "+std::string(300, 'y')+"\r\n");
+        big.replace(4, 5, "/chat?q="+std::string(1000, 'z'));
+        {
+            std::string cookie;
+            ::ws_handshake handshake;
+            ::ws_handshake_init(&handshake);
+            handshake.baton = &cookie;
+            handshake.accept_header = &accept_cookie;
+            parse(handshake, big, 7);
+            if (handshake.status != ::ws_handshake_ok) {
+                fail("request with long headers rejected");
+            }
+            if (cookie != std::string(WS_HANDSHAKE_TEXT, 'x')) {
+                fail("long header not truncated");
+            }
+            if (std::strcmp(::ws_handshake_key(&handshake),
+                            "dGhlIHNhbXBsZSBub25jZQ==") != 0)
+            {
+                fail("wrong key after long headers");
+            }
+        }
+        bad = request;
+        bad.insert(bad.find("Upgrade:"),
+            "Sec-WebSocket-Extensions: "+std::string(300, 'x')+"\r\n");
+        if (server(bad) != ::ws_handshake_too_large) {
+            fail("long interpreted header accepted");
+        }
+        {
+            ::ws_handshake handshake;
+            ::ws_handshake_init(&handshake);
+            handshake.limit = 64;
+            parse(handshake, request, 1);
+            if (handshake.status != ::ws_handshake_too_large) {
+                fail("large request accepted");
+            }
+            char data[256];
+            const uint64 size = ::ws_handshake_reject(
+                &handshake, data, sizeof(data));
+            if (std::string(data, size).find("HTTP/1.1 431 ") != 0) {
+                fail("wrong rejection");
+            }
+            if (::ws_handshake_accept(&handshake,
+                    "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=", 0, data, sizeof(data)))
+            {
+                fail("failed handshake approved");
+            }
+        }
+
+        // client side.
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            ::ws_handshake handshake;
+            ::ws_handshake_init(&handshake);
+            char data[256];
+            const uint64 size = ::ws_handshake_request(&handshake,
+                "server.example.com", "/chat", "dGhlIHNhbXBsZSBub25jZQ==",
+                "Sec-WebSocket-Protocol: chat\r\n", data, sizeof(data));
+            std::string expected = request;
+            expected.replace(expected.find("keep-alive, "), 12, "");
+            expected.erase(expected.find("Sec-WebSocket-Protocol"), 30);
+            expected.insert(expected.size()-2,
+                "Sec-WebSocket-Protocol: chat\r\n");
+            if (std::string(data, size) != expected) {
+                fail("wrong request");
+            }
+            if (parse(handshake, response+frames, chunks[i]) != frames) {
+                fail("frames consumed by the handshake");
+            }
+            if ((handshake.status != ::ws_handshake_ok) ||
+                (std::strcmp(::ws_handshake_key(&handshake),
+                             "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") != 0))
+            {
+                fail("valid response rejected");
+            }
+        }
+        {
+            ::ws_handshake handshake;
+            ::ws_handshake_init(&handshake);
+            char data[256];
+            ::ws_handshake_request(&handshake, "example.com", "/",
+                "dGhlIHNhbXBsZSBub25jZQ==", 0, data, sizeof(data));
+            parse(handshake, "HTTP/1.1 403 Forbidden\r\n\r\n", 1);
+            if (handshake.status != ::ws_handshake_rejected) {
+                fail("refusal accepted");
+            }
+        }
+
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
@@ -0,0 +1,185 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/utf8-validation.cpp
+ * @brief Tests UTF-8 validation, against a straightforward decoder.
+ */
+
+#include "unit-test.hpp"
+
+#include <cstring>
+
+namespace {
+
+    // reference implementation, one code point at a time.
+    bool reference ( const std::string& text )
+    {
+        std::size_t i = 0;
+        while (i < text.size())
+        {
+            const unsigned char lead = text[i];
+            unsigned long point = 0;
+            std::size_t length = 0;
+            if (lead < 0x80) {
+                ++i; continue;
+            }
+            else if ((lead & 0xe0) == 0xc0) {
+                length = 2, point = lead & 0x1f;
+            }
+            else if ((lead & 0xf0) == 0xe0) {
+                length = 3, point = lead & 0x0f;
+            }
+            else if ((lead & 0xf8) == 0xf0) {
+                length = 4, point = lead & 0x07;
+            }
+            else {
+                return (false);
+            }
+            if (i+length > text.size()) {
+                return (false);
+            }
+            for (std::size_t j = 1; j < length; ++j)
+            {
+                const unsigned char byte = text[i+j];
+                if ((byte & 0xc0) != 0x80) {
+                    return (false);
+                }
+                point = (point << 6) | (byte & 0x3f);
+            }
+            // overlong forms, surrogates and out of range code points.
+            if (((length == 2) && (point < 0x80)) ||
+                ((length == 3) && (point < 0x800)) ||
+                ((length == 4) && (point < 0x10000)) ||
+                ((point >= 0xd800) && (point <= 0xdfff)) ||
+                (point > 0x10ffff))
+            {
+                return (false);
+            }
+            i += length;
+        }
+        return (true);
+    }
+
+    bool stream ( const std::string& text, std::size_t split )
+    {
+        ::ws_utf8 validator;
+        ::ws_utf8_init(&validator);
+        return (::ws_utf8_feed(&validator, text.data(), split) &&
+                ::ws_utf8_feed(&validator, text.data()+split,
+                               text.size()-split) &&
+                ::ws_utf8_done(&validator));
+    }
+
+    unsigned long state = 12345;
+    unsigned long next ()
+    {
+        state = state*1103515245 + 12345;
+        return ((state >> 16) & 0x7fff);
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        const char *const samples[] = {
+            "hello", "\xc3\xa9t\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+            "\xed\x9f\xbf", "\xee\x80\x80", "\xf4\x8f\xbf\xbf",
+            "\xc0\xaf", "\xc1\xbf", "\xe0\x80\xaf", "\xe0\x9f\xbf",
+            "\xed\xa0\x80", "\xed\xbf\xbf", "\xf0\x80\x80\xaf",
+            "\xf4\x90\x80\x80", "\xf5\x80\x80\x80", "\xff", "\x80",
+            "\xc3", "\xe2\x82", "\xf0\x9f\x98", "\xe2\x28\xa1",
+        };
+        const std::size_t count = sizeof(samples)/sizeof(samples[0]);
+
+        // pieces used to build random texts.
+        std::string pieces[count];
+        for (std::size_t i = 0; i < count; ++i) {
+            pieces[i] = samples[i];
+        }
+
+        // every implementation available here must match the reference.
+        const char *const engines[] = { "scalar", "ssse3", "avx2", "neon" };
+        for (std::size_t engine = 0; engine < 4; ++engine)
+        {
+            if (!::ws_utf8_override(engines[engine]))
+            {
+                if (engine == 0) {
+                    fail("scalar validation unavailable");
+                }
+                std::cout << "skipping: " << engines[engine] << std::endl;
+                continue;
+            }
+            std::cout << "engine: " << ::ws_utf8_engine() << std::endl;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (::ws_utf8_check(pieces[i].data(), pieces[i].size())
+                    != reference(pieces[i]))
+                {
+                    std::cerr << "sample: " << i << std::endl;
+                    fail("sample misclassified");
+                }
+            }
+
+            // same texts for all implementations.
+            state = 12345;
+
+            // long texts exercise vectorized code paths, including
+            // sequences that straddle vector boundaries.
+            for (int round = 0; round < 20000; ++round)
+            {
+                std::string text(next() % 70, 'a');
+                const std::size_t inserts = next() % 8;
+                for (std::size_t i = 0; i < inserts; ++i)
+                {
+                    const std::string& piece = pieces[next() % count];
+                    const std::size_t position = next() % (text.size()+1);
+                    // mostly valid pieces, so that errors are rare.
+                    if (reference(piece) || ((next() % 4) == 0)) {
+                        text.insert(position, piece);
+                    }
+                }
+                const bool expected = reference(text);
+                if (::ws_utf8_check(text.data(), text.size()) != expected) {
+                    std::cerr << "round: " << round << std::endl;
+                    fail("text misclassified");
+                }
+                const std::size_t split = next() % (text.size()+1);
+                if (stream(text, split) != expected) {
+                    std::cerr << "round: " << round << std::endl;
+                    fail("split text misclassified");
+                }
+            }
+        }
+        if (::ws_utf8_override("none") || !::ws_utf8_override(0)) {
+            fail("overrides not checked");
+        }
+
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"
@@ -0,0 +1,297 @@
+// Copyright (c) 2011-2012, Andre Caron (andre.l.caron@gmail.com)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+//   Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*!
+ * @internal
+ * @file test/wire-benchmark.cpp
+ * @brief Measures parser and writer throughput per payload size class.
+ *
+ * Each case runs for at least the target time (option -t, in seconds,
+ * default: 0.25) and prints one JSON object per line, so that results can be
+ * collected and compared between builds.  Payload sizes are the largest of
+ * each frame header length class (7-bit, 16-bit and 64-bit lengths).
+ * Unmasked payloads are passed by reference in both directions.  Sinks
+ * read every byte they are handed, as a socket copying them out would, so
+ * that those cases still account for touching the payload.
+ * Options:
+ *
+ *  -t   target time per case, in seconds;
+ *  -b   only run cases for this benchmark, e.g. "iwire_feed".
+ */
+
+#include "unit-test.hpp"
+#include "options.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+namespace {
+
+    const uint64 payloads[] = { 125, 65535, 1024*1024 };
+    const uint64 chunks[] = { 1, 1024, 64*1024 };
+    const uint64 batch = 16;
+
+    // one measurement.
+    struct Result
+    {
+        const char * benchmark;
+        const char * type;
+        uint64 payload;
+        bool masked;
+        uint64 chunk;
+        uint64 frames;
+        double seconds;
+    };
+
+    void report ( const Result& result )
+    {
+        const double seconds = std::max(result.seconds, 1e-9);
+        std::printf(
+            "{\"benchmark\": \"%s\", \"type\": \"%s\", \"payload\": %llu, "
+            "\"masked\": %s, \"chunk\": %llu, \"mask_engine\": \"%s\", "
+            "\"frames\": %llu, \"seconds\": %.6f, "
+            "\"frames_per_s\": %.0f, \"gb_per_s\": %.4f}\n",
+            result.benchmark, result.type, result.payload,
+            result.masked? "true" : "false", result.chunk,
+            ::ws_mask_engine(), result.frames, result.seconds,
+            result.frames/seconds,
+            double(result.frames*result.payload)/seconds/1e9);
+        std::fflush(stdout);
+    }
+
+    double elapsed ( std::clock_t start )
+    {
+        return (double(std::clock()-start) / CLOCKS_PER_SEC);
+    }
+
+    // output or input consumed by a callback.
+    struct Sink
+    {
+        uint64 size;
+        uint64 sum;
+    };
+
+    // read every byte, one word at a time.
+    void touch ( Sink& sink, const void * data, uint64 size )
+    {
+        const char *const bytes = static_cast<const char*>(data);
+        uint64 used = 0;
+        uint64 word = 0;
+        for (; (size-used) >= 8; used += 8) {
+            std::memcpy(&word, bytes+used, 8), sink.sum += word;
+        }
+        for (; used < size; ++used) {
+            sink.sum += uint8(bytes[used]);
+        }
+        sink.size += size;
+    }
+
+    // writer callbacks consume output like a socket that never blocks.
+    void count_slices ( ::ws_owire * wire,
+                        const ::ws_owire_slice * slices, int count )
+    {
+        for (int i = 0; i < count; ++i) {
+            touch(*static_cast<Sink*>(wire->baton),
+                  slices[i].data, slices[i].size);
+        }
+    }
+
+    void store_content ( ::ws_owire * wire, const void * data, uint64 size )
+    {
+        static_cast<std::string*>(wire->baton)->append(
+            static_cast<const char*>(data), size);
+    }
+
+    void fixed_mask ( ::ws_owire * wire, uint8 mask[4] )
+    {
+        mask[0] = 0x37, mask[1] = 0xfa, mask[2] = 0x21, mask[3] = 0x3d;
+    }
+
+    // parser callbacks consume input like an application would.
+    void count_input ( ::ws_iwire * wire, const void * data, uint64 size )
+    {
+        touch(*static_cast<Sink*>(wire->baton), data, size);
+    }
+
+    void setup ( ::ws_owire& wire, bool masked, std::string& buffer )
+    {
+        ::ws_owire_init(&wire);
+        wire.rand = &fixed_mask;
+        wire.mask_payload = masked? 1 : 0;
+        if (masked)
+        {
+            // stage whole frames, as a high-throughput client would.
+            wire.buffer = &buffer[0];
+            wire.buffer_size = buffer.size();
+        }
+    }
+
+    Result put ( bool text, uint64 payload, bool masked, double target )
+    {
+        const std::string data(payload, 'a');
+        std::string buffer(payload, '\0');
+        Sink total = { 0, 0 };
+        ::ws_owire wire;
+        setup(wire, masked, buffer);
+        wire.baton = &total;
+        wire.accept_slices = &count_slices;
+
+        Result result = { text? "owire_put_text" : "owire_put_data",
+                          text? "text" : "data", payload, masked, 0, 0, 0.0 };
+        const std::clock_t start = std::clock();
+        do {
+            for (uint64 i = 0; i < batch; ++i) {
+                if (text) {
+                    ::ws_owire_put_text(&wire, data.data(), payload, 0);
+                }
+                else {
+                    ::ws_owire_put_data(&wire, data.data(), payload, 0);
+                }
+            }
+            result.frames += batch;
+        }
+        while ((result.seconds = elapsed(start)) < target);
+        if (total.size < result.frames*payload) {
+            fail("output was lost");
+        }
+        return (result);
+    }
+
+    Result put_batch ( uint64 payload, bool masked, double target )
+    {
+        const std::string data(payload, 'a');
+        std::vector< ::ws_owire_message > messages(batch);
+        for (uint64 i = 0; i < batch; ++i) {
+            messages[i].type = ws_data;
+            messages[i].data = data.data();
+            messages[i].size = payload;
+            messages[i].extension = 0;
+        }
+        std::string buffer(1, '\0');
+        ::ws_owire wire;
+        setup(wire, false, buffer);
+        wire.mask_payload = masked? 1 : 0;
+        std::vector<char> output(size_t(
+            ::ws_owire_batch_size(&wire, &messages[0], batch)));
+
+        Result result = { "owire_put_batch", "data",
+                          payload, masked, 0, 0, 0.0 };
+        const std::clock_t start = std::clock();
+        do {
+            ::ws_owire_put_batch(&wire, &messages[0], batch, &output[0]);
+            result.frames += batch;
+        }
+        while ((result.seconds = elapsed(start)) < target);
+        return (result);
+    }
+
+    Result feed ( bool text, uint64 payload, bool masked,
+                  uint64 chunk, double target )
+    {
+        // encode enough frames to make each pass at least 1 MiB.
+        const uint64 frames = std::max<uint64>(1, (1024*1024)/payload);
+        const std::string data(payload, 'a');
+        std::string buffer(payload, '\0');
+        std::string stream;
+        {
+            ::ws_owire wire;
+            setup(wire, masked, buffer);
+            wire.baton = &stream;
+            wire.accept_content = &store_content;
+            for (uint64 i = 0; i < frames; ++i) {
+                if (text) {
+                    ::ws_owire_put_text(&wire, data.data(), payload, 0);
+                }
+                else {
+                    ::ws_owire_put_data(&wire, data.data(), payload, 0);
+                }
+            }
+        }
+        Sink total = { 0, 0 };
+        ::ws_iwire wire;
+        ::ws_iwire_init(&wire);
+        wire.baton = &total;
+        wire.accept_content = &count_input;
+        wire.masking_required = masked? 1 : 0;
+        wire.validate_text = 1;
+
+        Result result = { "iwire_feed", text? "text" : "data",
+                          payload, masked, chunk, 0, 0.0 };
+        const std::clock_t start = std::clock();
+        do {
+            for (uint64 used = 0; used < stream.size(); used += chunk) {
+                ::ws_iwire_feed(&wire, stream.data()+used,
+                                std::min<uint64>(chunk, stream.size()-used));
+            }
+            result.frames += frames;
+        }
+        while ((result.seconds = elapsed(start)) < target);
+        if ((wire.status != ws_iwire_ok) || (total.size != result.frames*payload)) {
+            fail("input was lost");
+        }
+        return (result);
+    }
+
+    bool selected ( const char * only, const char * benchmark )
+    {
+        return ((only == 0) || (std::strcmp(only, benchmark) == 0));
+    }
+
+    int test ( int argc, char ** argv )
+    {
+        const double target = ::getarg<double>(argc, argv, "-t", 0.25);
+        const std::string filter = ::getarg<std::string>(argc, argv, "-b", "");
+        const char *const only = ::hasarg(argc, argv, "-b")? filter.c_str() : 0;
+
+        for (std::size_t p = 0; p < sizeof(payloads)/sizeof(*payloads); ++p)
+        for (int masked = 0; masked < 2; ++masked)
+        {
+            if (selected(only, "owire_put_data")) {
+                report(put(false, payloads[p], masked != 0, target));
+            }
+            if (selected(only, "owire_put_text")) {
+                report(put(true, payloads[p], masked != 0, target));
+            }
+            if (selected(only, "owire_put_batch")) {
+                report(put_batch(payloads[p], masked != 0, target));
+            }
+            for (std::size_t c = 0; c < sizeof(chunks)/sizeof(*chunks); ++c)
+            {
+                if (!selected(only, "iwire_feed")) {
+                    continue;
+                }
+                report(feed(false, payloads[p], masked != 0, chunks[c], target));
+                report(feed(true, payloads[p], masked != 0, chunks[c], target));
+            }
+        }
+        return (PASS);
+    }
+
+}
+
+#include "unit-test.cpp"